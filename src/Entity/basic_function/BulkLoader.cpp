@@ -0,0 +1,271 @@
+#include "Entity/basic_function/BulkLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+BulkLoader::BulkLoader(std::shared_ptr<const RowLayout> layout, Options options)
+    : layout(std::move(layout)), options(options) {
+  if (this->options.threads == 0) {
+    this->options.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  this->options.chunkBytes = std::max<size_t>(this->options.chunkBytes, 4096);
+}
+
+void BulkLoader::reject(size_t line, const std::string &message) {
+  ++rejectedRows;
+  if (reported < options.maxReportedErrors) {
+    std::cerr << "Line " << line << ": " << message << std::endl;
+  } else if (reported == options.maxReportedErrors) {
+    std::cerr << "Further errors suppressed." << std::endl;
+  }
+  ++reported;
+}
+
+bool BulkLoader::encodeCsvRecord(const std::vector<std::string> &fields,
+                                 char *row, std::string &error) const {
+  const Table &table = layout->table();
+  for (int i = 0; i < layout->columnCount(); ++i) {
+    const std::string *value = &fields[i];
+    if (value->empty() && !table.columns[i].isNullable) {
+      if (table.columns[i].defaultValue.empty()) {
+        error = "Non-nullable column '" + table.columns[i].name +
+                "' must have a value.";
+        return false;
+      }
+      value = &table.columns[i].defaultValue;
+    }
+    if (!layout->encodeField(row, i, *value)) {
+      error = "Invalid value '" + *value + "' for column '" +
+              table.columns[i].name + "'.";
+      return false;
+    }
+  }
+  return true;
+}
+
+BulkLoader::Parsed BulkLoader::parseCsv(const Chunk &chunk,
+                                       bool skipFirst) const {
+  Parsed parsed;
+  int rowWidth = layout->rowWidth();
+  size_t columnCount = static_cast<size_t>(layout->columnCount());
+  const char delimiter = options.delimiter;
+  const char *p = chunk.data.data();
+  const char *end = p + chunk.data.size();
+  size_t line = chunk.firstLine;
+
+  // 字段字符串在各行之间复用，避免逐字段分配
+  std::vector<std::string> fields;
+  std::vector<char> row(rowWidth);
+  std::string error;
+  while (p < end) {
+    size_t recordLine = line;
+    size_t count = 0;
+    while (true) {
+      if (count == fields.size()) {
+        fields.emplace_back();
+      }
+      std::string &field = fields[count++];
+      field.clear();
+      if (*p == '"') {
+        // 引号字段："" 表示一个引号，字段内可以有分隔符和换行
+        for (++p; p < end; ++p) {
+          if (*p == '"') {
+            if (p + 1 < end && p[1] == '"') {
+              field += '"';
+              ++p;
+            } else {
+              ++p;
+              break;
+            }
+          } else {
+            line += *p == '\n';
+            field += *p;
+          }
+        }
+      }
+      const char *start = p;
+      while (p < end && *p != delimiter && *p != '\n') {
+        ++p;
+      }
+      const char *stop = p;
+      if (stop > start && stop[-1] == '\r' && (p == end || *p == '\n')) {
+        --stop; // CRLF
+      }
+      field.append(start, stop);
+
+      if (p < end && *p == delimiter) {
+        ++p;
+        continue;
+      }
+      if (p < end) {
+        ++p; // '\n'
+        ++line;
+      }
+      break;
+    }
+
+    if (count == 1 && fields[0].empty()) {
+      continue; // 空行
+    }
+    if (skipFirst) {
+      skipFirst = false;
+      continue;
+    }
+    if (count != columnCount) {
+      parsed.errors.emplace_back(recordLine,
+                                 "Expected " + std::to_string(columnCount) +
+                                     " fields, found " + std::to_string(count) +
+                                     ".");
+      continue;
+    }
+
+    std::fill(row.begin(), row.end(), '\0');
+    if (!encodeCsvRecord(fields, row.data(), error) ||
+        (validate && !validate(row.data(), error))) {
+      parsed.errors.emplace_back(recordLine, error);
+      continue;
+    }
+    parsed.rows.insert(parsed.rows.end(), row.begin(), row.end());
+    parsed.lines.push_back(recordLine);
+  }
+  return parsed;
+}
+
+BulkLoader::Parsed BulkLoader::parseBinary(const Chunk &chunk) const {
+  Parsed parsed;
+  size_t rowWidth = static_cast<size_t>(layout->rowWidth());
+  size_t count = chunk.data.size() / rowWidth;
+  parsed.rows.reserve(count * rowWidth);
+  parsed.lines.reserve(count);
+  std::string error;
+  for (size_t i = 0; i < count; ++i) {
+    const char *row = chunk.data.data() + i * rowWidth;
+    if (validate && !validate(row, error)) {
+      parsed.errors.emplace_back(chunk.firstLine + i, error);
+      continue;
+    }
+    parsed.rows.insert(parsed.rows.end(), row, row + rowWidth);
+    parsed.lines.push_back(chunk.firstLine + i);
+  }
+  if (chunk.data.size() % rowWidth != 0) {
+    parsed.errors.emplace_back(chunk.firstLine + count,
+                               "Truncated record at end of file.");
+  }
+  return parsed;
+}
+
+bool BulkLoader::load(const fs::path &input, const Sink &sink, Stats &stats) {
+  std::ifstream in(input, std::ios::binary);
+  if (!in) {
+    std::cerr << "Failed to open input file " << input << std::endl;
+    return false;
+  }
+
+  auto started = std::chrono::steady_clock::now();
+  stats = Stats();
+  reported = 0;
+  rejectedRows = 0;
+  const bool csv = options.format == Format::Csv;
+  const size_t rowWidth = static_cast<size_t>(layout->rowWidth());
+
+  // 已经派发给工作线程、还没交给 sink 的块，按文件顺序排队
+  std::deque<std::future<Parsed>> pending;
+  const size_t maxPending = options.threads * 2;
+  bool ok = true;
+  auto drain = [&](size_t keep) {
+    while (pending.size() > keep) {
+      Parsed parsed = pending.front().get();
+      pending.pop_front();
+      if (!ok) {
+        continue;
+      }
+      for (const auto &[line, message] : parsed.errors) {
+        reject(line, message);
+      }
+      Batch batch{parsed.rows.data(), parsed.lines.data(), parsed.lines.size()};
+      if (batch.count > 0 && !sink(batch)) {
+        ok = false;
+        continue;
+      }
+      stats.rows += batch.count - batch.rejected;
+    }
+  };
+
+  std::string carry;
+  size_t line = 1;
+  bool first = true;
+  while (ok) {
+    std::string buffer = std::move(carry);
+    carry.clear();
+    size_t old = buffer.size();
+    buffer.resize(old + options.chunkBytes);
+    in.read(&buffer[old], static_cast<std::streamsize>(options.chunkBytes));
+    size_t got = static_cast<size_t>(in.gcount());
+    buffer.resize(old + got);
+    stats.bytes += got;
+    bool eof = got < options.chunkBytes;
+    if (buffer.empty()) {
+      break;
+    }
+
+    // 找切分点：CSV 切在最后一个不在引号内的换行之后，Binary 切在整行边界
+    size_t cut = buffer.size();
+    size_t lines = 0;
+    if (csv) {
+      if (!eof) {
+        cut = 0;
+        if (buffer.find('"') == std::string::npos) {
+          size_t pos = buffer.rfind('\n');
+          cut = pos == std::string::npos ? 0 : pos + 1;
+        } else {
+          bool quoted = false;
+          for (size_t i = 0; i < buffer.size(); ++i) {
+            if (buffer[i] == '"') {
+              quoted = !quoted;
+            } else if (buffer[i] == '\n' && !quoted) {
+              cut = i + 1;
+            }
+          }
+        }
+      }
+      lines = static_cast<size_t>(
+          std::count(buffer.begin(), buffer.begin() + cut, '\n'));
+    } else if (!eof) {
+      cut -= cut % rowWidth;
+    }
+    if (cut == 0 && !eof) {
+      carry = std::move(buffer); // 一条记录比一块还长，继续读
+      continue;
+    }
+    carry.assign(buffer, cut, std::string::npos);
+    buffer.resize(cut);
+
+    Chunk chunk{std::move(buffer), line};
+    line += csv ? lines : cut / rowWidth;
+    bool skipFirst = first && options.skipHeader;
+    first = false;
+    pending.push_back(std::async(
+        std::launch::async, [this, csv, skipFirst, chunk = std::move(chunk)]() {
+          return csv ? parseCsv(chunk, skipFirst) : parseBinary(chunk);
+        }));
+    drain(maxPending - 1);
+
+    if (eof && carry.empty()) {
+      break;
+    }
+  }
+  drain(0);
+
+  stats.rejected = rejectedRows;
+  stats.seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - started)
+                      .count();
+  return ok;
+}
@@ -1,4 +1,7 @@
 #include "Entity/basic_function/DatabaseManager.h"
+#include "Entity/basic_function/SchemaCatalog.h"
+#include "Entity/storage/BufferPool.h"
+#include "Entity/storage/WriteAheadLog.h"
 
 namespace fs = std::filesystem;
 
@@ -13,7 +16,11 @@ void DatabaseManager::createDatabase(const std::string &dbName) {
 
 void DatabaseManager::deleteDatabase(const std::string &dbName) {
   fs::path dbPath = fs::current_path() / "DB" / dbName;
-  if (fs::remove_all(dbPath) != 0u) {
+  WriteAheadLog::discard(dbPath);
+  BufferPool::instance().dropDirectory(dbPath);
+  std::uintmax_t removed = fs::remove_all(dbPath);
+  SchemaCatalog::instance().invalidateDatabase(dbName);
+  if (removed != 0u) {
     std::cout << "Database deleted successfully." << std::endl;
   } else {
     std::cerr << "Failed to delete database." << std::endl;
@@ -0,0 +1,100 @@
+#include "Entity/basic_function/RowLayout.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+RowLayout::RowLayout(std::shared_ptr<const Table> table)
+    : schema(std::move(table)) {
+  fields.reserve(schema->columns.size());
+  for (const auto &col : schema->columns) {
+    fields.push_back({width, col.length, parseType(col.type)});
+    width += col.length;
+  }
+}
+
+RowLayout::ColumnType RowLayout::parseType(const std::string &type) {
+  if (type == "integer")
+    return ColumnType::Integer;
+  if (type == "str")
+    return ColumnType::Str;
+  if (type == "number")
+    return ColumnType::Number;
+  if (type == "bool")
+    return ColumnType::Bool;
+  return ColumnType::Unknown;
+}
+
+int RowLayout::columnIndex(const std::string &name) const {
+  for (size_t i = 0; i < schema->columns.size(); ++i) {
+    if (schema->columns[i].name == name) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+bool RowLayout::encodeField(char *row, int col, const std::string &text) const {
+  if (text.empty()) {
+    std::memset(row + fields[col].offset, 0, fields[col].width);
+    return true;
+  }
+
+  const char *begin = text.c_str();
+  char *end = nullptr;
+  errno = 0;
+  switch (fields[col].type) {
+  case ColumnType::Integer: {
+    long value = std::strtol(begin, &end, 10);
+    if (end == begin || *end != '\0' || errno == ERANGE || value < INT32_MIN ||
+        value > INT32_MAX) {
+      return false;
+    }
+    setInt(row, col, static_cast<int32_t>(value));
+    return true;
+  }
+  case ColumnType::Number: {
+    float value = std::strtof(begin, &end);
+    if (end == begin || *end != '\0') {
+      return false;
+    }
+    setNumber(row, col, value);
+    return true;
+  }
+  case ColumnType::Bool:
+    setBool(row, col, text == "true" || text == "1");
+    return true;
+  default:
+    setStr(row, col, text);
+    return true;
+  }
+}
+
+std::string RowLayout::toString(const char *row, int col) const {
+  switch (fields[col].type) {
+  case ColumnType::Integer:
+    return std::to_string(getInt(row, col));
+  case ColumnType::Number:
+    return std::to_string(getNumber(row, col));
+  case ColumnType::Bool:
+    return getBool(row, col) ? "true" : "false";
+  default:
+    return std::string(getStr(row, col));
+  }
+}
+
+void RowLayout::print(std::ostream &os, const char *row, int col) const {
+  switch (fields[col].type) {
+  case ColumnType::Integer:
+    os << getInt(row, col);
+    break;
+  case ColumnType::Number:
+    os << getNumber(row, col);
+    break;
+  case ColumnType::Bool:
+    os << (getBool(row, col) ? "true" : "false");
+    break;
+  default:
+    os << getStr(row, col);
+    break;
+  }
+}
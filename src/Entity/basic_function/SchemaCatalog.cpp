@@ -0,0 +1,90 @@
+#include "Entity/basic_function/SchemaCatalog.h"
+
+namespace fs = std::filesystem;
+
+SchemaCatalog &SchemaCatalog::instance() {
+  static SchemaCatalog catalog;
+  return catalog;
+}
+
+std::string SchemaCatalog::makeKey(const std::string &dbName,
+                                   const std::string &tableName) {
+  return dbName + '/' + tableName;
+}
+
+std::shared_ptr<const Table>
+SchemaCatalog::getSchema(const std::string &dbName,
+                         const std::string &tableName) {
+  std::shared_ptr<const RowLayout> layout = getLayout(dbName, tableName);
+  return layout ? layout->tablePtr() : nullptr;
+}
+
+std::shared_ptr<const RowLayout>
+SchemaCatalog::getLayout(const std::string &dbName,
+                         const std::string &tableName) {
+  std::string key = makeKey(dbName, tableName);
+  uint64_t loadVersion;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+      return it->second.layout;
+    }
+    loadVersion = versions[key];
+  }
+
+  // 在锁外读盘，避免慢 IO 阻塞其他表的查询
+  fs::path schemaFilePath =
+      fs::current_path() / "DB" / dbName / tableName / (tableName + ".tdf");
+  std::ifstream schemaFile(schemaFilePath, std::ios::binary);
+  if (!schemaFile) {
+    return nullptr;
+  }
+  auto table = std::make_shared<Table>();
+  if (!table->readFromDisk(schemaFile)) {
+    std::cerr << "Corrupted schema file: " << schemaFilePath << std::endl;
+    return nullptr;
+  }
+  schemaFile.close();
+  auto layout = std::make_shared<const RowLayout>(std::move(table));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (versions[key] != loadVersion) {
+    // 读盘期间表结构被改写，这份快照只给本次调用使用，不放入缓存
+    return layout;
+  }
+  // 并发加载时以先放入的快照为准
+  auto [it, inserted] = entries.try_emplace(key);
+  if (inserted) {
+    it->second.layout = std::move(layout);
+    it->second.version = loadVersion;
+  }
+  return it->second.layout;
+}
+
+uint64_t SchemaCatalog::version(const std::string &dbName,
+                                const std::string &tableName) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return versions[makeKey(dbName, tableName)];
+}
+
+void SchemaCatalog::invalidate(const std::string &dbName,
+                               const std::string &tableName) {
+  std::string key = makeKey(dbName, tableName);
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.erase(key);
+  ++versions[key];
+}
+
+void SchemaCatalog::invalidateDatabase(const std::string &dbName) {
+  std::string prefix = dbName + '/';
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) {
+      ++versions[it->first];
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
@@ -70,6 +70,68 @@ void Table::writeToDisk(std::ofstream& outFile) const {
     }
 }
 
+bool Table::readFromDisk(std::ifstream& inFile) {
+    int numColumns = 0;
+    if (!inFile.read(reinterpret_cast<char*>(&numColumns), sizeof(numColumns))) {
+        return false;
+    }
+
+    columns.clear();
+    for (int i = 0; i < numColumns; i++) {
+        std::string name(32, '\0');
+        inFile.read(&name[0], 32);
+        name.erase(std::find(name.begin(), name.end(), '\0'), name.end());
+
+        std::string type(32, '\0');
+        inFile.read(&type[0], 32);
+        type.erase(std::find(type.begin(), type.end(), '\0'), type.end());
+
+        int length;
+        inFile.read(reinterpret_cast<char*>(&length), sizeof(length));
+        bool isPrimaryKey;
+        inFile.read(reinterpret_cast<char*>(&isPrimaryKey), sizeof(isPrimaryKey));
+        bool isNullable;
+        inFile.read(reinterpret_cast<char*>(&isNullable), sizeof(isNullable));
+
+        std::string defaultValue(32, '\0');
+        inFile.read(&defaultValue[0], 32);
+        defaultValue.erase(std::find(defaultValue.begin(), defaultValue.end(), '\0'), defaultValue.end());
+
+        if (!inFile) {
+            return false;
+        }
+        addColumn(name, type, length, isPrimaryKey, isNullable, defaultValue);
+    }
+
+    int numForeignKeys = 0;
+    inFile.read(reinterpret_cast<char*>(&numForeignKeys), sizeof(numForeignKeys));
+
+    foreignKeys.clear();
+    for (int i = 0; i < numForeignKeys && inFile; i++) {
+        std::string columnName(32, '\0');
+        inFile.read(&columnName[0], 32);
+        columnName.erase(std::find(columnName.begin(), columnName.end(), '\0'), columnName.end());
+
+        std::string referenceTable(32, '\0');
+        inFile.read(&referenceTable[0], 32);
+        referenceTable.erase(std::find(referenceTable.begin(), referenceTable.end(), '\0'), referenceTable.end());
+
+        std::string referenceColumn(32, '\0');
+        inFile.read(&referenceColumn[0], 32);
+        referenceColumn.erase(std::find(referenceColumn.begin(), referenceColumn.end(), '\0'), referenceColumn.end());
+
+        ForeignKeyAction onDelete;
+        inFile.read(reinterpret_cast<char*>(&onDelete), sizeof(onDelete));
+        ForeignKeyAction onUpdate;
+        inFile.read(reinterpret_cast<char*>(&onUpdate), sizeof(onUpdate));
+
+        if (inFile) {
+            addForeignKey(columnName, referenceTable, referenceColumn, onDelete, onUpdate);
+        }
+    }
+    return true;
+}
+
 void Table::addForeignKey(const std::string& columnName, const std::string& referenceTable, const std::string& referenceColumn, ForeignKeyAction onDelete, ForeignKeyAction onUpdate) {
     foreignKeys.push_back({ columnName, referenceTable, referenceColumn, onDelete, onUpdate });
 }
@@ -1,5 +1,823 @@
 #include "Entity/basic_function/TableManager.h"
 
+namespace {
+// 按字段名解析列下标（不存在的字段为 -1），只在语句开始时调用一次
+std::vector<int> resolveColumns(const RowLayout &layout,
+                                const std::vector<std::string> &names) {
+  std::vector<int> indexes;
+  indexes.reserve(names.size());
+  for (const auto &name : names) {
+    indexes.push_back(layout.columnIndex(name));
+  }
+  return indexes;
+}
+
+// 数据库的预写日志
+WriteAheadLog &logOf(const std::string &dbName) {
+  return WriteAheadLog::forDatabase(fs::current_path() / "DB" / dbName);
+}
+
+// 不经过日志的整表改写（DDL）之前先做检查点，日志中不会留下针对旧文件的记录
+bool checkpointDatabase(const std::string &dbName) {
+  if (!logOf(dbName).checkpoint()) {
+    std::cerr << "Failed to checkpoint database '" << dbName
+              << "'. Operation aborted." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// 打开表上的所有索引（主键索引在前），文件无效的从数据文件重建
+bool openIndexes(const fs::path &tableDirPath, const std::string &tableName,
+                 const std::shared_ptr<const RowLayout> &layout,
+                 const HeapFile &heap,
+                 std::vector<std::unique_ptr<TableIndex>> &indexes) {
+  indexes = TableIndex::forTable(tableDirPath, tableName, layout);
+  for (const auto &index : indexes) {
+    if (!index->open(heap)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// forTable 返回的索引中的主键索引（唯一索引总在最前面），表没有主键时返回 nullptr
+TableIndex *
+primaryIndex(const std::vector<std::unique_ptr<TableIndex>> &indexes) {
+  return !indexes.empty() && indexes[0]->tree().isUnique() ? indexes[0].get()
+                                                           : nullptr;
+}
+
+// 数据文件还没有 zone map 时扫描一遍建立，跟踪所有 integer / number 列
+void ensureZoneMap(HeapFile &heap, const RowLayout &layout) {
+  if (heap.zoneMap() != nullptr) {
+    return;
+  }
+  std::vector<ZoneMap::Column> columns;
+  for (int col = 0; col < layout.columnCount(); ++col) {
+    const RowLayout::Field &field = layout.field(col);
+    if (layout.isNumeric(col) && field.width >= 4) {
+      columns.push_back({static_cast<uint16_t>(field.offset),
+                         static_cast<uint16_t>(field.width),
+                         field.type == RowLayout::ColumnType::Number,
+                         {}});
+    }
+  }
+  if (!columns.empty()) {
+    heap.buildZoneMap(std::move(columns));
+  }
+}
+
+// 在线改写表的数据文件并重建表上的所有索引，cluster 为 true 时按主键顺序重新排列行
+bool rewriteTable(const std::string &dbName, const std::string &tableName,
+                  const std::shared_ptr<const RowLayout> &layout,
+                  const TableRewriter::Options &options, bool cluster,
+                  TableRewriter::Stats *stats) {
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
+  std::vector<std::unique_ptr<TableIndex>> indexes =
+      TableIndex::forTable(tableDirPath, tableName, layout);
+  TableIndex *pkIndex = primaryIndex(indexes);
+  TableRewriter::RowOrder order;
+  if (pkIndex && cluster) {
+    order = [&](std::vector<RowId> &rids) {
+      HeapFile heap(tableDirPath / (tableName + ".trd"), layout->rowWidth());
+      if (!heap.open() || !pkIndex->open(heap)) {
+        return false;
+      }
+      pkIndex->tree().scan(nullptr, true, nullptr, true,
+                           [&](const char *, RowId rid) {
+                             rids.push_back(rid);
+                             return true;
+                           });
+      return true;
+    };
+  }
+  TableRewriter rewriter(logOf(dbName), tableName, layout->rowWidth());
+  return rewriter.run(
+      options, order,
+      [&](const HeapFile &heap) {
+        for (const auto &index : indexes) {
+          if (!index->rebuild(heap)) {
+            TableIndex::invalidate(index->tree().path());
+          }
+        }
+      },
+      stats);
+}
+
+// 改列之后有列的类型或长度变了时，按新表结构 table 把数据文件改写到 tempPath（rewritten 置为
+// true）：变了的字段先转成文本再按新类型编码。有值无法转换为新类型、或字符串超出新长度时
+// 返回 false 并删掉临时文件，原数据文件不变
+bool convertColumns(const fs::path &dataFilePath, const fs::path &tempPath,
+                    const RowLayout &oldLayout, const Table &table,
+                    bool &rewritten) {
+  RowLayout newLayout(std::make_shared<const Table>(table));
+  std::vector<int> changed;
+  for (int col = 0; col < newLayout.columnCount(); ++col) {
+    if (oldLayout.type(col) != newLayout.type(col) ||
+        oldLayout.field(col).width != newLayout.field(col).width) {
+      changed.push_back(col);
+    }
+  }
+  rewritten = false;
+  if (changed.empty()) {
+    return true;
+  }
+
+  HeapFile inFile(dataFilePath, oldLayout.rowWidth());
+  HeapFile outFile(tempPath, newLayout.rowWidth());
+  if (!inFile.open() || !outFile.create()) {
+    std::cerr << "Failed to open files for processing." << std::endl;
+    return false;
+  }
+  std::vector<char> newRow(newLayout.rowWidth(), '\0');
+  bool converted = true;
+  bool scanned = inFile.forEachRow([&](const char *row, RowId) {
+    for (int col = 0; col < newLayout.columnCount(); ++col) {
+      const RowLayout::Field &from = oldLayout.field(col);
+      const RowLayout::Field &to = newLayout.field(col);
+      if (std::find(changed.begin(), changed.end(), col) == changed.end()) {
+        std::memcpy(newRow.data() + to.offset, row + from.offset, to.width);
+        continue;
+      }
+      // 全 0 的字段（NULL）原样保留
+      if (std::all_of(row + from.offset, row + from.offset + from.width,
+                      [](char c) { return c == '\0'; })) {
+        std::memset(newRow.data() + to.offset, 0, to.width);
+        continue;
+      }
+      std::string text = oldLayout.toString(row, col);
+      bool fits = newLayout.type(col) != RowLayout::ColumnType::Str ||
+                  text.size() <= static_cast<size_t>(to.width);
+      if (!fits || !newLayout.encodeField(newRow.data(), col, text)) {
+        std::cerr << "Value '" << text << "' of column '"
+                  << newLayout.table().columns[col].name
+                  << "' cannot be converted to "
+                  << newLayout.table().columns[col].type << "("
+                  << newLayout.table().columns[col].length << ")."
+                  << std::endl;
+        converted = false;
+        return false;
+      }
+    }
+    converted = outFile.appendRow(newRow.data());
+    return converted;
+  });
+  if (!scanned || !converted) {
+    HeapFile::discard(tempPath);
+    return false;
+  }
+  rewritten = true;
+  return true;
+}
+
+// WHERE 条件在索引键上对应的扫描范围
+struct KeyRange {
+  std::vector<char> low;
+  std::vector<char> high;
+  bool lowInclusive = true;
+  bool highInclusive = true;
+  std::vector<bool> covered; // 已由索引范围保证、不必再逐行判断的条件
+  size_t equalColumns = 0;   // 由 = 确定的前导索引列数
+  bool bounded = false;      // 紧接着的一列上是否还有范围条件
+};
+
+// 从 WHERE 条件中找出能走索引的部分：前面若干个索引列上都有 =（键的前缀），
+// 再加上紧接着那一列上的 <、<=、>、>=（字符串列只用 =）。找不到时返回 false，调用方退回全表扫描
+bool planIndexRange(TableIndex &index, const std::vector<int> &conditionIndex,
+                    const std::vector<std::string> &operation,
+                    const std::vector<std::string> &conditionValue,
+                    KeyRange &range) {
+  const RowLayout &layout = index.layout();
+  const std::vector<int> &keyColumns = index.columns();
+  range.covered.assign(conditionIndex.size(), false);
+
+  auto indexable = [&layout](int col, const std::string &op,
+                             const std::string &value) {
+    RowLayout::ColumnType type = layout.type(col);
+    if (type == RowLayout::ColumnType::Str) {
+      return op == "=" && value.size() <= static_cast<size_t>(
+                                               layout.field(col).width);
+    }
+    return layout.isNumeric(col) && (op == "=" || op == "<" || op == "<=" ||
+                                     op == ">" || op == ">=");
+  };
+
+  std::vector<std::string> values;
+  std::vector<char> key;
+  for (int col : keyColumns) {
+    bool bound = false;
+    for (size_t i = 0; i < conditionIndex.size() && !bound; ++i) {
+      if (conditionIndex[i] != col || operation[i] != "=" ||
+          !indexable(col, operation[i], conditionValue[i])) {
+        continue;
+      }
+      values.push_back(conditionValue[i]);
+      if (index.encodePrefix(values, false, key)) {
+        range.covered[i] = true;
+        bound = true;
+      } else {
+        values.pop_back();
+      }
+    }
+    if (!bound) {
+      break;
+    }
+  }
+  range.equalColumns = values.size();
+  if (values.size() == keyColumns.size()) {
+    index.encodeKey(values, range.low);
+    range.high = range.low;
+    return true;
+  }
+
+  // 多个条件落在下一列上时取交集；不含等号的下界和含等号的上界其余列填最大值，
+  // 另外两种填最小值
+  BPlusTree &tree = index.tree();
+  int col = keyColumns[values.size()];
+  values.emplace_back();
+  for (size_t i = 0; i < conditionIndex.size(); ++i) {
+    const std::string &op = operation[i];
+    if (conditionIndex[i] != col || op == "=" ||
+        !indexable(col, op, conditionValue[i])) {
+      continue;
+    }
+    values.back() = conditionValue[i];
+    bool lower = op == ">" || op == ">=";
+    bool inclusive = op == ">=" || op == "<=";
+    if (!index.encodePrefix(values, lower != inclusive, key)) {
+      continue;
+    }
+    if (lower) {
+      int cmp = range.low.empty() ? 1 : tree.compareKeys(key.data(),
+                                                         range.low.data());
+      if (cmp > 0 || (cmp == 0 && !inclusive)) {
+        range.low = key;
+        range.lowInclusive = inclusive;
+      }
+    } else {
+      int cmp = range.high.empty() ? -1 : tree.compareKeys(key.data(),
+                                                           range.high.data());
+      if (cmp < 0 || (cmp == 0 && !inclusive)) {
+        range.high = key;
+        range.highInclusive = inclusive;
+      }
+    }
+    range.covered[i] = true;
+    range.bounded = true;
+  }
+  values.pop_back();
+  if (values.empty()) {
+    return range.bounded;
+  }
+  // 前缀之外没有界的一侧扫到前缀的边界为止
+  if (range.low.empty()) {
+    index.encodePrefix(values, false, range.low);
+  }
+  if (range.high.empty()) {
+    index.encodePrefix(values, true, range.high);
+  }
+  return true;
+}
+
+// 在表的各个索引中挑出 WHERE 条件用得最充分的一个：唯一索引的整个键都由 = 确定时直接选它，
+// 否则比较由 = 确定的前导列数，再看下一列上有没有范围条件；都用不上时返回 nullptr。
+// 给出 needed 时只考虑键中包含这些列的索引（可以只读索引、不回表）
+TableIndex *
+chooseIndex(const std::vector<std::unique_ptr<TableIndex>> &indexes,
+            const std::vector<int> &conditionIndex,
+            const std::vector<std::string> &operation,
+            const std::vector<std::string> &conditionValue, KeyRange &range,
+            const std::vector<int> *needed = nullptr) {
+  TableIndex *best = nullptr;
+  for (const auto &index : indexes) {
+    KeyRange candidate;
+    if ((needed != nullptr &&
+         !std::all_of(needed->begin(), needed->end(),
+                      [&](int col) { return index->covers(col); })) ||
+        !planIndexRange(*index, conditionIndex, operation, conditionValue,
+                        candidate)) {
+      continue;
+    }
+    if (best == nullptr ||
+        candidate.equalColumns > range.equalColumns ||
+        (candidate.equalColumns == range.equalColumns && candidate.bounded &&
+         !range.bounded)) {
+      best = index.get();
+      range = std::move(candidate);
+    }
+    if (best->tree().isUnique() &&
+        range.equalColumns == best->columns().size()) {
+      break;
+    }
+  }
+  return best;
+}
+
+// 取出索引范围内的全部 RowId，按页顺序排列，回表时每页只读一次
+std::vector<RowId> collectRowIds(TableIndex &index, const KeyRange &range) {
+  std::vector<RowId> rids;
+  index.tree().scan(
+      range.low.empty() ? nullptr : range.low.data(), range.lowInclusive,
+      range.high.empty() ? nullptr : range.high.data(), range.highInclusive,
+      [&](const char *, RowId rid) {
+        rids.push_back(rid);
+        return true;
+      });
+  std::sort(rids.begin(), rids.end(), [](RowId a, RowId b) {
+    return a.pageNo != b.pageNo ? a.pageNo < b.pageNo : a.slot < b.slot;
+  });
+  return rids;
+}
+
+// 只读索引的扫描：用键拼出只含索引列的行，剩余条件也只涉及这些列，不读数据文件。
+// 唯一索引按键的顺序输出，取够 wanted 行即停；
+// 其他索引按 RowId 排序，结果的顺序与全表扫描相同
+std::unique_ptr<ResultSet::Source> scanIndexOnly(TableIndex &index,
+                                                 const KeyRange &range,
+                                                 Predicate where,
+                                                 size_t wanted) {
+  where.removeCovered(range.covered);
+  int rowWidth = index.layout().rowWidth();
+  bool unique = index.tree().isUnique();
+  std::vector<char> row(rowWidth, '\0');
+  std::vector<char> rows;
+  std::vector<std::pair<RowId, size_t>> order;
+  index.tree().scan(
+      range.low.empty() ? nullptr : range.low.data(), range.lowInclusive,
+      range.high.empty() ? nullptr : range.high.data(), range.highInclusive,
+      [&](const char *key, RowId rid) {
+        index.rowFromKey(key, row.data());
+        if (where.matches(row.data())) {
+          order.emplace_back(rid, rows.size());
+          rows.insert(rows.end(), row.begin(), row.end());
+        }
+        return !unique || order.size() < wanted;
+      });
+  if (!unique) {
+    std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+      return a.first.pageNo != b.first.pageNo ? a.first.pageNo < b.first.pageNo
+                                              : a.first.slot < b.first.slot;
+    });
+  }
+  auto spool = std::make_unique<SpoolSource>(std::vector<int>{rowWidth});
+  for (const auto &entry : order) {
+    const char *tuple = rows.data() + entry.second;
+    spool->append(&tuple);
+  }
+  return spool;
+}
+
+// 外键的探测器：在被引用列的索引上查值是否存在，不扫描引用表
+struct ForeignKeyProbe {
+  int column;
+  const Table::ForeignKey *fk;
+  std::shared_ptr<const RowLayout> refLayout;
+  int refColumn;
+  std::unique_ptr<TableIndex> index;
+
+  // 把文本按被引用列的类型编码成索引键。比被引用列更长的字符串不可能有匹配，
+  // 不能截断后去查，否则会匹配上它的前缀
+  bool keyFromText(const std::string &value, std::vector<char> &scratch,
+                   char *key) const {
+    const RowLayout::Field &field = refLayout->field(refColumn);
+    if (field.type == RowLayout::ColumnType::Str &&
+        value.size() > static_cast<size_t>(field.width)) {
+      return false;
+    }
+    scratch.assign(refLayout->rowWidth(), '\0');
+    if (!refLayout->encodeField(scratch.data(), refColumn, value)) {
+      return false;
+    }
+    std::memcpy(key, scratch.data() + field.offset, field.width);
+    return true;
+  }
+
+  // 已编码的行：两列类型和宽度相同时直接取字节，否则经文本转换
+  bool keyFromRow(const RowLayout &layout, const char *row,
+                  std::vector<char> &scratch, char *key) const {
+    const RowLayout::Field &field = layout.field(column);
+    const RowLayout::Field &refField = refLayout->field(refColumn);
+    if (field.type == refField.type && field.width == refField.width) {
+      std::memcpy(key, row + field.offset, field.width);
+      return true;
+    }
+    return keyFromText(layout.toString(row, column), scratch, key);
+  }
+
+  // 探测一批值：keyOf(i, key) 取出第 i 个值的键，无法编码时返回 false（视为不存在）。
+  // 键排序后按键序查索引，相同的值只查一次，索引页也按顺序访问；found[i] 为 0 表示不存在
+  template <typename KeyOf>
+  void probe(size_t count, KeyOf &&keyOf, std::vector<char> &found) {
+    BPlusTree &tree = index->tree();
+    size_t width = tree.keyWidth();
+    std::vector<char> keys(count * width);
+    std::vector<uint32_t> order;
+    found.assign(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+      if (keyOf(i, keys.data() + i * width)) {
+        order.push_back(static_cast<uint32_t>(i));
+      }
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return tree.compareKeys(keys.data() + a * width,
+                              keys.data() + b * width) < 0;
+    });
+    const char *previous = nullptr;
+    bool present = false;
+    for (uint32_t i : order) {
+      const char *key = keys.data() + i * width;
+      if (previous == nullptr || tree.compareKeys(key, previous) != 0) {
+        present = tree.contains(key);
+        previous = key;
+      }
+      found[i] = present;
+    }
+  }
+};
+
+// 为表的每个外键打开被引用列的索引，索引文件还没有时从引用表的数据文件建立
+bool loadForeignKeyProbes(const std::string &dbName, const RowLayout &layout,
+                          std::vector<ForeignKeyProbe> &probes) {
+  for (const auto &fk : layout.table().foreignKeys) {
+    int colIdx = layout.columnIndex(fk.columnName);
+    if (colIdx == -1) {
+      std::cerr << "Foreign key column '" << fk.columnName
+                << "' not found in table schema." << std::endl;
+      return false;
+    }
+    std::shared_ptr<const RowLayout> refLayout =
+        SchemaCatalog::instance().getLayout(dbName, fk.referenceTable);
+    if (!refLayout) {
+      std::cerr << "Error loading reference table schema: "
+                << fk.referenceTable << std::endl;
+      return false;
+    }
+    int refColumn = refLayout->columnIndex(fk.referenceColumn);
+    if (refColumn == -1) {
+      std::cerr << "Reference column '" << fk.referenceColumn
+                << "' not found in reference table schema." << std::endl;
+      return false;
+    }
+
+    fs::path refDirPath =
+        fs::current_path() / "DB" / dbName / fk.referenceTable;
+    HeapFile refFile(refDirPath / (fk.referenceTable + ".trd"),
+                     refLayout->rowWidth());
+    std::unique_ptr<TableIndex> index = TableIndex::forColumn(
+        refDirPath, fk.referenceTable, refLayout, refColumn);
+    if (!refFile.open() || !index->open(refFile)) {
+      std::cerr << "Failed to open index on reference column '"
+                << fk.referenceTable << "." << fk.referenceColumn << "'."
+                << std::endl;
+      return false;
+    }
+    probes.push_back({colIdx, &fk, refLayout, refColumn, std::move(index)});
+  }
+  return true;
+}
+
+// 引用某张表的一个外键：子表（可能就是父表自己）、子表中的外键列和父表中被引用的列
+struct ReferencingKey {
+  std::string table;
+  std::shared_ptr<const RowLayout> layout;
+  const Table::ForeignKey *fk;
+  int column;
+  int refColumn;
+};
+
+// 找出数据库中引用 tableName 的所有外键
+std::vector<ReferencingKey> findReferencingKeys(const std::string &dbName,
+                                                const std::string &tableName,
+                                                const RowLayout &layout) {
+  std::vector<ReferencingKey> keys;
+  std::error_code ec;
+  for (const auto &entry :
+       fs::directory_iterator(fs::current_path() / "DB" / dbName, ec)) {
+    if (!entry.is_directory()) {
+      continue;
+    }
+    std::string child = entry.path().filename().string();
+    std::shared_ptr<const RowLayout> childLayout =
+        SchemaCatalog::instance().getLayout(dbName, child);
+    if (!childLayout) {
+      continue;
+    }
+    for (const auto &fk : childLayout->table().foreignKeys) {
+      int column = childLayout->columnIndex(fk.columnName);
+      int refColumn = layout.columnIndex(fk.referenceColumn);
+      if (fk.referenceTable == tableName && column != -1 && refColumn != -1) {
+        keys.push_back({child, childLayout, &fk, column, refColumn});
+      }
+    }
+  }
+  return keys;
+}
+
+// 写语句要锁住的表（见 WriteAheadLog::lockTables）：本表和它引用的表（外键检查读它们的索引）；
+// cascading 为 true 时（删除、更新）再加上经外键动作可能改到的所有子表
+std::vector<std::string>
+tablesToLock(const std::string &dbName, const std::string &tableName,
+             const std::shared_ptr<const RowLayout> &layout, bool cascading) {
+  std::vector<std::string> tables{tableName};
+  for (const auto &fk : layout->table().foreignKeys) {
+    tables.push_back(fk.referenceTable);
+  }
+  if (!cascading) {
+    return tables;
+  }
+  std::vector<std::pair<std::string, std::shared_ptr<const RowLayout>>> parents{
+      {tableName, layout}};
+  for (size_t i = 0; i < parents.size(); ++i) {
+    for (const ReferencingKey &ref :
+         findReferencingKeys(dbName, parents[i].first, *parents[i].second)) {
+      if (std::none_of(parents.begin(), parents.end(),
+                       [&](const auto &p) { return p.first == ref.table; })) {
+        parents.emplace_back(ref.table, ref.layout);
+        tables.push_back(ref.table);
+      }
+    }
+  }
+  return tables;
+}
+
+// 外键动作对一张子表做出的修改，日志提交之后据此维护子表的索引
+struct ChildChanges {
+  std::shared_ptr<const RowLayout> layout;
+  std::vector<RowId> rids;
+  std::vector<char> oldRows;
+  std::vector<char> newRows; // 被删除的行全为 0
+  std::vector<char> deleted;
+};
+using ReferentialChanges = std::map<std::string, ChildChanges>;
+
+constexpr int MAX_CASCADE_DEPTH = 15; // 级联动作最多传递的层数
+
+// 父表的一组行被删除（updated 为空），或这些行的 updated 列被改成 newRow 中的值之后，
+// 对引用它们的子表执行外键动作。每个外键先收集被删掉或改掉的键，排序去重后在子表外键列的
+// 索引上一次查出全部引用行，按页序逐行处理；修改记在 txn 中，随调用方的语句一起提交。
+// 级联删除和被改掉的外键列会继续作用到子表的子表
+bool applyForeignKeyActions(const std::string &dbName,
+                            const std::string &tableName,
+                            const std::shared_ptr<const RowLayout> &layout,
+                            const std::vector<char> &oldRows,
+                            const std::vector<RowId> &rids,
+                            const std::vector<int> &updated,
+                            const char *newRow, WriteAheadLog::Transaction &txn,
+                            ReferentialChanges &changes, int depth = 0) {
+  if (rids.empty()) {
+    return true;
+  }
+  std::vector<ReferencingKey> referencing =
+      findReferencingKeys(dbName, tableName, *layout);
+  if (referencing.empty()) {
+    return true;
+  }
+  if (depth >= MAX_CASCADE_DEPTH) {
+    std::cerr << "Foreign key cascade exceeds " << MAX_CASCADE_DEPTH
+              << " levels at table '" << tableName << "'." << std::endl;
+    return false;
+  }
+
+  int rowWidth = layout->rowWidth();
+  bool deleting = updated.empty();
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
+  HeapFile heap(tableDirPath / (tableName + ".trd"), rowWidth);
+  auto pack = [](RowId rid) {
+    return static_cast<uint64_t>(rid.pageNo) << 32 | rid.slot;
+  };
+  std::unordered_set<uint64_t> removed;
+  for (RowId rid : rids) {
+    removed.insert(pack(rid));
+  }
+  std::vector<char> parentRow(rowWidth, '\0');
+
+  for (const ReferencingKey &ref : referencing) {
+    if (!deleting && std::find(updated.begin(), updated.end(),
+                               ref.refColumn) == updated.end()) {
+      continue;
+    }
+    Table::ForeignKeyAction action =
+        deleting ? ref.fk->onDelete : ref.fk->onUpdate;
+
+    // 被删掉或改掉的键（父表中被引用列的字段字节），排序去重
+    const RowLayout::Field &field = layout->field(ref.refColumn);
+    std::vector<std::string> keys;
+    for (size_t r = 0; r < rids.size(); ++r) {
+      const char *value = oldRows.data() + r * rowWidth + field.offset;
+      if (deleting ||
+          std::memcmp(value, newRow + field.offset, field.width) != 0) {
+        keys.emplace_back(value, field.width);
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    // 被引用列不唯一时，父表中还有别的行持有同一个键，这个键并没有消失
+    std::unique_ptr<TableIndex> parentIndex =
+        TableIndex::forColumn(tableDirPath, tableName, layout, ref.refColumn);
+    if (!parentIndex->tree().isUnique()) {
+      if (!heap.open() || !parentIndex->open(heap)) {
+        return false;
+      }
+      auto survives = [&](const std::string &key) {
+        bool found = false;
+        parentIndex->tree().lookup(key.data(), [&](const char *, RowId rid) {
+          bool gone = false;
+          txn.pendingRow(tableName, rid, gone);
+          found = !gone && removed.count(pack(rid)) == 0;
+          return !found;
+        });
+        return found;
+      };
+      keys.erase(std::remove_if(keys.begin(), keys.end(), survives),
+                 keys.end());
+    }
+    if (keys.empty()) {
+      continue;
+    }
+
+    // 在子表外键列的索引上查出所有引用这些键的行（索引第一次使用时建立）
+    fs::path childDirPath = fs::current_path() / "DB" / dbName / ref.table;
+    const RowLayout &childLayout = *ref.layout;
+    int childWidth = childLayout.rowWidth();
+    HeapFile childHeap(childDirPath / (ref.table + ".trd"), childWidth);
+    std::unique_ptr<TableIndex> childIndex = TableIndex::forColumn(
+        childDirPath, ref.table, ref.layout, ref.column);
+    if (!childHeap.open() || !childIndex->open(childHeap)) {
+      std::cerr << "Failed to open index on foreign key column '" << ref.table
+                << "." << ref.fk->columnName << "'." << std::endl;
+      return false;
+    }
+    std::vector<std::pair<RowId, std::vector<char>>> targets;
+    std::vector<char> childKey;
+    for (const std::string &key : keys) {
+      std::memcpy(parentRow.data() + field.offset, key.data(), field.width);
+      if (!childIndex->encodeKey({layout->toString(parentRow.data(),
+                                                   ref.refColumn)},
+                                 childKey)) {
+        continue; // 子表的列放不下这个值，不可能有行引用它
+      }
+      childIndex->tree().lookup(childKey.data(), [&](const char *, RowId rid) {
+        targets.emplace_back(rid, childKey);
+        return true;
+      });
+    }
+    if (targets.empty()) {
+      continue;
+    }
+    if (action == Table::ForeignKeyAction::RESTRICT ||
+        action == Table::ForeignKeyAction::NOACTION) {
+      // 同一语句已经删掉或改走的子行不算
+      bool referenced = std::any_of(
+          targets.begin(), targets.end(), [&](const auto &target) {
+            bool gone = false;
+            const char *pending = txn.pendingRow(ref.table, target.first, gone);
+            return !gone && (pending == nullptr ||
+                             childIndex->tree().compareKeys(
+                                 pending + childLayout.field(ref.column).offset,
+                                 target.second.data()) == 0);
+          });
+      if (referenced) {
+        std::cerr << "Foreign key constraint violation: rows in '"
+                  << ref.table << "' still reference '" << tableName << "."
+                  << ref.fk->referenceColumn << "'." << std::endl;
+        return false;
+      }
+      continue;
+    }
+    std::sort(targets.begin(), targets.end(),
+              [](const auto &a, const auto &b) {
+                return a.first.pageNo != b.first.pageNo
+                           ? a.first.pageNo < b.first.pageNo
+                           : a.first.slot < b.first.slot;
+              });
+
+    // 更新和置空动作写入外键列的新值，对所有行都相同，只编码一次
+    std::string newValue;
+    if (action == Table::ForeignKeyAction::CASCADE && !deleting) {
+      newValue = layout->toString(newRow, ref.refColumn);
+    } else if (action == Table::ForeignKeyAction::SET_DEFAULT) {
+      newValue = childLayout.table().columns[ref.column].defaultValue;
+    }
+    std::vector<char> valueRow(childWidth, '\0');
+    if (!childLayout.encodeField(valueRow.data(), ref.column, newValue)) {
+      childLayout.encodeField(valueRow.data(), ref.column, "");
+    }
+    bool erase = action == Table::ForeignKeyAction::CASCADE && deleting;
+    const RowLayout::Field &childField = childLayout.field(ref.column);
+
+    ChildChanges &changed = changes[ref.table];
+    changed.layout = ref.layout;
+    std::vector<char> cascadedRows;
+    std::vector<RowId> cascadedRids;
+    std::vector<char> row(childWidth);
+    for (const auto &target : targets) {
+      RowId rid = target.first;
+      bool gone = false;
+      const char *pending = txn.pendingRow(ref.table, rid, gone);
+      if (gone) {
+        continue;
+      }
+      if (pending != nullptr) {
+        std::memcpy(row.data(), pending, childWidth);
+      } else if (!childHeap.withRow(rid, [&](const char *current) {
+                   std::memcpy(row.data(), current, childWidth);
+                 })) {
+        continue;
+      }
+      // 同一语句前面的动作可能已经改掉了这一行的外键列
+      if (childIndex->tree().compareKeys(row.data() + childField.offset,
+                                         target.second.data()) != 0) {
+        continue;
+      }
+
+      changed.rids.push_back(rid);
+      changed.oldRows.insert(changed.oldRows.end(), row.begin(), row.end());
+      cascadedRows.insert(cascadedRows.end(), row.begin(), row.end());
+      cascadedRids.push_back(rid);
+      if (erase) {
+        txn.erase(ref.table, childHeap, rid);
+        changed.newRows.resize(changed.newRows.size() + childWidth, '\0');
+        changed.deleted.push_back(1);
+        continue;
+      }
+      std::memcpy(row.data() + childField.offset,
+                  valueRow.data() + childField.offset, childField.width);
+      txn.update(ref.table, childHeap, rid, row.data());
+      changed.newRows.insert(changed.newRows.end(), row.begin(), row.end());
+      changed.deleted.push_back(0);
+    }
+
+    if (!applyForeignKeyActions(
+            dbName, ref.table, ref.layout, cascadedRows, cascadedRids,
+            erase ? std::vector<int>{} : std::vector<int>{ref.column},
+            valueRow.data(), txn, changes, depth + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 日志提交之后，按外键动作做出的修改维护各个子表的索引；
+// 索引文件已经失效的不用管，下一次使用时会从提交后的数据文件重建
+void maintainChildIndexes(const std::string &dbName,
+                          const ReferentialChanges &changes) {
+  for (const auto &entry : changes) {
+    const std::string &table = entry.first;
+    const ChildChanges &changed = entry.second;
+    if (changed.rids.empty()) {
+      continue;
+    }
+    int width = changed.layout->rowWidth();
+    fs::path tableDirPath = fs::current_path() / "DB" / dbName / table;
+    for (const auto &index :
+         TableIndex::forTable(tableDirPath, table, changed.layout)) {
+      if (!index->tree().open()) {
+        continue;
+      }
+      std::vector<char> oldKey(index->tree().keyWidth());
+      std::vector<char> newKey(index->tree().keyWidth());
+      for (size_t r = 0; r < changed.rids.size(); ++r) {
+        const char *oldRow = changed.oldRows.data() + r * width;
+        const char *newRow = changed.newRows.data() + r * width;
+        if (!changed.deleted[r]) {
+          index->makeKey(oldRow, oldKey.data());
+          index->makeKey(newRow, newKey.data());
+          if (std::memcmp(oldKey.data(), newKey.data(), oldKey.size()) == 0) {
+            continue;
+          }
+        }
+        index->erase(oldRow, changed.rids[r]);
+        if (!changed.deleted[r]) {
+          index->insert(newRow, changed.rids[r]);
+        }
+      }
+      index->flush();
+    }
+  }
+}
+} // namespace
+
+TableManager::TableManager() {
+  setParallelism(0);
+
+  // 上次进程没有正常退出时，日志中的修改可能还没写进数据文件，先重做
+  std::error_code ec;
+  for (const auto &entry :
+       fs::directory_iterator(fs::current_path() / "DB", ec)) {
+    if (!entry.is_directory() || !fs::exists(entry.path() / "wal.log")) {
+      continue;
+    }
+    WriteAheadLog &wal = WriteAheadLog::forDatabase(entry.path());
+    // 重做或中断导入的表，索引和 zone map 都可能落后于数据页，一并重建
+    for (const auto &table : wal.takeRecoveredTables()) {
+      TableIndex::invalidateAll(entry.path() / table);
+      ZoneMap::remove(entry.path() / table / (table + ".trd"));
+    }
+  }
+}
+
 void TableManager::createTable(
     const std::string &dbName, const std::string &tableName,
     const std::vector<std::string> &columnNames,
@@ -10,6 +828,9 @@ void TableManager::createTable(
     const std::vector<std::string> &defaultValues,
     const std::vector<Table::ForeignKey> &foreignKeys,
     const std::string &createStatement) {
+  if (!checkpointDatabase(dbName)) {
+    return;
+  }
   // 构建数据库路径
   fs::path dbPath = fs::current_path() / "DB" / dbName;
   fs::create_directories(dbPath); // 确保数据库目录存在
@@ -39,12 +860,23 @@ void TableManager::createTable(
   std::ofstream schemaFile(schemaFilePath, std::ios::binary);
   table.writeToDisk(schemaFile);
   schemaFile.close();
+  SchemaCatalog::instance().invalidate(dbName, tableName);
 
-  // 创建数据文件和约束文件
+  // 创建数据文件和约束文件（同名表被删除过时丢弃残留的缓存页）
+  BufferPool::instance().dropFile(dataFilePath);
+  BufferPool::instance().dropFile(constraintFilePath);
   std::ofstream dataFile(dataFilePath, std::ios::binary);
   std::ofstream constraintFile(constraintFilePath, std::ios::binary);
   dataFile.close();
   constraintFile.close();
+  ZoneMap::remove(dataFilePath);
+  if (std::shared_ptr<const RowLayout> layout =
+          getRowLayout(dbName, tableName)) {
+    HeapFile heap(dataFilePath, layout->rowWidth());
+    if (heap.open()) {
+      ensureZoneMap(heap, *layout);
+    }
+  }
   // 创建备份表文件
   std::filesystem::path redbPath =
       std::filesystem::current_path() / "Recover" / dbName;
@@ -64,12 +896,18 @@ void TableManager::createTable(
 
 void TableManager::deleteTable(const std::string &dbName,
                                const std::string &tableName) {
+  if (!checkpointDatabase(dbName)) {
+    return;
+  }
   // 构建表路径
   fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
 
   // 尝试删除表文件夹及其所有文件
   std::error_code ec; // 使用error_code避免异常
-  if (fs::remove_all(tableDirPath, ec) == 0u) {
+  BufferPool::instance().dropDirectory(tableDirPath);
+  std::uintmax_t removed = fs::remove_all(tableDirPath, ec);
+  SchemaCatalog::instance().invalidate(dbName, tableName);
+  if (removed == 0u || ec) {
     std::cerr << "Failed to delete table. Error: " << ec.message() << std::endl;
   } else {
     std::cout << "Table '" << tableName << "' deleted successfully."
@@ -79,168 +917,337 @@ void TableManager::deleteTable(const std::string &dbName,
 
 bool TableManager::loadTableSchema(const std::string &dbName,
                                    const std::string &tableName, Table &table) {
-  fs::path schemaFilePath =
-      fs::current_path() / "DB" / dbName / tableName / (tableName + ".tdf");
-  std::ifstream schemaFile(schemaFilePath, std::ios::binary);
-  if (!schemaFile) {
+  std::shared_ptr<const Table> schema =
+      SchemaCatalog::instance().getSchema(dbName, tableName);
+  if (!schema) {
     std::cerr << "Failed to open schema file." << std::endl;
     return false;
   }
+  table = *schema;
+  return true;
+}
 
-  int numColumns;
-  schemaFile.read(reinterpret_cast<char *>(&numColumns), sizeof(numColumns));
-
-  table.columns.clear();
-  for (int i = 0; i < numColumns; i++) {
-    std::string name(32, '\0');
-    schemaFile.read(&name[0], 32);
-    name.erase(std::find(name.begin(), name.end(), '\0'), name.end());
-
-    std::string type(32, '\0');
-    schemaFile.read(&type[0], 32);
-    type.erase(std::find(type.begin(), type.end(), '\0'), type.end());
-
-    int length;
-    schemaFile.read(reinterpret_cast<char *>(&length), sizeof(length));
-
-    bool isPrimaryKey;
-    schemaFile.read(reinterpret_cast<char *>(&isPrimaryKey),
-                    sizeof(isPrimaryKey));
-
-    bool isNullable;
-    schemaFile.read(reinterpret_cast<char *>(&isNullable), sizeof(isNullable));
-
-    std::string defaultValue(32, '\0');
-    schemaFile.read(&defaultValue[0], 32);
-    defaultValue.erase(
-        std::find(defaultValue.begin(), defaultValue.end(), '\0'),
-        defaultValue.end());
-
-    table.addColumn(name, type, length, isPrimaryKey, isNullable, defaultValue);
+std::shared_ptr<const Table>
+TableManager::getTableSchema(const std::string &dbName,
+                             const std::string &tableName) {
+  std::shared_ptr<const Table> schema =
+      SchemaCatalog::instance().getSchema(dbName, tableName);
+  if (!schema) {
+    std::cerr << "Failed to open schema file." << std::endl;
   }
+  return schema;
+}
 
-  int numForeignKeys;
-  schemaFile.read(reinterpret_cast<char *>(&numForeignKeys),
-                  sizeof(numForeignKeys));
-
-  table.foreignKeys.clear();
-  for (int i = 0; i < numForeignKeys; i++) {
-    std::string columnName(32, '\0');
-    schemaFile.read(&columnName[0], 32);
-    columnName.erase(std::find(columnName.begin(), columnName.end(), '\0'),
-                     columnName.end());
-
-    std::string referenceTable(32, '\0');
-    schemaFile.read(&referenceTable[0], 32);
-    referenceTable.erase(
-        std::find(referenceTable.begin(), referenceTable.end(), '\0'),
-        referenceTable.end());
-
-    std::string referenceColumn(32, '\0');
-    schemaFile.read(&referenceColumn[0], 32);
-    referenceColumn.erase(
-        std::find(referenceColumn.begin(), referenceColumn.end(), '\0'),
-        referenceColumn.end());
-
-    Table::ForeignKeyAction onDelete;
-    schemaFile.read(reinterpret_cast<char *>(&onDelete), sizeof(onDelete));
-
-    Table::ForeignKeyAction onUpdate;
-    schemaFile.read(reinterpret_cast<char *>(&onUpdate), sizeof(onUpdate));
-
-    table.addForeignKey(columnName, referenceTable, referenceColumn, onDelete,
-                        onUpdate);
+std::shared_ptr<const RowLayout>
+TableManager::getRowLayout(const std::string &dbName,
+                           const std::string &tableName) {
+  std::shared_ptr<const RowLayout> layout =
+      SchemaCatalog::instance().getLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Failed to open schema file." << std::endl;
   }
-
-  schemaFile.close();
-  return true;
+  return layout;
 }
 
 void TableManager::insertRecord(const std::string &dbName,
                                 const std::string &tableName,
                                 const std::vector<std::string> &recordData) {
-  // 构建表结构文件路径
-  fs::path schemaFilePath =
-      fs::current_path() / "DB" / dbName / tableName / (tableName + ".tdf");
-  fs::path dataFilePath =
-      fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
+  insertRecords(dbName, tableName, {recordData});
+}
 
-  Table table;
-  if (!loadTableSchema(dbName, tableName, table)) {
+bool TableManager::insertRecords(
+    const std::string &dbName, const std::string &tableName,
+    const std::vector<std::vector<std::string>> &records) {
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
+  fs::path dataFilePath = tableDirPath / (tableName + ".trd");
+
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
     std::cerr << "Error loading table schema. Insert operation aborted."
               << std::endl;
-    return;
+    return false;
   }
+  const Table &table = layout->table();
+  int rowWidth = layout->rowWidth();
 
-  if (recordData.size() != table.columns.size()) {
-    std::cerr
-        << "Error: Record data does not match the number of table columns."
-        << std::endl;
-    return;
+  // 多行插入时错误信息带上行号
+  auto rowLabel = [&records](size_t row) {
+    return records.size() > 1 ? " (row " + std::to_string(row + 1) + ")"
+                              : std::string();
+  };
+
+  std::vector<ForeignKeyProbe> probes;
+  if (!loadForeignKeyProbes(dbName, *layout, probes)) {
+    return false;
   }
 
-  // 检查外键约束
-  for (const auto &fk : table.foreignKeys) {
-    int colIdx = -1;
-    for (size_t i = 0; i < table.columns.size(); ++i) {
-      if (table.columns[i].name == fk.columnName) {
-        colIdx = i;
-        break;
-      }
-    }
-    if (colIdx == -1) {
-      std::cerr << "Foreign key column '" << fk.columnName
-                << "' not found in table schema." << std::endl;
-      return;
+  for (size_t r = 0; r < records.size(); ++r) {
+    if (records[r].size() != table.columns.size()) {
+      std::cerr
+          << "Error: Record data does not match the number of table columns"
+          << rowLabel(r) << "." << std::endl;
+      return false;
     }
+  }
 
-    // 检查引用的表中是否存在对应的外键值
-    if (!checkForeignKeyConstraint(dbName, fk.referenceTable,
-                                   fk.referenceColumn, recordData[colIdx],
-                                   table.columns[colIdx].type)) {
+  // 每个外键把所有行的值一起在被引用列的索引上探测
+  std::vector<char> refBuffer;
+  std::vector<char> found;
+  for (auto &probe : probes) {
+    probe.probe(
+        records.size(),
+        [&](size_t r, char *key) {
+          return probe.keyFromText(records[r][probe.column], refBuffer, key);
+        },
+        found);
+    size_t r = std::find(found.begin(), found.end(), 0) - found.begin();
+    if (r < records.size()) {
       std::cerr << "Foreign key constraint violation: value '"
-                << recordData[colIdx] << "' for column '" << fk.columnName
-                << "' does not exist in reference table '" << fk.referenceTable
-                << "'." << std::endl;
-      return;
+                << records[r][probe.column] << "' for column '"
+                << probe.fk->columnName
+                << "' does not exist in reference table '"
+                << probe.fk->referenceTable << "'" << rowLabel(r) << "."
+                << std::endl;
+      return false;
     }
   }
 
-  std::vector<std::string> effectiveData = recordData;
-  std::fstream dataFile(dataFilePath, std::ios::in | std::ios::out |
-                                          std::ios::binary | std::ios::app);
-  if (!dataFile) {
-    std::cerr << "Failed to open data file for writing." << std::endl;
-    return;
-  }
+  // 全部行先编码进一块连续缓冲区，任何一行不合法整条语句都不生效
+  std::vector<char> rows(records.size() * rowWidth, '\0');
+  for (size_t r = 0; r < records.size(); ++r) {
+    const std::vector<std::string> &recordData = records[r];
+    char *row = rows.data() + r * rowWidth;
+    for (int i = 0; i < layout->columnCount(); i++) {
+      const std::string *value = &recordData[i];
+      if (value->empty() && !table.columns[i].isNullable) {
+        if (!table.columns[i].defaultValue.empty()) {
+          value = &table.columns[i].defaultValue;
+        } else {
+          std::cerr << "Non-nullable column '" << table.columns[i].name
+                    << "' must have a value" << rowLabel(r) << "."
+                    << std::endl;
+          return false;
+        }
+      }
 
-  for (size_t i = 0; i < table.columns.size(); i++) {
-    if (effectiveData[i].empty() && !table.columns[i].isNullable) {
-      if (!table.columns[i].defaultValue.empty()) {
-        effectiveData[i] = table.columns[i].defaultValue;
-      } else {
-        std::cerr << "Non-nullable column '" << table.columns[i].name
-                  << "' must have a value." << std::endl;
-        return;
+      if (!layout->encodeField(row, i, *value)) {
+        std::cerr << "Invalid value '" << *value << "' for column '"
+                  << table.columns[i].name << "'" << rowLabel(r) << "."
+                  << std::endl;
+        return false;
       }
     }
+  }
+
+  // 查重、算出行位置、提交和维护索引期间锁住表，同一张表上并发的插入不会拿到相同的行位置
+  WriteAheadLog::TableLocks locks =
+      logOf(dbName).lockTables(tablesToLock(dbName, tableName, layout, false));
+  HeapFile dataFile(dataFilePath, rowWidth);
+  if (!dataFile.open()) {
+    std::cerr << "Failed to open data file for writing." << std::endl;
+    return false;
+  }
 
-    if (table.columns[i].type == "integer") {
-      int value = std::stoi(effectiveData[i]);
-      dataFile.write(reinterpret_cast<char *>(&value), sizeof(value));
-    } else if (table.columns[i].type == "str") {
-      effectiveData[i].resize(table.columns[i].length, '\0');
-      dataFile.write(effectiveData[i].c_str(), table.columns[i].length);
-    } else if (table.columns[i].type == "number") {
-      float value = std::stof(effectiveData[i]);
-      dataFile.write(reinterpret_cast<char *>(&value), sizeof(value));
-    } else if (table.columns[i].type == "bool") {
-      bool value = (effectiveData[i] == "true" || effectiveData[i] == "1");
-      dataFile.write(reinterpret_cast<char *>(&value), sizeof(value));
+  // 主键通过 .tid 中的 B+ 树查重，批内的重复用哈希集合检查，都不扫描数据文件
+  std::vector<std::unique_ptr<TableIndex>> indexes;
+  if (!openIndexes(tableDirPath, tableName, layout, dataFile, indexes)) {
+    std::cerr << "Failed to open table indexes. Insert operation aborted."
+              << std::endl;
+    return false;
+  }
+  TableIndex *pkIndex = primaryIndex(indexes);
+  if (pkIndex) {
+    std::vector<char> key(pkIndex->tree().keyWidth());
+    std::unordered_set<std::string> batchKeys;
+    for (size_t r = 0; r < records.size(); ++r) {
+      pkIndex->makeKey(rows.data() + r * rowWidth, key.data());
+      if (pkIndex->tree().contains(key.data()) ||
+          !batchKeys.emplace(key.data(), key.size()).second) {
+        std::cerr << "Duplicate entry '" << pkIndex->describeKey(key.data())
+                  << "' for primary key" << rowLabel(r) << "." << std::endl;
+        return false;
+      }
     }
   }
 
-  dataFile.close();
+  // 先写日志再写页：行的位置预先算出，数据页由缓冲池延迟写回
+  std::vector<RowId> rids;
+  if (!dataFile.nextRowIds(records.size(), rids)) {
+    std::cerr << "Failed to open data file for writing." << std::endl;
+    return false;
+  }
+  WriteAheadLog::Transaction txn;
+  for (size_t r = 0; r < records.size(); ++r) {
+    txn.insert(tableName, dataFile, rids[r], rows.data() + r * rowWidth);
+  }
+  if (!logOf(dbName).commit(txn)) {
+    std::cerr << "Failed to write data. Insert operation aborted."
+              << std::endl;
+    return false;
+  }
+  for (const auto &index : indexes) {
+    for (size_t r = 0; r < records.size(); ++r) {
+      index->insert(rows.data() + r * rowWidth, rids[r]);
+    }
+  }
+  return true;
+}
+
+bool TableManager::loadData(const std::string &dbName,
+                            const std::string &tableName,
+                            const std::string &filePath,
+                            const BulkLoader::Options &options) {
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
+  fs::path dataFilePath = tableDirPath / (tableName + ".trd");
+
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Error loading table schema. Load operation aborted."
+              << std::endl;
+    return false;
+  }
+  std::vector<ForeignKeyProbe> probes;
+  if (!loadForeignKeyProbes(dbName, *layout, probes)) {
+    return false;
+  }
+
+  // 导入直接追加到数据文件，整个导入期间锁住表，和插入语句预先算出的行位置不会冲突
+  WriteAheadLog::TableLocks locks =
+      logOf(dbName).lockTables(tablesToLock(dbName, tableName, layout, false));
+  HeapFile dataFile(dataFilePath, layout->rowWidth());
+  if (!dataFile.open()) {
+    std::cerr << "Failed to open data file for writing." << std::endl;
+    return false;
+  }
+  std::vector<std::unique_ptr<TableIndex>> indexes;
+  if (!openIndexes(tableDirPath, tableName, layout, dataFile, indexes)) {
+    std::cerr << "Failed to open table indexes. Load operation aborted."
+              << std::endl;
+    return false;
+  }
+  TableIndex *pkIndex = primaryIndex(indexes);
+
+  // 导入的行不写日志，只记下这张表：中途崩溃时恢复会重建它的索引和 zone map
+  WriteAheadLog::Transaction marker;
+  marker.touch(tableName, dataFile);
+  if (!logOf(dbName).commit(marker)) {
+    return false;
+  }
+
+  BulkLoader loader(layout, options);
+
+  // 外键在 sink 中按批探测（与写入同一个线程，自引用的表也不会边读边改索引）；
+  // 没有主键时整批追加；有主键时逐行查重（包括与同一文件中前面的行重复）
+  int rowWidth = layout->rowWidth();
+  std::vector<char> key(pkIndex ? pkIndex->tree().keyWidth() : 0);
+  std::vector<char> accepted;
+  std::vector<char> found;
+  std::vector<char> scratch;
+  std::vector<char> kept;
+  std::vector<RowId> rids;
+  auto sink = [&](BulkLoader::Batch &batch) {
+    accepted.assign(batch.count, 1);
+    for (auto &probe : probes) {
+      probe.probe(
+          batch.count,
+          [&](size_t r, char *probeKey) {
+            return probe.keyFromRow(*layout, batch.rows + r * rowWidth,
+                                    scratch, probeKey);
+          },
+          found);
+      for (size_t r = 0; r < batch.count; ++r) {
+        if (accepted[r] && !found[r]) {
+          accepted[r] = 0;
+          loader.reject(batch.lines[r],
+                        "Foreign key constraint violation: value '" +
+                            layout->toString(batch.rows + r * rowWidth,
+                                             probe.column) +
+                            "' for column '" + probe.fk->columnName +
+                            "' does not exist in reference table '" +
+                            probe.fk->referenceTable + "'.");
+          ++batch.rejected;
+        }
+      }
+    }
+
+    if (!pkIndex) {
+      const char *rows = batch.rows;
+      size_t count = batch.count;
+      if (batch.rejected > 0) {
+        kept.clear();
+        for (size_t r = 0; r < batch.count; ++r) {
+          if (accepted[r]) {
+            kept.insert(kept.end(), batch.rows + r * rowWidth,
+                        batch.rows + (r + 1) * rowWidth);
+          }
+        }
+        rows = kept.data();
+        count = batch.count - batch.rejected;
+      }
+      rids.clear();
+      if (!dataFile.appendRows(rows, count,
+                               indexes.empty() ? nullptr : &rids)) {
+        return false;
+      }
+      for (const auto &index : indexes) {
+        for (size_t r = 0; r < count; ++r) {
+          index->insert(rows + r * rowWidth, rids[r]);
+        }
+      }
+      return true;
+    }
+    for (size_t r = 0; r < batch.count; ++r) {
+      if (!accepted[r]) {
+        continue;
+      }
+      const char *row = batch.rows + r * rowWidth;
+      pkIndex->makeKey(row, key.data());
+      if (pkIndex->tree().contains(key.data())) {
+        loader.reject(batch.lines[r], "Duplicate entry '" +
+                                          pkIndex->describeKey(key.data()) +
+                                          "' for primary key.");
+        ++batch.rejected;
+        continue;
+      }
+      RowId rid;
+      if (!dataFile.appendRow(row, &rid)) {
+        return false;
+      }
+      for (const auto &index : indexes) {
+        if (!index->insert(row, rid)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  BulkLoader::Stats stats;
+  bool ok = loader.load(filePath, sink, stats);
+  dataFile.flush();
+  for (const auto &index : indexes) {
+    index->flush();
+  }
+  if (!ok) {
+    std::cerr << "Load operation aborted after " << stats.rows << " rows."
+              << std::endl;
+    return false;
+  }
+  // 导入的行不在日志里：报告成功之前做检查点，数据文件和索引都 fsync 落盘。
+  // 先再提交一次标记：日志在导入期间被别的检查点清空过时，检查点也不会跳过写盘；
+  // 清掉这个标记的检查点一定在所有导入的页之后
+  if (!logOf(dbName).commit(marker) || !logOf(dbName).checkpoint()) {
+    std::cerr << "Failed to sync loaded data to disk. Load operation aborted."
+              << std::endl;
+    return false;
+  }
+  std::cout << "Loaded " << stats.rows << " rows (" << stats.rejected
+            << " rejected) in " << std::fixed << std::setprecision(3)
+            << stats.seconds << " s (" << std::setprecision(0)
+            << stats.rowsPerSecond() << " rows/sec)." << std::endl;
+  std::cout.unsetf(std::ios::fixed);
+  std::cout << std::setprecision(6);
+  return true;
 }
 
 bool TableManager::checkForeignKeyConstraint(const std::string &dbName,
@@ -248,131 +1255,88 @@ bool TableManager::checkForeignKeyConstraint(const std::string &dbName,
                                              const std::string &referenceColumn,
                                              const std::string &value,
                                              const std::string &columnType) {
-  Table refTable;
-  if (!loadTableSchema(dbName, referenceTable, refTable)) {
+  std::shared_ptr<const RowLayout> refLayout =
+      getRowLayout(dbName, referenceTable);
+  if (!refLayout) {
     std::cerr << "Error loading reference table schema: " << referenceTable
               << std::endl;
     return false;
   }
 
-  int colIdx = -1;
-  for (size_t i = 0; i < refTable.columns.size(); ++i) {
-    if (refTable.columns[i].name == referenceColumn) {
-      colIdx = i;
-      break;
-    }
-  }
+  int colIdx = refLayout->columnIndex(referenceColumn);
   if (colIdx == -1) {
     std::cerr << "Reference column '" << referenceColumn
               << "' not found in reference table schema." << std::endl;
     return false;
   }
 
-  fs::path dataFilePath = fs::current_path() / "DB" / dbName / referenceTable /
-                          (referenceTable + ".trd");
-  std::ifstream dataFile(dataFilePath, std::ios::binary);
-  if (!dataFile) {
-    std::cerr << "Failed to open reference data file for reading." << std::endl;
+  // 按引用字段的类型把待查值编码成键，在该列的索引上查一次
+  // （columnType 为外键字段自身的类型，两者一致时结果相同）；
+  // 比被引用列更长的字符串编码时会被截断，直接视为不存在
+  fs::path refDirPath = fs::current_path() / "DB" / dbName / referenceTable;
+  const RowLayout::Field &field = refLayout->field(colIdx);
+  if (field.type == RowLayout::ColumnType::Str &&
+      value.size() > static_cast<size_t>(field.width)) {
     return false;
   }
-
-  int rowWidth = 0;
-  std::vector<int> fieldOffsets;
-  for (const auto &col : refTable.columns) {
-    fieldOffsets.push_back(rowWidth);
-    rowWidth += col.length;
+  std::unique_ptr<TableIndex> index =
+      TableIndex::forColumn(refDirPath, referenceTable, refLayout, colIdx);
+  std::vector<char> key;
+  if (!index->encodeKey({value}, key)) {
+    std::cerr << "Value '" << value << "' is not a valid " << columnType
+              << " for reference column '" << referenceColumn << "'."
+              << std::endl;
+    return false;
   }
 
-  std::vector<char> rowBuffer(rowWidth);
-  while (dataFile.read(rowBuffer.data(), rowWidth)) {
-    std::string fieldValue(rowBuffer.data() + fieldOffsets[colIdx],
-                           refTable.columns[colIdx].length);
-    fieldValue.erase(std::remove(fieldValue.begin(), fieldValue.end(), '\0'),
-                     fieldValue.end());
-
-    bool match = false;
-    if (columnType == "integer") {
-      int intValue;
-      memcpy(&intValue, rowBuffer.data() + fieldOffsets[colIdx],
-             sizeof(intValue));
-      match = (std::to_string(intValue) == value);
-    } else if (columnType == "number") {
-      float floatValue;
-      memcpy(&floatValue, rowBuffer.data() + fieldOffsets[colIdx],
-             sizeof(floatValue));
-      match = (std::to_string(floatValue) == value);
-    } else {
-      match = (fieldValue == value);
-    }
-
-    if (match) {
-      dataFile.close();
-      return true;
-    }
+  HeapFile dataFile(refDirPath / (referenceTable + ".trd"),
+                    refLayout->rowWidth());
+  if (!dataFile.open() || !index->open(dataFile)) {
+    std::cerr << "Failed to open reference data file for reading." << std::endl;
+    return false;
   }
-
-  dataFile.close();
-  return false;
+  return index->tree().contains(key.data());
 }
 
 void TableManager::readTableData(const std::string &dbName,
                                  const std::string &tableName) {
-  // 构建表结构文件路径和数据文件路径
-  fs::path schemaFilePath =
-      fs::current_path() / "DB" / dbName / tableName / (tableName + ".tdf");
+  std::unique_ptr<ResultSet> result = queryTable(dbName, tableName);
+  if (result && !result->print(std::cout)) {
+    std::cerr << "Failed to read data file." << std::endl;
+  }
+}
+
+std::unique_ptr<ResultSet>
+TableManager::queryTable(const std::string &dbName,
+                         const std::string &tableName) {
+  // 构建数据文件路径
   fs::path dataFilePath =
       fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
 
-  Table table;
-  if (!loadTableSchema(dbName, tableName, table)) {
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
     std::cerr << "Failed to load table schema." << std::endl;
-    return;
+    return nullptr;
   }
 
-  std::ifstream dataFile(dataFilePath, std::ios::binary);
-  if (!dataFile) {
+  HeapFile dataFile(dataFilePath, layout->rowWidth());
+  if (!dataFile.open()) {
     std::cerr << "Failed to open data file for reading." << std::endl;
-    return;
+    return nullptr;
   }
-
-  std::cout << std::endl;
-
-  // 输出表头，即列名
-  for (const auto &col : table.columns) {
-    std::cout << col.name << "\t";
+  if (mappedReads) {
+    dataFile.mapForRead();
   }
-  std::cout << std::endl;
 
-  // 读取数据
-  while (dataFile && dataFile.peek() != EOF) {
-    for (const auto &col : table.columns) {
-      if (col.type == "integer") {
-        int value;
-        dataFile.read(reinterpret_cast<char *>(&value), sizeof(value));
-        if (!dataFile)
-          break;
-        std::cout << value << "\t";
-      } else if (col.type == "str") {
-        std::string value(col.length, '\0');
-        dataFile.read(&value[0], col.length);
-        if (!dataFile)
-          break;
-        value.erase(std::remove(value.begin(), value.end(), '\0'), value.end());
-        std::cout << value << "\t";
-      } else if (col.type == "str") {
-        float value;
-        dataFile.read(reinterpret_cast<char *>(&value), sizeof(value));
-        std::cout << value << "\t";
-      } else if (col.type == "str") {
-        bool value;
-        dataFile.read(reinterpret_cast<char *>(&value), sizeof(value));
-        std::cout << (value ? "true" : "false") << "\t";
-      }
-    }
-    std::cout << std::endl;
+  // 输出所有列
+  std::vector<ResultSet::Column> columns;
+  for (int i = 0; i < layout->columnCount(); ++i) {
+    columns.push_back({layout->table().columns[i].name, 0, i});
   }
-
-  dataFile.close();
+  return std::make_unique<ResultSet>(
+      std::vector<std::shared_ptr<const RowLayout>>{layout},
+      std::move(columns),
+      std::make_unique<ScanSource>(dataFile, Predicate(), parallelism));
 }
 
 void TableManager::readRecords(const std::string &dbName,
@@ -380,95 +1344,281 @@ void TableManager::readRecords(const std::string &dbName,
                                const std::vector<std::string> &fieldNames,
                                const std::vector<std::string> &conditionColumn,
                                const std::vector<std::string> &operation,
-                               const std::vector<std::string> &conditionValue) {
-  // 构建表结构文件路径和数据文件路径
-  fs::path schemaFilePath =
-      fs::current_path() / "DB" / dbName / tableName / (tableName + ".tdf");
+                               const std::vector<std::string> &conditionValue,
+                               size_t limit, size_t offset) {
+  std::unique_ptr<ResultSet> result =
+      queryRecords(dbName, tableName, fieldNames, conditionColumn, operation,
+                   conditionValue, limit, offset);
+  if (result && !result->print(std::cout)) {
+    std::cerr << "Failed to read data file." << std::endl;
+  }
+}
+
+std::unique_ptr<ResultSet> TableManager::queryRecords(
+    const std::string &dbName, const std::string &tableName,
+    const std::vector<std::string> &fieldNames,
+    const std::vector<std::string> &conditionColumn,
+    const std::vector<std::string> &operation,
+    const std::vector<std::string> &conditionValue, size_t limit,
+    size_t offset) {
+  // 构建数据文件路径
   fs::path dataFilePath =
       fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
 
-  Table table;
-  if (!loadTableSchema(dbName, tableName, table)) {
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
     std::cerr << "Failed to load table schema." << std::endl;
-    return;
+    return nullptr;
   }
 
-  std::ifstream dataFile(dataFilePath, std::ios::binary);
-  if (!dataFile) {
+  HeapFile dataFile(dataFilePath, layout->rowWidth());
+  if (!dataFile.open()) {
     std::cerr << "Failed to open data file for reading." << std::endl;
-    return;
+    return nullptr;
+  }
+  if (mappedReads) {
+    dataFile.mapForRead();
   }
 
-  int rowWidth = 0;
-  std::vector<int> fieldOffsets;
-  for (const auto &col : table.columns) {
-    fieldOffsets.push_back(rowWidth);
-    rowWidth += col.length;
+  // 语句开始时一次性解析条件字段和输出字段的下标，并把条件编译成按类型比较的谓词
+  std::vector<int> conditionIndex = resolveColumns(*layout, conditionColumn);
+  std::vector<ResultSet::Column> columns;
+  for (const auto &fieldName : fieldNames) {
+    int columnIndex = layout->columnIndex(fieldName);
+    if (columnIndex != -1) {
+      columns.push_back({fieldName, 0, columnIndex});
+    }
+  }
+  Predicate where;
+  if (!where.compile(*layout, conditionIndex, operation, conditionValue)) {
+    return nullptr;
   }
 
-  std::vector<char> rowBuffer(rowWidth);
-  std::string fieldValue;
+  // 条件落在某个索引的键前缀上时只扫描 B+ 树中的对应范围；
+  // 输出列和条件列都在某个可用索引的键里时优先选它，只读索引不回表
+  std::vector<std::unique_ptr<TableIndex>> indexes =
+      TableIndex::forTable(dataFilePath.parent_path(), tableName, layout);
+  std::vector<int> needed;
+  for (const auto &column : columns) {
+    needed.push_back(column.index);
+  }
+  for (int col : conditionIndex) {
+    if (col != -1) {
+      needed.push_back(col);
+    }
+  }
+  KeyRange range;
+  TableIndex *index = chooseIndex(indexes, conditionIndex, operation,
+                                  conditionValue, range, &needed);
+  bool indexOnly = index != nullptr;
+  if (!index) {
+    index = chooseIndex(indexes, conditionIndex, operation, conditionValue,
+                        range);
+  }
+  bool useIndex = index && index->open(dataFile);
+
+  std::unique_ptr<ResultSet::Source> source;
+  if (useIndex && indexOnly) {
+    source = scanIndexOnly(*index, range, where,
+                           limit > NO_LIMIT - offset ? NO_LIMIT
+                                                     : offset + limit);
+  } else if (useIndex && index->tree().isUnique()) {
+    // 先取出范围内的 RowId，回表在拉取结果时按批进行；
+    // 剩余条件为空时范围内前 offset + limit 行就是全部结果
+    where.removeCovered(range.covered);
+    size_t wanted = limit > NO_LIMIT - offset ? NO_LIMIT : offset + limit;
+    std::vector<RowId> rids;
+    index->tree().scan(
+        range.low.empty() ? nullptr : range.low.data(), range.lowInclusive,
+        range.high.empty() ? nullptr : range.high.data(), range.highInclusive,
+        [&](const char *, RowId rid) {
+          rids.push_back(rid);
+          return !where.empty() || rids.size() < wanted;
+        });
+    source = std::make_unique<RowIdSource>(dataFile, std::move(rids), where);
+  } else if (useIndex) {
+    // 二级索引按页顺序回表，结果的顺序与全表扫描相同
+    where.removeCovered(range.covered);
+    source = std::make_unique<RowIdSource>(
+        dataFile, collectRowIds(*index, range), where);
+  } else {
+    // 全表扫描按 morsel 并行筛选；有 LIMIT / OFFSET 时逐个 morsel 扫描，
+    // 输出够之后不再读后面的页。有条件时先用 zone map 排除不相交的页
+    if (!where.empty()) {
+      ensureZoneMap(dataFile, *layout);
+    }
+    bool limited = limit != NO_LIMIT || offset > 0;
+    source = std::make_unique<ScanSource>(dataFile, where,
+                                          limited ? 1 : parallelism);
+  }
+  return std::make_unique<ResultSet>(
+      std::vector<std::shared_ptr<const RowLayout>>{layout},
+      std::move(columns), std::move(source), limit, offset);
+}
+
+bool TableManager::aggregateRecords(
+    const std::string &dbName, const std::string &tableName,
+    const std::vector<std::string> &functions,
+    const std::vector<std::string> &columns,
+    const std::vector<std::string> &conditionColumn,
+    const std::vector<std::string> &operation,
+    const std::vector<std::string> &conditionValue,
+    std::vector<Aggregator::Value> *results) {
+  fs::path dataFilePath =
+      fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
+
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Failed to load table schema." << std::endl;
+    return false;
+  }
+
+  Aggregator aggregator;
+  for (size_t i = 0; i < functions.size() && i < columns.size(); ++i) {
+    Aggregator::Function function;
+    if (!Aggregator::parseFunction(functions[i], function)) {
+      std::cerr << "Unknown aggregate function '" << functions[i] << "'."
+                << std::endl;
+      return false;
+    }
+    if (!aggregator.add(*layout, function, columns[i])) {
+      return false;
+    }
+  }
+  Predicate where;
+  if (!where.compile(*layout, resolveColumns(*layout, conditionColumn),
+                     operation, conditionValue)) {
+    return false;
+  }
+
+  HeapFile dataFile(dataFilePath, layout->rowWidth());
+  if (!dataFile.open()) {
+    std::cerr << "Failed to open data file for reading." << std::endl;
+    return false;
+  }
+  if (mappedReads) {
+    dataFile.mapForRead();
+  }
+
+  // 每个工作者各自累加，扫描结束后合并
+  ParallelScan scan(dataFile, parallelism);
+  std::vector<std::vector<Aggregator::State>> partial(
+      scan.workers(), std::vector<Aggregator::State>(aggregator.size()));
+  bool ok = scan.run([&](size_t worker, size_t morsel) {
+    std::vector<uint16_t> selection(HeapFile::BATCH_ROWS);
+    return dataFile.forEachBatch(
+        scan.firstPage(morsel), scan.endPage(morsel),
+        [&](const HeapFile::Batch &batch) {
+          uint32_t selected = where.select(batch, selection.data());
+          aggregator.accumulate(batch, selection.data(), selected,
+                                partial[worker].data());
+          return true;
+        });
+  });
+  if (!ok) {
+    std::cerr << "Failed to read data file." << std::endl;
+    return false;
+  }
+  for (size_t worker = 1; worker < partial.size(); ++worker) {
+    aggregator.merge(partial[0].data(), partial[worker].data());
+  }
 
-  // 输出列名作为表头
   std::cout << std::endl;
-  for (const auto &fieldName : fieldNames) {
-    std::cout << fieldName << "\t";
+  for (size_t i = 0; i < aggregator.size(); ++i) {
+    std::cout << functions[i] << "(" << columns[i] << ")\t";
   }
   std::cout << std::endl;
-
-  // 创建列名到索引的映射
-  std::map<std::string, int> columnMap;
-  for (int i = 0; i < table.columns.size(); ++i) {
-    columnMap[table.columns[i].name] = i;
-  }
-
-  // 现在可以使用columnMap来获取正确的索引
-  while (dataFile.read(rowBuffer.data(), rowWidth)) {
-    bool matches = true;
-    for (size_t i = 0; i < conditionColumn.size(); ++i) {
-      const auto &colName = conditionColumn[i];
-      const auto &op = operation[i];
-      const auto &value = conditionValue[i];
-
-      if (columnMap.find(colName) != columnMap.end()) {
-        int columnIndex = columnMap[colName];
-        fieldValue.assign(rowBuffer.data() + fieldOffsets[columnIndex],
-                          table.columns[columnIndex].length);
-        fieldValue.erase(
-            std::remove(fieldValue.begin(), fieldValue.end(), '\0'),
-            fieldValue.end());
-        matches &= checkCondition(fieldValue, op, value);
-      }
+  for (size_t i = 0; i < aggregator.size(); ++i) {
+    Aggregator::Value value = aggregator.result(i, partial[0][i]);
+    Aggregator::print(std::cout, value);
+    std::cout << "\t";
+    if (results != nullptr) {
+      results->push_back(value);
     }
+  }
+  std::cout << std::endl;
+  return true;
+}
 
-    if (matches) {
-      for (const auto &col : table.columns) {
-        if (std::find(fieldNames.begin(), fieldNames.end(), col.name) !=
-            fieldNames.end()) {
-          int columnIndex = columnMap[col.name];
-          fieldValue.assign(rowBuffer.data() + fieldOffsets[columnIndex],
-                            col.length);
-          fieldValue.erase(
-              std::remove(fieldValue.begin(), fieldValue.end(), '\0'),
-              fieldValue.end());
-          if (col.type == "integer") {
-            int intValue = static_cast<unsigned char>(fieldValue[0]);
-            fieldValue = std::to_string(intValue);
-            std::cout << fieldValue << "\t";
-          } else if (col.type == "number") {
-            float value;
-            dataFile.read(reinterpret_cast<char *>(&value), sizeof(value));
-            std::cout << value << "\t";
-          } else {
-            std::cout << fieldValue << "\t";
-          }
-        }
-      }
-      std::cout << std::endl;
+bool TableManager::groupByRecords(
+    const std::string &dbName, const std::string &tableName,
+    const std::vector<std::string> &groupColumns,
+    const std::vector<std::string> &functions,
+    const std::vector<std::string> &columns,
+    const std::vector<std::string> &conditionColumn,
+    const std::vector<std::string> &operation,
+    const std::vector<std::string> &conditionValue) {
+  fs::path dataFilePath =
+      fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
+
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Failed to load table schema." << std::endl;
+    return false;
+  }
+
+  std::vector<int> groupIndex = resolveColumns(*layout, groupColumns);
+  for (size_t i = 0; i < groupIndex.size(); ++i) {
+    if (groupIndex[i] == -1) {
+      std::cerr << "Column '" << groupColumns[i] << "' not found."
+                << std::endl;
+      return false;
+    }
+  }
+  Aggregator aggregator;
+  for (size_t i = 0; i < functions.size() && i < columns.size(); ++i) {
+    Aggregator::Function function;
+    if (!Aggregator::parseFunction(functions[i], function)) {
+      std::cerr << "Unknown aggregate function '" << functions[i] << "'."
+                << std::endl;
+      return false;
+    }
+    if (!aggregator.add(*layout, function, columns[i])) {
+      return false;
     }
   }
+  Predicate where;
+  if (!where.compile(*layout, resolveColumns(*layout, conditionColumn),
+                     operation, conditionValue)) {
+    return false;
+  }
 
-  dataFile.close();
+  HeapFile dataFile(dataFilePath, layout->rowWidth());
+  if (!dataFile.open()) {
+    std::cerr << "Failed to open data file for reading." << std::endl;
+    return false;
+  }
+  if (mappedReads) {
+    dataFile.mapForRead();
+  }
+
+  std::cout << std::endl;
+  for (const auto &column : groupColumns) {
+    std::cout << column << "\t";
+  }
+  for (size_t i = 0; i < aggregator.size(); ++i) {
+    std::cout << functions[i] << "(" << columns[i] << ")\t";
+  }
+  std::cout << std::endl;
+
+  GroupByOperator groupBy(layout, dataFile, groupIndex, aggregator, where);
+  bool ok = groupBy.run([&](const char *groupRow,
+                            const std::vector<Aggregator::Value> &values) {
+    for (int col : groupIndex) {
+      layout->print(std::cout, groupRow, col);
+      std::cout << "\t";
+    }
+    for (const auto &value : values) {
+      Aggregator::print(std::cout, value);
+      std::cout << "\t";
+    }
+    std::cout << "\n";
+  });
+  std::cout.flush();
+  if (!ok) {
+    std::cerr << "Failed to group records." << std::endl;
+  }
+  return ok;
 }
 
 void TableManager::deleteRecords(
@@ -476,109 +1626,240 @@ void TableManager::deleteRecords(
     const std::vector<std::string> &conditionColumn,
     const std::vector<std::string> &operation,
     const std::vector<std::string> &conditionValue) {
-  fs::path dataFilePath =
-      fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
-  fs::path tempPath = dataFilePath;
-  tempPath += ".tmp";
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
+  fs::path dataFilePath = tableDirPath / (tableName + ".trd");
 
-  std::ifstream inFile(dataFilePath, std::ios::binary);
-  std::ofstream outFile(tempPath, std::ios::binary);
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Failed to load table schema." << std::endl;
+    return;
+  }
 
-  if (!inFile || !outFile) {
+  // 从找出要删的行到维护完索引一直锁住本表和级联会改到的子表
+  WriteAheadLog::TableLocks locks =
+      logOf(dbName).lockTables(tablesToLock(dbName, tableName, layout, true));
+  HeapFile inFile(dataFilePath, layout->rowWidth());
+  if (!inFile.open()) {
     std::cerr << "Failed to open files for processing." << std::endl;
     return;
   }
 
-  Table table;
-  if (!loadTableSchema(dbName, tableName, table)) {
-    std::cerr << "Failed to load table schema." << std::endl;
+  std::vector<int> conditionIndex = resolveColumns(*layout, conditionColumn);
+  Predicate where;
+  if (!where.compile(*layout, conditionIndex, operation, conditionValue)) {
     return;
   }
 
-  int rowWidth = 0;
-  std::vector<int> fieldOffsets;
-  for (const auto &col : table.columns) {
-    fieldOffsets.push_back(rowWidth);
-    rowWidth += col.length;
+  // 本表的删除和外键级联的修改记在同一个日志事务里，一起提交
+  WriteAheadLog::Transaction txn;
+  std::vector<char> deletedRows;
+  std::vector<RowId> deletedRids;
+  auto erase = [&](const char *row, RowId rid) {
+    txn.erase(tableName, inFile, rid);
+    deletedRows.insert(deletedRows.end(), row, row + layout->rowWidth());
+    deletedRids.push_back(rid);
+    return true;
+  };
+
+  // 条件落在某个索引的键前缀上时只回表读取范围内的行，其余条件逐行判断
+  std::vector<std::unique_ptr<TableIndex>> indexes =
+      TableIndex::forTable(tableDirPath, tableName, layout);
+  KeyRange range;
+  TableIndex *plan = chooseIndex(indexes, conditionIndex, operation,
+                                 conditionValue, range);
+  if (plan && plan->open(inFile)) {
+    where.removeCovered(range.covered);
+    for (RowId rid : collectRowIds(*plan, range)) {
+      inFile.withRow(rid, [&](const char *row) {
+        if (where.matches(row)) {
+          erase(row, rid);
+        }
+      });
+    }
+  } else {
+    if (!where.empty()) {
+      ensureZoneMap(inFile, *layout);
+    }
+    where.forEachMatch(inFile, erase);
   }
 
-  std::vector<char> rowBuffer(rowWidth);
-  std::map<std::string, int> columnMap;
-  for (int i = 0; i < table.columns.size(); ++i) {
-    columnMap[table.columns[i].name] = i;
-  }
-
-  bool violationDetected = false;
-
-  while (inFile.read(rowBuffer.data(), rowWidth)) {
-    bool matches = true;
-    for (size_t i = 0; i < conditionColumn.size(); ++i) {
-      if (columnMap.find(conditionColumn[i]) != columnMap.end()) {
-        int columnIndex = columnMap[conditionColumn[i]];
-        std::string fieldValue(rowBuffer.data() + fieldOffsets[columnIndex],
-                               table.columns[columnIndex].length);
-        fieldValue.erase(
-            std::remove(fieldValue.begin(), fieldValue.end(), '\0'),
-            fieldValue.end());
-        matches &= checkCondition(fieldValue, operation[i], conditionValue[i]);
-      }
-    }
+  // 先删完本表的行，再对引用它们的子表一次性执行 ON DELETE 动作
+  ReferentialChanges childChanges;
+  if (!applyForeignKeyActions(dbName, tableName, layout, deletedRows,
+                              deletedRids, {}, nullptr, txn, childChanges)) {
+    std::cerr << "Foreign key constraint violation. Deletion aborted."
+              << std::endl;
+    return;
+  }
+  if (!logOf(dbName).commit(txn)) {
+    std::cerr << "Failed to write data. Deletion aborted." << std::endl;
+    return;
+  }
 
-    if (matches) {
-      for (const auto &fk : table.foreignKeys) {
-        std::string value(rowBuffer.data() +
-                              fieldOffsets[columnMap[fk.columnName]],
-                          table.columns[columnMap[fk.columnName]].length);
-        value.erase(std::remove(value.begin(), value.end(), '\0'), value.end());
-        if (!handleForeignKeyAction(dbName, table, fk.columnName, value,
-                                    fk.onDelete)) {
-          violationDetected = true;
-          break;
-        }
-      }
+  if (deletedRids.empty()) {
+    return;
+  }
 
-      if (!violationDetected) {
-        continue; // Skip writing this row to the new file
-      }
+  // 删除只打墓碑，其余行的位置不变，各个索引只去掉被删的行
+  for (const auto &index : indexes) {
+    if (!index->open(inFile)) {
+      continue;
+    }
+    for (size_t r = 0; r < deletedRids.size(); ++r) {
+      index->erase(deletedRows.data() + r * layout->rowWidth(),
+                   deletedRids[r]);
     }
+  }
+  maintainChildIndexes(dbName, childChanges);
 
-    outFile.write(rowBuffer.data(), rowWidth);
+  // 墓碑超过一半（且至少一整页）时整理表，回收空间；整理在换文件时自己锁表
+  size_t live = 0;
+  size_t dead = 0;
+  bool compact = inFile.countRows(live, dead) && dead >= live &&
+                 dead >= inFile.rowsPerPage();
+  locks.release();
+  if (compact) {
+    compactTable(dbName, tableName);
   }
+}
 
-  inFile.close();
-  outFile.close();
+bool TableManager::compactTable(const std::string &dbName,
+                                const std::string &tableName) {
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Failed to load table schema." << std::endl;
+    return false;
+  }
+  // 删除之后顺带整理，不限速，保持原来的物理顺序
+  TableRewriter::Options options;
+  options.bytesPerSecond = 0;
+  return rewriteTable(dbName, tableName, layout, options, false, nullptr);
+}
 
-  if (violationDetected) {
-    std::cerr << "Foreign key constraint violation. Deletion aborted."
+bool TableManager::optimizeTable(const std::string &dbName,
+                                 const std::string &tableName,
+                                 const TableRewriter::Options &options) {
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Failed to load table schema." << std::endl;
+    return false;
+  }
+  TableRewriter::Stats stats;
+  if (!rewriteTable(dbName, tableName, layout, options, true, &stats)) {
+    std::cerr << "Failed to optimize table '" << tableName << "'."
               << std::endl;
-    fs::remove(tempPath); // Remove temporary file
-  } else {
-    fs::remove(dataFilePath);
-    fs::rename(tempPath, dataFilePath);
+    return false;
+  }
+  std::cout << "Table '" << tableName << "' optimized: " << stats.rows
+            << " rows, " << stats.pagesBefore << " -> " << stats.pagesAfter
+            << " pages, " << stats.caughtUp
+            << " concurrent changes caught up in " << stats.seconds << " s."
+            << std::endl;
+  return true;
+}
+
+bool TableManager::createIndex(const std::string &dbName,
+                               const std::string &tableName,
+                               const std::string &indexName,
+                               const std::vector<std::string> &columns,
+                               const std::vector<std::string> &include) {
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Failed to load table schema." << std::endl;
+    return false;
+  }
+
+  // 索引名是文件名的一部分；与列名相同时会和外键建立的列索引 <table>.<column>.tid 混淆
+  if (indexName.empty() ||
+      indexName.find_first_of("./\\ \t") != std::string::npos ||
+      layout->columnIndex(indexName) != -1) {
+    std::cerr << "Invalid index name '" << indexName << "'." << std::endl;
+    return false;
+  }
+  // 从读定义、扫描数据文件建索引到写下定义期间锁住表：并发的写语句要么在扫描之前提交，
+  // 要么在定义写好之后才打开索引，不会有行漏掉
+  WriteAheadLog::TableLocks locks = logOf(dbName).lockTables({tableName});
+  std::vector<TableIndex::Definition> definitions =
+      TableIndex::readDefinitions(tableDirPath, tableName);
+  for (const auto &definition : definitions) {
+    if (definition.name == indexName) {
+      std::cerr << "Index '" << indexName << "' already exists on table '"
+                << tableName << "'." << std::endl;
+      return false;
+    }
+  }
+  if (columns.empty()) {
+    std::cerr << "Index '" << indexName << "' has no columns." << std::endl;
+    return false;
+  }
+  std::vector<std::string> all = columns;
+  all.insert(all.end(), include.begin(), include.end());
+  for (size_t i = 0; i < all.size(); ++i) {
+    if (layout->columnIndex(all[i]) == -1) {
+      std::cerr << "Column '" << all[i] << "' does not exist in table '"
+                << tableName << "'." << std::endl;
+      return false;
+    }
+    if (std::find(all.begin(), all.begin() + i, all[i]) != all.begin() + i) {
+      std::cerr << "Column '" << all[i] << "' appears more than once in "
+                << "index '" << indexName << "'." << std::endl;
+      return false;
+    }
+  }
+
+  HeapFile heap(tableDirPath / (tableName + ".trd"), layout->rowWidth());
+  if (!heap.open()) {
+    std::cerr << "Failed to open data file." << std::endl;
+    return false;
+  }
+  // 先从数据文件建好索引再记下定义，中途失败时表上不会留下无效的索引
+  TableIndex::Definition definition{indexName, columns, include};
+  std::unique_ptr<TableIndex> index =
+      TableIndex::forDefinition(tableDirPath, tableName, layout, definition);
+  definitions.push_back(definition);
+  if (!index->rebuild(heap) ||
+      !TableIndex::writeDefinitions(tableDirPath, tableName, definitions)) {
+    BufferPool::instance().dropFile(index->tree().path());
+    std::error_code ec;
+    fs::remove(index->tree().path(), ec);
+    std::cerr << "Failed to create index '" << indexName << "'." << std::endl;
+    return false;
+  }
+  std::cout << "Index '" << indexName << "' created on table '" << tableName
+            << "'." << std::endl;
+  return true;
+}
+
+bool TableManager::dropIndex(const std::string &dbName,
+                             const std::string &tableName,
+                             const std::string &indexName) {
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
+  // 写语句在锁内打开并维护索引，删除定义和索引文件时不能有写语句正在用它
+  WriteAheadLog::TableLocks locks = logOf(dbName).lockTables({tableName});
+  std::vector<TableIndex::Definition> definitions =
+      TableIndex::readDefinitions(tableDirPath, tableName);
+  auto it = std::find_if(definitions.begin(), definitions.end(),
+                         [&](const TableIndex::Definition &definition) {
+                           return definition.name == indexName;
+                         });
+  if (it == definitions.end()) {
+    std::cerr << "Index '" << indexName << "' does not exist on table '"
+              << tableName << "'." << std::endl;
+    return false;
+  }
+  definitions.erase(it);
+  if (!TableIndex::writeDefinitions(tableDirPath, tableName, definitions)) {
+    std::cerr << "Failed to drop index '" << indexName << "'." << std::endl;
+    return false;
   }
-}
-
-bool TableManager::checkCondition(const std::string &fieldValue,
-                                  const std::string &op,
-                                  const std::string &value) {
-  if (op == "=")
-    return fieldValue == value;
-  if (op == "!=")
-    return fieldValue != value;
-  if (op == "<" && isNumber(fieldValue))
-    return std::stod(fieldValue) < std::stod(value);
-  if (op == ">" && isNumber(fieldValue))
-    return std::stod(fieldValue) > std::stod(value);
-  if (op == "<=" && isNumber(fieldValue))
-    return std::stod(fieldValue) <= std::stod(value);
-  if (op == ">=" && isNumber(fieldValue))
-    return std::stod(fieldValue) >= std::stod(value);
-  return false;
-}
-
-bool TableManager::isNumber(const std::string &str) {
-  return !str.empty() &&
-         str.find_first_not_of("0123456789.-") == std::string::npos;
+  fs::path indexPath = tableDirPath / (tableName + "." + indexName + ".tid");
+  BufferPool::instance().dropFile(indexPath);
+  std::error_code ec;
+  fs::remove(indexPath, ec);
+  std::cout << "Index '" << indexName << "' dropped from table '" << tableName
+            << "'." << std::endl;
+  return true;
 }
 
 void TableManager::updateTable(const std::string &dbName,
@@ -588,176 +1869,270 @@ void TableManager::updateTable(const std::string &dbName,
                                const std::vector<std::string> &conditionValue,
                                const std::vector<std::string> &updateColumn,
                                const std::vector<std::string> &updateValue) {
-  fs::path dataFilePath =
-      fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
-  fs::path tempPath = dataFilePath;
-  tempPath += ".tmp";
-
-  std::ifstream inFile(dataFilePath, std::ios::binary);
-  std::ofstream outFile(tempPath, std::ios::binary);
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
+  fs::path dataFilePath = tableDirPath / (tableName + ".trd");
 
-  if (!inFile || !outFile) {
-    std::cerr << "Failed to open files for processing." << std::endl;
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Failed to load table schema." << std::endl;
     return;
   }
+  const Table &table = layout->table();
 
-  Table table;
-  if (!loadTableSchema(dbName, tableName, table)) {
-    std::cerr << "Failed to load table schema." << std::endl;
+  int rowWidth = layout->rowWidth();
+  std::vector<int> updateIndex = resolveColumns(*layout, updateColumn);
+  std::vector<int> conditionIndex = resolveColumns(*layout, conditionColumn);
+  Predicate where;
+  if (!where.compile(*layout, conditionIndex, operation, conditionValue)) {
     return;
   }
 
-  int rowWidth = 0;
-  std::vector<int> fieldOffsets;
-  for (const auto &col : table.columns) {
-    fieldOffsets.push_back(rowWidth);
-    rowWidth += col.length;
+  // 新值只按字段类型编码一次，匹配的行直接拷贝字段字节
+  std::vector<char> newValues(rowWidth, '\0');
+  for (size_t i = 0; i < updateIndex.size(); ++i) {
+    if (updateIndex[i] == -1) {
+      continue;
+    }
+    // 更新主键检查
+    if (table.columns[updateIndex[i]].isPrimaryKey && updateValue[i].empty()) {
+      std::cerr << "Attempt to set primary key '" << updateColumn[i]
+                << "' to an empty value denied." << std::endl;
+      updateIndex[i] = -1; // 跳过这个更新，继续处理其他更新
+      continue;
+    }
+    if (!layout->encodeField(newValues.data(), updateIndex[i],
+                             updateValue[i])) {
+      std::cerr << "Invalid value '" << updateValue[i] << "' for column '"
+                << updateColumn[i] << "'. Update aborted." << std::endl;
+      return;
+    }
+  }
+
+  // 从找出要改的行到维护完索引一直锁住本表和级联会改到的子表
+  WriteAheadLog::TableLocks locks =
+      logOf(dbName).lockTables(tablesToLock(dbName, tableName, layout, true));
+  HeapFile inFile(dataFilePath, rowWidth);
+  if (!inFile.open()) {
+    std::cerr << "Failed to open files for processing." << std::endl;
+    return;
   }
 
   std::vector<char> rowBuffer(rowWidth);
-  std::map<std::string, int> columnMap;
-  for (int i = 0; i < table.columns.size(); ++i) {
-    columnMap[table.columns[i].name] = i;
-  }
-
-  bool violationDetected = false;
-
-  while (inFile.read(rowBuffer.data(), rowWidth)) {
-    bool matches = true;
-    for (size_t i = 0; i < conditionColumn.size(); ++i) {
-      if (columnMap.find(conditionColumn[i]) != columnMap.end()) {
-        int columnIndex = columnMap[conditionColumn[i]];
-        std::string fieldValue(rowBuffer.data() + fieldOffsets[columnIndex],
-                               table.columns[columnIndex].length);
-        fieldValue.erase(
-            std::remove(fieldValue.begin(), fieldValue.end(), '\0'),
-            fieldValue.end());
-        matches = checkCondition(fieldValue, operation[i], conditionValue[i]);
-        if (!matches)
-          break;
+  WriteAheadLog::Transaction txn;
+
+  // 被更新的列被其他表的外键引用时，记下匹配行的旧内容，之后一次性执行 ON UPDATE 动作
+  std::vector<int> updatedColumns;
+  for (int col : updateIndex) {
+    if (col != -1) {
+      updatedColumns.push_back(col);
+    }
+  }
+  bool referenced = false;
+  for (const auto &ref : findReferencingKeys(dbName, tableName, *layout)) {
+    referenced |= std::find(updatedColumns.begin(), updatedColumns.end(),
+                            ref.refColumn) != updatedColumns.end();
+  }
+
+  // 行位置不变；只有索引列被更新的索引才需要改动，改动时要用到匹配行的新旧内容
+  std::vector<std::unique_ptr<TableIndex>> indexes =
+      TableIndex::forTable(tableDirPath, tableName, layout);
+  KeyRange range;
+  TableIndex *plan = chooseIndex(indexes, conditionIndex, operation,
+                                 conditionValue, range);
+  if (plan && !plan->open(inFile)) {
+    plan = nullptr;
+  }
+  std::vector<TableIndex *> affected;
+  for (const auto &index : indexes) {
+    if (std::any_of(updatedColumns.begin(), updatedColumns.end(),
+                    [&](int col) { return index->covers(col); })) {
+      if (!index->open(inFile)) {
+        std::cerr << "Failed to open index " << index->tree().path().filename()
+                  << ". Update aborted." << std::endl;
+        return;
       }
+      affected.push_back(index.get());
     }
+  }
+  std::vector<char> oldRows;
+  std::vector<char> newRows;
+  std::vector<RowId> matchedRids;
 
-    if (matches) {
-      // 检查并处理外键约束
-      for (size_t i = 0; i < updateColumn.size(); ++i) {
-        if (columnMap.find(updateColumn[i]) != columnMap.end()) {
-          int updateIndex = columnMap[updateColumn[i]];
-          std::string newValue = updateValue[i];
-
-          for (const auto &fk : table.foreignKeys) {
-            if (fk.columnName == updateColumn[i]) {
-              std::string oldValue(rowBuffer.data() + fieldOffsets[updateIndex],
-                                   table.columns[updateIndex].length);
-              oldValue.erase(
-                  std::remove(oldValue.begin(), oldValue.end(), '\0'),
-                  oldValue.end());
-
-              // 执行外键更新动作
-              if (!handleForeignKeyAction(dbName, table, updateColumn[i],
-                                          oldValue, fk.onUpdate)) {
-                std::cerr << "Foreign key constraint violation on column '"
-                          << updateColumn[i] << "'." << std::endl;
-                violationDetected = true;
-                break; // 外键约束违规，退出循环
-              }
-            }
-          }
-
-          if (violationDetected) {
-            break; // 外键约束违规，退出循环
-          }
-
-          // 更新主键检查
-          if (table.columns[updateIndex].isPrimaryKey) {
-            if (updateValue[i].empty()) {
-              std::cerr << "Attempt to set primary key '" << updateColumn[i]
-                        << "' to an empty value denied." << std::endl;
-              continue; // 跳过这个更新，继续处理其他更新
-            }
-          }
-
-          newValue.resize(table.columns[updateIndex].length, '\0');
-          std::memcpy(rowBuffer.data() + fieldOffsets[updateIndex],
-                      newValue.data(), newValue.size());
+  auto visit = [&](const char *row, RowId rid) {
+    std::memcpy(rowBuffer.data(), row, rowWidth);
+    for (int col : updatedColumns) {
+      const RowLayout::Field &field = layout->field(col);
+      std::memcpy(rowBuffer.data() + field.offset,
+                  newValues.data() + field.offset, field.width);
+    }
+    txn.update(tableName, inFile, rid, rowBuffer.data());
+    if (referenced || !affected.empty()) {
+      oldRows.insert(oldRows.end(), row, row + rowWidth);
+      newRows.insert(newRows.end(), rowBuffer.begin(), rowBuffer.end());
+      matchedRids.push_back(rid);
+    }
+    return true;
+  };
+
+  // 条件落在某个索引的键前缀上时只回表读取范围内的行，否则按批筛选全表
+  if (plan) {
+    where.removeCovered(range.covered);
+    for (RowId rid : collectRowIds(*plan, range)) {
+      inFile.withRow(rid, [&](const char *row) {
+        if (where.matches(row)) {
+          visit(row, rid);
         }
-      }
+      });
+    }
+  } else {
+    if (!where.empty()) {
+      ensureZoneMap(inFile, *layout);
+    }
+    where.forEachMatch(inFile, visit);
+  }
 
-      if (violationDetected) {
-        break; // 外键约束违规，退出循环
+  // 新键在唯一索引上重复时整条语句不生效：匹配行的新键之间不能相同，
+  // 也不能与不在本次更新中的行的键相同
+  std::unordered_set<uint64_t> matched;
+  for (RowId rid : matchedRids) {
+    matched.insert(static_cast<uint64_t>(rid.pageNo) << 32 | rid.slot);
+  }
+  for (TableIndex *index : affected) {
+    if (!index->tree().isUnique()) {
+      continue;
+    }
+    int keyWidth = index->tree().keyWidth();
+    std::vector<char> keys(matchedRids.size() * keyWidth);
+    std::vector<const char *> sorted;
+    for (size_t r = 0; r < matchedRids.size(); ++r) {
+      index->makeKey(newRows.data() + r * rowWidth, &keys[r * keyWidth]);
+      sorted.push_back(&keys[r * keyWidth]);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [&](const char *a, const char *b) {
+                return index->tree().compareKeys(a, b) < 0;
+              });
+    for (size_t r = 0; r < sorted.size(); ++r) {
+      bool duplicate =
+          r > 0 && index->tree().compareKeys(sorted[r - 1], sorted[r]) == 0;
+      index->tree().lookup(sorted[r], [&](const char *, RowId rid) {
+        duplicate |=
+            matched.count(static_cast<uint64_t>(rid.pageNo) << 32 | rid.slot) ==
+            0;
+        return !duplicate;
+      });
+      if (duplicate) {
+        std::cerr << "Duplicate entry '" << index->describeKey(sorted[r])
+                  << "' for primary key. Update aborted." << std::endl;
+        return;
       }
     }
-
-    outFile.write(rowBuffer.data(), rowWidth);
   }
 
-  inFile.close();
-  outFile.close();
-
-  if (violationDetected) {
+  ReferentialChanges childChanges;
+  if (!applyForeignKeyActions(dbName, tableName, layout, oldRows, matchedRids,
+                              updatedColumns, newValues.data(), txn,
+                              childChanges)) {
     std::cerr << "Foreign key constraint violation. Update aborted."
               << std::endl;
-    fs::remove(tempPath); // 删除临时文件
-  } else {
-    fs::remove(dataFilePath);
-    fs::rename(tempPath, dataFilePath);
+    return;
+  }
+  if (!logOf(dbName).commit(txn)) {
+    std::cerr << "Failed to write data. Update aborted." << std::endl;
+    return;
+  }
+
+  // 先去掉全部旧键再插入新键，行之间互换唯一键时不会冲突；
+  // 更新的行超过索引项的四分之一时直接从数据文件重建
+  for (TableIndex *index : affected) {
+    bool maintained = true;
+    if (matchedRids.size() > index->tree().size() / 4) {
+      maintained = index->rebuild(inFile);
+    } else {
+      for (size_t r = 0; r < matchedRids.size() && maintained; ++r) {
+        maintained =
+            index->erase(oldRows.data() + r * rowWidth, matchedRids[r]);
+      }
+      for (size_t r = 0; r < matchedRids.size() && maintained; ++r) {
+        maintained =
+            index->insert(newRows.data() + r * rowWidth, matchedRids[r]);
+      }
+    }
+    if (!maintained) {
+      TableIndex::invalidate(index->tree().path());
+    }
   }
+  maintainChildIndexes(dbName, childChanges);
 }
 
 void TableManager::orderByRecord(const std::string &dbName,
                                  const std::string &tableName,
                                  const std::vector<std::string> &sortColumn,
                                  const std::vector<std::string> &orders,
-                                 const std::vector<std::string> &fieldNames) {
-  Table table;
-  if (!loadTableSchema(dbName, tableName, table)) {
-    std::cerr << "Failed to load table schema." << std::endl;
-    return;
+                                 const std::vector<std::string> &fieldNames,
+                                 size_t limit, size_t offset) {
+  std::unique_ptr<ResultSet> result = queryOrdered(
+      dbName, tableName, sortColumn, orders, fieldNames, limit, offset);
+  if (result && !result->print(std::cout)) {
+    std::cerr << "Failed to sort records." << std::endl;
   }
+}
 
-  // 创建列索引映射
-  std::map<std::string, int> columnIndex;
-  for (size_t i = 0; i < table.columns.size(); ++i) {
-    columnIndex[table.columns[i].name] = i;
-  }
-
-  // 读取并排序数据
-  std::vector<std::vector<std::string>> records =
-      readSortTableData(dbName, tableName, table);
-
-  // 排序数据
-  std::sort(
-      records.begin(), records.end(),
-      [&columnIndex, &sortColumn, &orders](const std::vector<std::string> &a,
-                                           const std::vector<std::string> &b) {
-        for (size_t i = 0; i < sortColumn.size(); ++i) {
-          int colIndex = columnIndex[sortColumn[i]];
-          bool asc = orders[i] == "ASC";
-          if (a[colIndex] != b[colIndex])
-            return asc ? a[colIndex] < b[colIndex] : a[colIndex] > b[colIndex];
-        }
-
-        return false;
-      });
-
-  std::cout << std::endl;
-
-  // 输出表头
-  for (const auto &fieldName : fieldNames) {
-    std::cout << fieldName << "\t";
+std::unique_ptr<ResultSet> TableManager::queryOrdered(
+    const std::string &dbName, const std::string &tableName,
+    const std::vector<std::string> &sortColumn,
+    const std::vector<std::string> &orders,
+    const std::vector<std::string> &fieldNames, size_t limit, size_t offset) {
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
+    std::cerr << "Failed to load table schema." << std::endl;
+    return nullptr;
   }
 
-  std::cout << std::endl;
+  fs::path dataFilePath =
+      fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
+  HeapFile dataFile(dataFilePath, layout->rowWidth());
+  if (!dataFile.open()) {
+    std::cerr << "Failed to open data file for reading." << std::endl;
+    return nullptr;
+  }
+  if (mappedReads) {
+    dataFile.mapForRead();
+  }
 
-  // 打印排序后的数据
-  for (const auto &row : records) {
-    for (const auto &fieldName : fieldNames) {
-      int colIndex = columnIndex[fieldName];
-      std::cout << row[colIndex] << "\t";
+  // 创建列索引映射
+  std::vector<int> sortIndex = resolveColumns(*layout, sortColumn);
+  std::vector<int> projection = resolveColumns(*layout, fieldNames);
+  std::vector<ExternalSorter::Key> keys;
+  for (size_t i = 0; i < sortIndex.size(); ++i) {
+    keys.push_back({sortIndex[i], i >= orders.size() || orders[i] == "ASC"});
+  }
+  std::vector<ResultSet::Column> columns;
+  for (size_t i = 0; i < projection.size(); ++i) {
+    if (projection[i] != -1) {
+      columns.push_back({fieldNames[i], 0, projection[i]});
     }
-
-    std::cout << std::endl;
   }
+
+  // 只带上排序列和输出列，超过内存预算时溢出到数据文件旁的临时文件；
+  // 有 LIMIT 时排序器只需要保留前 offset + limit 行
+  size_t keep = limit > NO_LIMIT - offset ? NO_LIMIT : offset + limit;
+  auto sorter = std::make_unique<ExternalSorter>(layout, keys, projection,
+                                                 dataFilePath, keep);
+  bool ok = true;
+  bool scanned = dataFile.forEachRow([&](const char *row, RowId) {
+    ok = sorter->add(row);
+    return ok;
+  });
+  if (!scanned || !ok || !sorter->sort()) {
+    std::cerr << "Failed to sort records." << std::endl;
+    return nullptr;
+  }
+  return std::make_unique<ResultSet>(
+      std::vector<std::shared_ptr<const RowLayout>>{layout},
+      std::move(columns),
+      std::make_unique<SortSource>(std::move(sorter), layout->rowWidth()),
+      limit, offset);
 }
 
 std::vector<std::vector<std::string>>
@@ -767,43 +2142,25 @@ TableManager::readSortTableData(const std::string &dbName,
   std::vector<std::vector<std::string>> data;
   fs::path dataFilePath =
       fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
-  std::ifstream dataFile(dataFilePath, std::ios::binary);
+  RowLayout layout(std::make_shared<const Table>(table));
+  HeapFile dataFile(dataFilePath, layout.rowWidth());
 
-  if (!dataFile) {
+  if (!dataFile.open()) {
     std::cerr << "Failed to open data file for reading." << std::endl;
     return data;
   }
 
-  while (dataFile.peek() != EOF) {
+  dataFile.forEachRow([&](const char *row, RowId) {
     std::vector<std::string> record;
-    for (const auto &col : table.columns) {
-      std::string value;
-      if (col.type == "integer") {
-        int intVal;
-        dataFile.read(reinterpret_cast<char *>(&intVal), sizeof(intVal));
-        value = std::to_string(intVal);
-      } else if (col.type == "str") {
-        char buffer[256];
-        dataFile.read(buffer, col.length);
-        buffer[col.length] = '\0';
-        value = std::string(buffer);
-      } else if (col.type == "number") {
-        float numVal;
-        dataFile.read(reinterpret_cast<char *>(&numVal), sizeof(numVal));
-        value = std::to_string(numVal);
-      } else if (col.type == "bool") {
-        bool boolVal;
-        dataFile.read(reinterpret_cast<char *>(&boolVal), sizeof(boolVal));
-        value = boolVal ? "true" : "false";
-      }
-
-      record.push_back(value);
+    record.reserve(layout.columnCount());
+    for (int i = 0; i < layout.columnCount(); ++i) {
+      record.push_back(layout.toString(row, i));
     }
 
-    data.push_back(record);
-  }
+    data.push_back(std::move(record));
+    return true;
+  });
 
-  dataFile.close();
   return data;
 }
 
@@ -823,20 +2180,15 @@ void TableManager::alter_addColumnToTable(
     const std::vector<bool> &isPrimaryKeys,
     const std::vector<bool> &isNullables,
     const std::vector<std::string> &defaultValues) {
+  if (!checkpointDatabase(dbName)) {
+    return;
+  }
   fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
   fs::path dataFilePath = tableDirPath / (tableName + ".trd");
   fs::path tempFilePath = dataFilePath;
   tempFilePath += ".tmp";
   fs::path schemaFilePath = tableDirPath / (tableName + ".tdf");
 
-  std::ifstream inFile(dataFilePath, std::ios::binary);
-  std::ofstream outFile(tempFilePath, std::ios::binary);
-
-  if (!inFile || !outFile) {
-    std::cerr << "Failed to open files for processing." << std::endl;
-    return;
-  }
-
   Table table;
   if (!loadTableSchema(dbName, tableName, table)) {
     std::cerr << "Failed to load table schema." << std::endl;
@@ -844,42 +2196,48 @@ void TableManager::alter_addColumnToTable(
   }
 
   int originalRowWidth = calculateRowWidth(table.columns);
-  std::vector<char> rowBuffer(originalRowWidth);
+  size_t originalColumnCount = table.columns.size();
 
   for (size_t i = 0; i < columnNames.size(); ++i) {
     table.addColumn(columnNames[i], columnTypes[i], columnLengths[i],
                     isPrimaryKeys[i], isNullables[i], defaultValues[i]);
   }
 
-  int newRowWidth = calculateRowWidth(table.columns);
-  std::vector<char> newRowBuffer(newRowWidth);
+  // 新增列的默认值按新行格式编码一次，作为每一行的尾部
+  RowLayout newLayout(std::make_shared<const Table>(table));
+  int newRowWidth = newLayout.rowWidth();
+  std::vector<char> newRowBuffer(newRowWidth, '\0');
+  for (size_t i = originalColumnCount; i < table.columns.size(); ++i) {
+    if (!newLayout.encodeField(newRowBuffer.data(), i,
+                               table.columns[i].defaultValue)) {
+      std::cerr << "Invalid default value '" << table.columns[i].defaultValue
+                << "' for column '" << table.columns[i].name << "'."
+                << std::endl;
+      return;
+    }
+  }
+
+  HeapFile inFile(dataFilePath, originalRowWidth);
+  HeapFile outFile(tempFilePath, newRowWidth);
+
+  if (!inFile.open() || !outFile.create()) {
+    std::cerr << "Failed to open files for processing." << std::endl;
+    return;
+  }
 
   std::ofstream schemaOutFile(schemaFilePath,
                               std::ios::binary | std::ios::trunc);
   table.writeToDisk(schemaOutFile);
   schemaOutFile.close();
+  SchemaCatalog::instance().invalidate(dbName, tableName);
 
-  while (inFile.read(rowBuffer.data(), originalRowWidth)) {
-    std::memcpy(newRowBuffer.data(), rowBuffer.data(), originalRowWidth);
-
-    int startPosition = originalRowWidth;
-    for (size_t i = 0; i < columnNames.size(); ++i) {
-      std::string defaultValue = defaultValues[i];
-      defaultValue.resize(columnLengths[i],
-                          '\0'); // Ensure fixed-length columns
-      std::memcpy(newRowBuffer.data() + startPosition, defaultValue.data(),
-                  columnLengths[i]);
-      startPosition += columnLengths[i];
-    }
-
-    outFile.write(newRowBuffer.data(), newRowWidth);
-  }
-
-  inFile.close();
-  outFile.close();
+  inFile.forEachRow([&](const char *row, RowId) {
+    std::memcpy(newRowBuffer.data(), row, originalRowWidth);
+    return outFile.appendRow(newRowBuffer.data());
+  });
 
-  fs::remove(dataFilePath);
-  fs::rename(tempFilePath, dataFilePath);
+  HeapFile::replace(tempFilePath, dataFilePath);
+  TableIndex::invalidateAll(tableDirPath);
 
   std::cout << "Columns added successfully and data file updated." << std::endl;
 }
@@ -887,63 +2245,62 @@ void TableManager::alter_addColumnToTable(
 void TableManager::alter_deleteColumns(
     const std::string &dbName, const std::string &tableName,
     const std::vector<std::string> &columnsToDelete) {
+  if (!checkpointDatabase(dbName)) {
+    return;
+  }
   fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
   fs::path dataFilePath = tableDirPath / (tableName + ".trd");
   fs::path tempFilePath = dataFilePath;
   tempFilePath += ".tmp";
   fs::path schemaFilePath = tableDirPath / (tableName + ".tdf");
 
-  std::ifstream inFile(dataFilePath, std::ios::binary);
-  std::ofstream outFile(tempFilePath, std::ios::binary);
-
-  if (!inFile || !outFile) {
-    std::cerr << "Failed to open files for processing." << std::endl;
-    return;
-  }
-
-  Table table;
-  if (!loadTableSchema(dbName, tableName, table)) {
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
     std::cerr << "Failed to load table schema." << std::endl;
     return;
   }
-
-  int rowWidth = 0;
-  std::vector<int> fieldOffsets;
-  for (const auto &col : table.columns) {
-    fieldOffsets.push_back(rowWidth);
-    rowWidth += col.length;
-  }
-
-  std::vector<char> rowBuffer(rowWidth);
-  std::map<std::string, int> columnMap;
-  for (int i = 0; i < table.columns.size(); ++i) {
-    columnMap[table.columns[i].name] = i;
-  }
+  Table table = layout->table();
 
   std::set<int> columnsToSkip;
   for (const auto &colName : columnsToDelete) {
-    if (columnMap.find(colName) != columnMap.end()) {
-      columnsToSkip.insert(columnMap[colName]);
+    int idx = layout->columnIndex(colName);
+    if (idx != -1) {
+      columnsToSkip.insert(idx);
     }
   }
 
-  while (inFile.read(rowBuffer.data(), rowWidth)) {
-    for (int i = 0; i < table.columns.size(); ++i) {
-      if (columnsToSkip.find(i) == columnsToSkip.end()) {
-        outFile.write(rowBuffer.data() + fieldOffsets[i],
-                      table.columns[i].length);
-      }
+  // 保留下来的列在新行中是连续的，预先算好拷贝片段
+  std::vector<int> keptColumns;
+  int newRowWidth = 0;
+  for (int i = 0; i < layout->columnCount(); ++i) {
+    if (columnsToSkip.find(i) == columnsToSkip.end()) {
+      keptColumns.push_back(i);
+      newRowWidth += layout->field(i).width;
     }
   }
+  std::vector<char> newRowBuffer(newRowWidth);
 
-  inFile.close();
-  outFile.close();
+  HeapFile inFile(dataFilePath, layout->rowWidth());
+  HeapFile outFile(tempFilePath, newRowWidth);
 
-  std::vector<Table::Column> updatedColumns;
-  for (int i = 0; i < table.columns.size(); ++i) {
-    if (columnsToSkip.find(i) == columnsToSkip.end()) {
-      updatedColumns.push_back(table.columns[i]);
+  if (!inFile.open() || !outFile.create()) {
+    std::cerr << "Failed to open files for processing." << std::endl;
+    return;
+  }
+
+  inFile.forEachRow([&](const char *row, RowId) {
+    char *out = newRowBuffer.data();
+    for (int i : keptColumns) {
+      const RowLayout::Field &field = layout->field(i);
+      std::memcpy(out, row + field.offset, field.width);
+      out += field.width;
     }
+    return outFile.appendRow(newRowBuffer.data());
+  });
+
+  std::vector<Table::Column> updatedColumns;
+  for (int i : keptColumns) {
+    updatedColumns.push_back(table.columns[i]);
   }
   table.columns = updatedColumns; // Update the column list
 
@@ -955,9 +2312,47 @@ void TableManager::alter_deleteColumns(
   }
   table.writeToDisk(schemaOutFile);
   schemaOutFile.close();
-
-  fs::remove(dataFilePath);
-  fs::rename(tempFilePath, dataFilePath);
+  SchemaCatalog::instance().invalidate(dbName, tableName);
+
+  HeapFile::replace(tempFilePath, dataFilePath);
+  TableIndex::invalidateAll(tableDirPath);
+
+  // 索引定义按列名记录，用到被删列的索引连同索引文件一起删掉
+  std::vector<TableIndex::Definition> definitions =
+      TableIndex::readDefinitions(tableDirPath, tableName);
+  std::vector<TableIndex::Definition> keptDefinitions;
+  std::vector<std::string> droppedIndexes;
+  for (const auto &definition : definitions) {
+    bool uses = false;
+    for (const auto &colName : columnsToDelete) {
+      uses |= std::find(definition.columns.begin(), definition.columns.end(),
+                        colName) != definition.columns.end() ||
+              std::find(definition.include.begin(), definition.include.end(),
+                        colName) != definition.include.end();
+    }
+    if (uses) {
+      droppedIndexes.push_back(definition.name);
+    } else {
+      keptDefinitions.push_back(definition);
+    }
+  }
+  if (!droppedIndexes.empty()) {
+    if (!TableIndex::writeDefinitions(tableDirPath, tableName,
+                                      keptDefinitions)) {
+      std::cerr << "Failed to drop the indexes on the deleted columns."
+                << std::endl;
+      return;
+    }
+    for (const auto &indexName : droppedIndexes) {
+      fs::path indexPath =
+          tableDirPath / (tableName + "." + indexName + ".tid");
+      BufferPool::instance().dropFile(indexPath);
+      std::error_code ec;
+      fs::remove(indexPath, ec);
+      std::cout << "Index '" << indexName << "' dropped with its columns."
+                << std::endl;
+    }
+  }
 
   std::cout << "Specified columns have been successfully deleted from the file "
                "and the schema updated."
@@ -967,6 +2362,9 @@ void TableManager::alter_deleteColumns(
 bool TableManager::renameTable(const std::string &dbName,
                                const std::string &oldTableName,
                                const std::string &newTableName) {
+  if (!checkpointDatabase(dbName)) {
+    return false;
+  }
   fs::path dbPath = fs::current_path() / "DB" / dbName;
   fs::path recoverPath = fs::current_path() / "Recover" / dbName;
   fs::path oldTablePath = dbPath / oldTableName;
@@ -979,6 +2377,10 @@ bool TableManager::renameTable(const std::string &dbName,
     return false;
   }
 
+  // 写回并丢弃旧路径下的缓存页
+  BufferPool::instance().flushDirectory(oldTablePath);
+  BufferPool::instance().dropDirectory(oldTablePath);
+
   // 重命名表文件夹
   try {
     fs::rename(oldTablePath, newTablePath);
@@ -986,20 +2388,27 @@ bool TableManager::renameTable(const std::string &dbName,
     std::cerr << "Failed to rename table directory: " << e.what() << std::endl;
     return false;
   }
+  SchemaCatalog::instance().invalidate(dbName, oldTableName);
+  SchemaCatalog::instance().invalidate(dbName, newTableName);
 
-  // 更新文件夹中所有相关文件的名称
-  std::vector<std::string> fileExtensions = {".tdf", ".trd", ".tid"};
-  for (const auto &ext : fileExtensions) {
-    fs::path oldFilePath = newTablePath / (oldTableName + ext);
-    fs::path newFilePath = newTablePath / (newTableName + ext);
-    if (fs::exists(oldFilePath)) {
-      try {
-        fs::rename(oldFilePath, newFilePath);
-      } catch (const fs::filesystem_error &e) {
-        std::cerr << "Failed to rename file '" << oldFilePath << "' to '"
-                  << newFilePath << "': " << e.what() << std::endl;
-        return false;
-      }
+  // 更新文件夹中所有相关文件的名称（.tdf、.trd 以及各个 .tid 索引文件）
+  std::vector<fs::path> oldFilePaths;
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(newTablePath, ec)) {
+    if (entry.path().filename().string().rfind(oldTableName + ".", 0) == 0) {
+      oldFilePaths.push_back(entry.path());
+    }
+  }
+  for (const auto &oldFilePath : oldFilePaths) {
+    fs::path newFilePath =
+        newTablePath / (newTableName + oldFilePath.filename().string().substr(
+                                           oldTableName.size()));
+    try {
+      fs::rename(oldFilePath, newFilePath);
+    } catch (const fs::filesystem_error &e) {
+      std::cerr << "Failed to rename file '" << oldFilePath << "' to '"
+                << newFilePath << "': " << e.what() << std::endl;
+      return false;
     }
   }
 
@@ -1050,6 +2459,11 @@ void TableManager::useDatabase(const std::string &dbName) {
   std::cout << "Database changed to: " << dbName << std::endl;
 }
 
+void TableManager::setParallelism(size_t degree) {
+  parallelism =
+      degree != 0 ? degree : std::max(1u, std::thread::hardware_concurrency());
+}
+
 std::string TableManager::selectDatabase() const {
   return currentDatabase.empty() ? "No database selected." : currentDatabase;
 }
@@ -1091,8 +2505,9 @@ void TableManager::describeTable(const std::string &tableName) {
     return;
   }
 
-  Table table;
-  if (!loadTableSchema(currentDatabase, tableName, table)) {
+  std::shared_ptr<const Table> table =
+      getTableSchema(currentDatabase, tableName);
+  if (!table) {
     std::cerr << "Failed to load table schema." << std::endl;
     return;
   }
@@ -1106,7 +2521,7 @@ void TableManager::describeTable(const std::string &tableName) {
             << std::endl;
 
   // 打印每列的信息
-  for (const auto &column : table.columns) {
+  for (const auto &column : table->columns) {
     std::cout << std::left << std::setw(15) << column.name << std::setw(10)
               << column.type << std::setw(10) << column.length << std::setw(15)
               << (column.isPrimaryKey ? "True" : "False") << std::setw(10)
@@ -1115,13 +2530,13 @@ void TableManager::describeTable(const std::string &tableName) {
   }
 
   // 打印外键信息
-  if (!table.foreignKeys.empty()) {
+  if (!table->foreignKeys.empty()) {
     std::cout << "\nForeign Keys:\n";
     std::cout << std::left << std::setw(15) << "Column" << std::setw(20)
               << "References Table" << std::setw(20) << "References Column"
               << std::setw(10) << "On Delete" << std::setw(10) << "On Update"
               << std::endl;
-    for (const auto &foreignKey : table.foreignKeys) {
+    for (const auto &foreignKey : table->foreignKeys) {
       std::string columnName = foreignKey.columnName;
       columnName.erase(std::remove(columnName.begin(), columnName.end(), '\0'),
                        columnName.end());
@@ -1193,12 +2608,18 @@ void TableManager::showCreateTable(const std::string &dbName,
 
 void TableManager::truncateTable(const std::string &dbName,
                                  const std::string &tableName) {
+  if (!checkpointDatabase(dbName)) {
+    return;
+  }
   // 数据文件路径
   fs::path dataFilePath =
       fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
 
-  // 打开数据文件并清空内容
+  // 丢弃缓存页后打开数据文件并清空内容
+  BufferPool::instance().dropFile(dataFilePath);
   std::ofstream dataFile(dataFilePath, std::ios::trunc);
+  TableIndex::invalidateAll(dataFilePath.parent_path());
+  ZoneMap::remove(dataFilePath);
   if (!dataFile.is_open()) {
     std::cerr << "Failed to truncate table. Unable to open data file."
               << std::endl;
@@ -1215,12 +2636,24 @@ void TableManager::innerJoin(const std::string &dbName,
                              const std::string &column1,
                              const std::string &column2,
                              const std::vector<std::string> &selectColumns) {
-  Table tableA, tableB;
-  if (!loadTableSchema(dbName, table1, tableA) ||
-      !loadTableSchema(dbName, table2, tableB)) {
+  std::unique_ptr<ResultSet> result =
+      queryJoin(dbName, table1, table2, column1, column2, selectColumns);
+  if (result) {
+    result->print(std::cout);
+  }
+}
+
+std::unique_ptr<ResultSet>
+TableManager::queryJoin(const std::string &dbName, const std::string &table1,
+                        const std::string &table2, const std::string &column1,
+                        const std::string &column2,
+                        const std::vector<std::string> &selectColumns) {
+  std::shared_ptr<const RowLayout> layoutA = getRowLayout(dbName, table1);
+  std::shared_ptr<const RowLayout> layoutB = getRowLayout(dbName, table2);
+  if (!layoutA || !layoutB) {
     std::cerr << "Error loading table schema for one or both tables."
               << std::endl;
-    return;
+    return nullptr;
   }
 
   fs::path dataFilePath1 =
@@ -1228,162 +2661,72 @@ void TableManager::innerJoin(const std::string &dbName,
   fs::path dataFilePath2 =
       fs::current_path() / "DB" / dbName / table2 / (table2 + ".trd");
 
-  std::ifstream dataFile1(dataFilePath1, std::ios::binary);
-  std::ifstream dataFile2(dataFilePath2, std::ios::binary);
+  HeapFile dataFile1(dataFilePath1, layoutA->rowWidth());
+  HeapFile dataFile2(dataFilePath2, layoutB->rowWidth());
 
-  if (!dataFile1 || !dataFile2) {
+  if (!dataFile1.open() || !dataFile2.open()) {
     std::cerr << "Failed to open data files for one or both tables."
               << std::endl;
-    return;
+    return nullptr;
+  }
+  if (mappedReads) {
+    dataFile1.mapForRead();
+    dataFile2.mapForRead();
   }
 
   // 获取连接列的索引
-  int colIdx1 = -1, colIdx2 = -1;
-  for (size_t i = 0; i < tableA.columns.size(); ++i) {
-    if (tableA.columns[i].name == column1) {
-      colIdx1 = i;
-      break;
-    }
-  }
-  for (size_t i = 0; i < tableB.columns.size(); ++i) {
-    if (tableB.columns[i].name == column2) {
-      colIdx2 = i;
-      break;
-    }
-  }
+  int colIdx1 = layoutA->columnIndex(column1);
+  int colIdx2 = layoutB->columnIndex(column2);
 
   if (colIdx1 == -1 || colIdx2 == -1) {
     std::cerr << "One or both columns for join not found." << std::endl;
-    return;
+    return nullptr;
   }
 
-  std::cout << std::endl;
-
-  // 输出选择的列作为表头
+  // 解析输出列：优先取表1的同名列，否则取表2
+  std::vector<ResultSet::Column> columns;
   for (const auto &col : selectColumns) {
-    std::cout << col << "\t";
-  }
-  std::cout << std::endl;
-
-  // 计算每行的宽度和列的偏移量
-  int rowWidth1 = 0, rowWidth2 = 0;
-  std::vector<int> fieldOffsets1, fieldOffsets2;
-  for (const auto &col : tableA.columns) {
-    fieldOffsets1.push_back(rowWidth1);
-    rowWidth1 += col.length;
-  }
-  for (const auto &col : tableB.columns) {
-    fieldOffsets2.push_back(rowWidth2);
-    rowWidth2 += col.length;
-  }
-
-  // 创建列名到索引的映射
-  std::map<std::string, int> columnMapA, columnMapB;
-  for (int i = 0; i < tableA.columns.size(); ++i) {
-    columnMapA[tableA.columns[i].name] = i;
-  }
-  for (int i = 0; i < tableB.columns.size(); ++i) {
-    columnMapB[tableB.columns[i].name] = i;
-  }
-
-  // 读取并匹配行数据
-  std::vector<char> rowBuffer1(rowWidth1);
-  std::vector<char> rowBuffer2(rowWidth2);
-
-  while (dataFile1.read(rowBuffer1.data(), rowWidth1)) {
-    std::string value1(rowBuffer1.data() + fieldOffsets1[colIdx1],
-                       tableA.columns[colIdx1].length);
-    value1.erase(std::remove(value1.begin(), value1.end(), '\0'), value1.end());
-
-    dataFile2.clear();                 // 重置EOF标志
-    dataFile2.seekg(0, std::ios::beg); // 重置文件指针
-
-    while (dataFile2.read(rowBuffer2.data(), rowWidth2)) {
-      std::string value2(rowBuffer2.data() + fieldOffsets2[colIdx2],
-                         tableB.columns[colIdx2].length);
-      value2.erase(std::remove(value2.begin(), value2.end(), '\0'),
-                   value2.end());
-
-      bool match = false;
-      if (tableA.columns[colIdx1].type == "integer" ||
-          tableA.columns[colIdx1].type == "number") {
-        if (tableA.columns[colIdx1].type == "integer") {
-          int intValue1, intValue2;
-          memcpy(&intValue1, rowBuffer1.data() + fieldOffsets1[colIdx1],
-                 sizeof(intValue1));
-          memcpy(&intValue2, rowBuffer2.data() + fieldOffsets2[colIdx2],
-                 sizeof(intValue2));
-          match = (intValue1 == intValue2);
-        } else if (tableA.columns[colIdx1].type == "number") {
-          float floatValue1, floatValue2;
-          memcpy(&floatValue1, rowBuffer1.data() + fieldOffsets1[colIdx1],
-                 sizeof(floatValue1));
-          memcpy(&floatValue2, rowBuffer2.data() + fieldOffsets2[colIdx2],
-                 sizeof(floatValue2));
-          match = (floatValue1 == floatValue2);
-        }
-      } else {
-        match = (value1 == value2);
-      }
-
-      if (match) {
-        for (const auto &col : selectColumns) {
-          bool found = false;
-          for (const auto &aCol : tableA.columns) {
-            if (aCol.name == col) {
-              found = true;
-              std::string value(rowBuffer1.data() +
-                                    fieldOffsets1[columnMapA[aCol.name]],
-                                aCol.length);
-              if (aCol.type == "integer") {
-                int intValue;
-                memcpy(&intValue, value.data(), sizeof(intValue));
-                value = std::to_string(intValue);
-              } else if (aCol.type == "number") {
-                float floatValue;
-                memcpy(&floatValue, value.data(), sizeof(floatValue));
-                value = std::to_string(floatValue);
-              } else {
-                value.erase(std::remove(value.begin(), value.end(), '\0'),
-                            value.end());
-              }
-
-              std::cout << value << "\t";
-              break;
-            }
-          }
-          if (!found) {
-            for (const auto &bCol : tableB.columns) {
-              if (bCol.name == col) {
-                std::string value(rowBuffer2.data() +
-                                      fieldOffsets2[columnMapB[bCol.name]],
-                                  bCol.length);
-                if (bCol.type == "integer") {
-                  int intValue;
-                  memcpy(&intValue, value.data(), sizeof(intValue));
-                  value = std::to_string(intValue);
-                } else if (bCol.type == "number") {
-                  float floatValue;
-                  memcpy(&floatValue, value.data(), sizeof(floatValue));
-                  value = std::to_string(floatValue);
-                } else {
-                  value.erase(std::remove(value.begin(), value.end(), '\0'),
-                              value.end());
-                }
-
-                std::cout << value << "\t";
-                break;
-              }
-            }
-          }
-        }
-        std::cout << std::endl;
-      }
+    int idx = layoutA->columnIndex(col);
+    if (idx != -1) {
+      columns.push_back({col, 0, idx});
+    } else if ((idx = layoutB->columnIndex(col)) != -1) {
+      columns.push_back({col, 1, idx});
     }
   }
 
-  dataFile1.close();
-  dataFile2.close();
+  // 连接列恰好是单列主键时，主键索引可以按连接键有序地读出两张表
+  auto joinIndex = [&](const fs::path &dataFilePath, const std::string &name,
+                       const std::shared_ptr<const RowLayout> &layout,
+                       const HeapFile &heap, int column) {
+    std::unique_ptr<TableIndex> index =
+        TableIndex::forPrimaryKey(dataFilePath.parent_path(), name, layout);
+    if (index && (index->columns().size() != 1 ||
+                  index->columns()[0] != column || !index->open(heap))) {
+      index.reset();
+    }
+    return index;
+  };
+  std::unique_ptr<TableIndex> indexA =
+      joinIndex(dataFilePath1, table1, layoutA, dataFile1, colIdx1);
+  std::unique_ptr<TableIndex> indexB =
+      joinIndex(dataFilePath2, table2, layoutB, dataFile2, colIdx2);
+
+  JoinOperator join({layoutA, &dataFile1, colIdx1, indexA.get()},
+                    {layoutB, &dataFile2, colIdx2, indexB.get()});
+  // 连接算子是推送式的，结果行先暂存，再由结果集按批返回
+  auto spool = std::make_unique<SpoolSource>(
+      std::vector<int>{layoutA->rowWidth(), layoutB->rowWidth()});
+  bool ok = join.run([&](const char *row1, const char *row2) {
+    const char *rows[] = {row1, row2};
+    spool->append(rows);
+  });
+  if (!ok) {
+    std::cerr << "Failed to read data files while joining." << std::endl;
+    return nullptr;
+  }
+  return std::make_unique<ResultSet>(
+      std::vector<std::shared_ptr<const RowLayout>>{layoutA, layoutB},
+      std::move(columns), std::move(spool));
 }
 
 void TableManager::alter_addForeignKey(const std::string &dbName,
@@ -1408,6 +2751,7 @@ void TableManager::alter_addForeignKey(const std::string &dbName,
   std::ofstream schemaFile(schemaFilePath, std::ios::binary);
   table.writeToDisk(schemaFile);
   schemaFile.close();
+  SchemaCatalog::instance().invalidate(dbName, tableName);
 
   std::cout << "Foreign key added successfully." << std::endl;
 }
@@ -1429,173 +2773,59 @@ void TableManager::alter_deleteForeignKey(const std::string &dbName,
   std::ofstream schemaFile(schemaFilePath, std::ios::binary);
   table.writeToDisk(schemaFile);
   schemaFile.close();
+  SchemaCatalog::instance().invalidate(dbName, tableName);
 
   std::cout << "Foreign key deleted successfully." << std::endl;
 }
 
-bool TableManager::handleForeignKeyAction(const std::string &dbName,
-                                          const Table &table,
-                                          const std::string &columnName,
-                                          const std::string &value,
-                                          Table::ForeignKeyAction action) {
-  for (const auto &fk : table.foreignKeys) {
-    if (fk.columnName == columnName) {
-      Table childTable;
-      if (!loadTableSchema(dbName, fk.referenceTable, childTable)) {
-        std::cerr << "Failed to load schema for child table: "
-                  << fk.referenceTable << std::endl;
-        continue;
-      }
-
-      fs::path dataFilePath = fs::current_path() / "DB" / dbName /
-                              fk.referenceTable / (fk.referenceTable + ".trd");
-      fs::path tempPath = dataFilePath;
-      tempPath += ".tmp";
-
-      std::ifstream inFile(dataFilePath, std::ios::binary);
-      std::ofstream outFile(tempPath, std::ios::binary);
-
-      if (!inFile || !outFile) {
-        std::cerr << "Failed to open files for processing." << std::endl;
-        continue;
-      }
-
-      int rowWidth = 0;
-      std::vector<int> fieldOffsets;
-      for (const auto &col : childTable.columns) {
-        fieldOffsets.push_back(rowWidth);
-        rowWidth += col.length;
-      }
-
-      std::vector<char> rowBuffer(rowWidth);
-      std::map<std::string, int> columnMap;
-      for (int i = 0; i < childTable.columns.size(); ++i) {
-        columnMap[childTable.columns[i].name] = i;
-      }
-
-      bool foreignKeyFound = false;
-
-      while (inFile.read(rowBuffer.data(), rowWidth)) {
-        std::string fieldValue(
-            rowBuffer.data() + fieldOffsets[columnMap[fk.referenceColumn]],
-            childTable.columns[columnMap[fk.referenceColumn]].length);
-        fieldValue.erase(
-            std::remove(fieldValue.begin(), fieldValue.end(), '\0'),
-            fieldValue.end());
-
-        if (fieldValue == value) {
-          foreignKeyFound = true;
-          if (action == Table::ForeignKeyAction::RESTRICT ||
-              action == Table::ForeignKeyAction::NOACTION) {
-            inFile.close();
-            outFile.close();
-            fs::remove(tempPath);
-            return false;
-          } else if (action == Table::ForeignKeyAction::CASCADE) {
-            continue;
-          } else if (action == Table::ForeignKeyAction::SET_NULL) {
-            std::memset(
-                rowBuffer.data() + fieldOffsets[columnMap[fk.referenceColumn]],
-                '\0', childTable.columns[columnMap[fk.referenceColumn]].length);
-          } else if (action == Table::ForeignKeyAction::SET_DEFAULT) {
-            std::string defaultValue =
-                childTable.columns[columnMap[fk.referenceColumn]].defaultValue;
-            std::memcpy(
-                rowBuffer.data() + fieldOffsets[columnMap[fk.referenceColumn]],
-                defaultValue.c_str(),
-                childTable.columns[columnMap[fk.referenceColumn]].length);
-          }
-        }
-
-        outFile.write(rowBuffer.data(), rowWidth);
-      }
-
-      inFile.close();
-      outFile.close();
-
-      if (action == Table::ForeignKeyAction::CASCADE && foreignKeyFound) {
-        fs::remove(dataFilePath);
-        fs::rename(tempPath, dataFilePath);
-      } else if (foreignKeyFound &&
-                 (action == Table::ForeignKeyAction::SET_NULL ||
-                  action == Table::ForeignKeyAction::SET_DEFAULT)) {
-        fs::remove(dataFilePath);
-        fs::rename(tempPath, dataFilePath);
-      } else {
-        fs::remove(tempPath);
-      }
-    }
-  }
-  return true;
-}
-
 std::vector<std::string>
 TableManager::readColumnData(const std::string &dbName,
                              const std::string &tableName,
                              const std::string &columnName) {
   fs::path dataFilePath =
-      fs::current_path() / dbName / tableName / (tableName + ".trd");
+      fs::current_path() / "DB" / dbName / tableName / (tableName + ".trd");
   std::vector<std::string> columnData;
 
-  Table table;
-  if (!loadTableSchema(dbName, tableName, table)) {
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  if (!layout) {
     std::cerr << "Failed to load table schema." << std::endl;
     return columnData;
   }
 
-  std::ifstream dataFile(dataFilePath, std::ios::binary);
-  if (!dataFile) {
-    std::cerr << "Failed to open data file for reading." << std::endl;
+  int columnIndex = layout->columnIndex(columnName);
+  if (columnIndex == -1) {
+    std::cerr << "Column not found." << std::endl;
     return columnData;
   }
 
-  int rowWidth = 0;
-  std::vector<int> fieldOffsets;
-  for (const auto &col : table.columns) {
-    fieldOffsets.push_back(rowWidth);
-    rowWidth += col.length;
-  }
-
-  std::vector<char> rowBuffer(rowWidth);
-  std::string fieldValue;
-
-  std::map<std::string, int> columnMap;
-  for (int i = 0; i < table.columns.size(); ++i) {
-    columnMap[table.columns[i].name] = i;
-  }
-
-  if (columnMap.find(columnName) == columnMap.end()) {
-    std::cerr << "Column not found." << std::endl;
+  HeapFile dataFile(dataFilePath, layout->rowWidth());
+  if (!dataFile.open()) {
+    std::cerr << "Failed to open data file for reading." << std::endl;
     return columnData;
   }
-
-  int columnIndex = columnMap[columnName];
-  const auto &colType = table.columns[columnIndex].type;
-
-  while (dataFile.read(rowBuffer.data(), rowWidth)) {
-    if (colType == "integer") {
-      // Assumes integer is stored in binary format
-      int intValue;
-      memcpy(&intValue, rowBuffer.data() + fieldOffsets[columnIndex],
-             sizeof(int));
-      columnData.push_back(std::to_string(intValue));
-    } else if (colType == "number") {
-      // Assumes number is stored as a floating point number
-      float floatValue;
-      memcpy(&floatValue, rowBuffer.data() + fieldOffsets[columnIndex],
-             sizeof(float));
-      columnData.push_back(std::to_string(floatValue));
-    } else {
-      // Default case: treat as string
-      fieldValue.assign(rowBuffer.data() + fieldOffsets[columnIndex],
-                        table.columns[columnIndex].length);
-      fieldValue.erase(std::remove(fieldValue.begin(), fieldValue.end(), '\0'),
-                       fieldValue.end());
-      columnData.push_back(fieldValue);
-    }
+  if (mappedReads) {
+    dataFile.mapForRead();
   }
 
-  dataFile.close();
+  // 各 morsel 的结果分开保存，扫描结束后按顺序拼接
+  ParallelScan scan(dataFile, parallelism);
+  std::vector<std::vector<std::string>> parts(scan.morsels());
+  scan.run([&](size_t, size_t morsel) {
+    dataFile.forEachBatch(
+        scan.firstPage(morsel), scan.endPage(morsel),
+        [&](const HeapFile::Batch &batch) {
+          for (uint32_t i = 0; i < batch.count; ++i) {
+            parts[morsel].push_back(
+                layout->toString(batch.rows[i], columnIndex));
+          }
+          return true;
+        });
+    return true;
+  });
+  for (auto &part : parts) {
+    columnData.insert(columnData.end(), std::make_move_iterator(part.begin()),
+                      std::make_move_iterator(part.end()));
+  }
   return columnData;
 }
 
@@ -1606,6 +2836,9 @@ void TableManager::changeColumn(const std::string &dbName,
                                 const std::string &newType, int newLength,
                                 bool newIsPrimaryKey, bool newIsNullable,
                                 const std::string &newDefaultValue) {
+  if (!checkpointDatabase(dbName)) {
+    return;
+  }
   Table table;
   if (!loadTableSchema(dbName, tableName, table)) {
     std::cerr << "Failed to load table schema." << std::endl;
@@ -1628,15 +2861,30 @@ void TableManager::changeColumn(const std::string &dbName,
   it->defaultValue = newDefaultValue;
 
   // Prepare paths for the original and temporary schema files
-  fs::path tableDirPath = fs::current_path() / dbName / tableName;
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
   fs::path tempSchemaFilePath = tableDirPath / (tableName + "_temp.tdf");
   fs::path schemaFilePath = tableDirPath / (tableName + ".tdf");
+  fs::path dataFilePath = tableDirPath / (tableName + ".trd");
+  fs::path tempDataFilePath = dataFilePath;
+  tempDataFilePath += ".tmp";
+
+  // 类型或长度变了时先按新行格式改写出临时数据文件，有值转换不了就拒绝修改
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  bool rewrite = false;
+  if (!layout || !convertColumns(dataFilePath, tempDataFilePath, *layout,
+                                 table, rewrite)) {
+    std::cerr << "Column '" << oldName << "' was not changed." << std::endl;
+    return;
+  }
 
   // Open the temporary schema file for writing
   std::ofstream schemaFile(tempSchemaFilePath, std::ios::binary);
   if (!schemaFile) {
     std::cerr << "Failed to open temporary schema file for writing."
               << std::endl;
+    if (rewrite) {
+      HeapFile::discard(tempDataFilePath);
+    }
     return;
   }
 
@@ -1649,16 +2897,39 @@ void TableManager::changeColumn(const std::string &dbName,
     fs::remove(tempSchemaFilePath); // Cleanup temporary file on failure
     std::cerr << "Failed to write to the temporary schema file correctly."
               << std::endl;
+    if (rewrite) {
+      HeapFile::discard(tempDataFilePath);
+    }
     return;
   }
 
   // Replace the original schema file with the updated temporary file
   try {
     fs::rename(tempSchemaFilePath, schemaFilePath);
+    SchemaCatalog::instance().invalidate(dbName, tableName);
+    if (rewrite) {
+      HeapFile::replace(tempDataFilePath, dataFilePath);
+    }
+    TableIndex::invalidateAll(tableDirPath);
+    // 索引定义按列名记录，跟着改名
+    std::vector<TableIndex::Definition> definitions =
+        TableIndex::readDefinitions(tableDirPath, tableName);
+    for (auto &definition : definitions) {
+      std::replace(definition.columns.begin(), definition.columns.end(),
+                   oldName, newName);
+      std::replace(definition.include.begin(), definition.include.end(),
+                   oldName, newName);
+    }
+    if (!definitions.empty()) {
+      TableIndex::writeDefinitions(tableDirPath, tableName, definitions);
+    }
     std::cout << "Table schema successfully updated." << std::endl;
   } catch (const fs::filesystem_error &e) {
     std::cerr << "Failed to replace the old schema file: " << e.what()
               << std::endl;
+    if (rewrite) {
+      HeapFile::discard(tempDataFilePath);
+    }
   }
 }
 
@@ -1668,6 +2939,9 @@ void TableManager::modifyColumn(const std::string &dbName,
                                 const std::string &newType, int newLength,
                                 bool newIsPrimaryKey, bool newIsNullable,
                                 const std::string &newDefaultValue) {
+  if (!checkpointDatabase(dbName)) {
+    return;
+  }
   Table table;
   if (!loadTableSchema(dbName, tableName, table)) {
     std::cerr << "Failed to load table schema." << std::endl;
@@ -1689,15 +2963,30 @@ void TableManager::modifyColumn(const std::string &dbName,
   it->defaultValue = newDefaultValue;
 
   // 准备临时和原始模式文件的路径
-  fs::path tableDirPath = fs::current_path() / dbName / tableName;
+  fs::path tableDirPath = fs::current_path() / "DB" / dbName / tableName;
   fs::path tempSchemaFilePath = tableDirPath / (tableName + "_temp.tdf");
   fs::path schemaFilePath = tableDirPath / (tableName + ".tdf");
+  fs::path dataFilePath = tableDirPath / (tableName + ".trd");
+  fs::path tempDataFilePath = dataFilePath;
+  tempDataFilePath += ".tmp";
+
+  // 类型或长度变了时先按新行格式改写出临时数据文件，有值转换不了就拒绝修改
+  std::shared_ptr<const RowLayout> layout = getRowLayout(dbName, tableName);
+  bool rewrite = false;
+  if (!layout || !convertColumns(dataFilePath, tempDataFilePath, *layout,
+                                 table, rewrite)) {
+    std::cerr << "Column '" << name << "' was not changed." << std::endl;
+    return;
+  }
 
   // 打开临时模式文件进行写入
   std::ofstream schemaFile(tempSchemaFilePath, std::ios::binary);
   if (!schemaFile) {
     std::cerr << "Failed to open temporary schema file for writing."
               << std::endl;
+    if (rewrite) {
+      HeapFile::discard(tempDataFilePath);
+    }
     return;
   }
 
@@ -1710,18 +2999,29 @@ void TableManager::modifyColumn(const std::string &dbName,
     fs::remove(tempSchemaFilePath); // 失败时清理临时文件
     std::cerr << "Failed to write to the temporary schema file correctly."
               << std::endl;
+    if (rewrite) {
+      HeapFile::discard(tempDataFilePath);
+    }
     return;
   }
 
   // 使用更新后的临时文件替换原始文件
   try {
     fs::rename(tempSchemaFilePath, schemaFilePath);
+    SchemaCatalog::instance().invalidate(dbName, tableName);
+    if (rewrite) {
+      HeapFile::replace(tempDataFilePath, dataFilePath);
+    }
+    TableIndex::invalidateAll(tableDirPath);
     std::cout
         << "Table schema successfully updated with new primary key settings."
         << std::endl;
   } catch (const fs::filesystem_error &e) {
     std::cerr << "Failed to replace the old schema file: " << e.what()
               << std::endl;
+    if (rewrite) {
+      HeapFile::discard(tempDataFilePath);
+    }
   }
 }
 
@@ -0,0 +1,178 @@
+#include "Entity/execution/Aggregator.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+namespace {
+using State = Aggregator::State;
+
+template <typename T> T loadField(const char *row, int offset, int width) {
+  T value = 0;
+  std::memcpy(&value, row + offset, std::min<size_t>(sizeof(value), width));
+  return value;
+}
+
+void addInt(State &state, int64_t value) {
+  ++state.count;
+  state.intSum += value;
+  state.intMin = std::min(state.intMin, value);
+  state.intMax = std::max(state.intMax, value);
+}
+
+void addDouble(State &state, double value) {
+  ++state.count;
+  state.doubleSum += value;
+  state.doubleMin = std::min(state.doubleMin, value);
+  state.doubleMax = std::max(state.doubleMax, value);
+}
+} // namespace
+
+bool Aggregator::parseFunction(const std::string &name, Function &function) {
+  static const std::pair<const char *, Function> functions[] = {
+      {"COUNT", Function::Count},
+      {"SUM", Function::Sum},
+      {"AVG", Function::Avg},
+      {"MIN", Function::Min},
+      {"MAX", Function::Max}};
+  std::string upper = name;
+  std::transform(upper.begin(), upper.end(), upper.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  for (const auto &[text, value] : functions) {
+    if (upper == text) {
+      function = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Aggregator::add(const RowLayout &layout, Function function,
+                     const std::string &columnName) {
+  Term term{function, -1, 0, 0, RowLayout::ColumnType::Unknown};
+  if (columnName == "*" && function == Function::Count) {
+    terms.push_back(term);
+    return true;
+  }
+
+  term.column = layout.columnIndex(columnName);
+  if (term.column == -1) {
+    std::cerr << "Column '" << columnName << "' not found." << std::endl;
+    return false;
+  }
+  term.offset = layout.field(term.column).offset;
+  term.width = layout.field(term.column).width;
+  term.type = layout.type(term.column);
+  if (function != Function::Count && !layout.isNumeric(term.column)) {
+    std::cerr << "Column '" << columnName
+              << "' is not numeric and cannot be aggregated." << std::endl;
+    return false;
+  }
+  terms.push_back(term);
+  return true;
+}
+
+void Aggregator::accumulate(const HeapFile::Batch &batch,
+                            const uint16_t *selection, uint32_t selected,
+                            State *states) const {
+  for (size_t t = 0; t < terms.size(); ++t) {
+    const Term &term = terms[t];
+    State &state = states[t];
+    if (term.function == Function::Count) {
+      if (term.type != RowLayout::ColumnType::Str) {
+        state.count += selected;
+        continue;
+      }
+      for (uint32_t i = 0; i < selected; ++i) {
+        state.count += batch.rows[selection[i]][term.offset] != '\0';
+      }
+      continue;
+    }
+    // 每个聚合各跑一趟紧凑的循环，只读一个字段
+    if (term.type == RowLayout::ColumnType::Integer) {
+      for (uint32_t i = 0; i < selected; ++i) {
+        addInt(state, loadField<int32_t>(batch.rows[selection[i]], term.offset,
+                                         term.width));
+      }
+    } else {
+      for (uint32_t i = 0; i < selected; ++i) {
+        addDouble(state, loadField<float>(batch.rows[selection[i]],
+                                          term.offset, term.width));
+      }
+    }
+  }
+}
+
+void Aggregator::accumulate(const char *row, State *states) const {
+  for (size_t t = 0; t < terms.size(); ++t) {
+    const Term &term = terms[t];
+    if (term.function == Function::Count) {
+      states[t].count +=
+          term.type != RowLayout::ColumnType::Str || row[term.offset] != '\0';
+    } else if (term.type == RowLayout::ColumnType::Integer) {
+      addInt(states[t], loadField<int32_t>(row, term.offset, term.width));
+    } else {
+      addDouble(states[t], loadField<float>(row, term.offset, term.width));
+    }
+  }
+}
+
+void Aggregator::merge(State *into, const State *from) const {
+  for (size_t t = 0; t < terms.size(); ++t) {
+    into[t].count += from[t].count;
+    into[t].intSum += from[t].intSum;
+    into[t].doubleSum += from[t].doubleSum;
+    into[t].intMin = std::min(into[t].intMin, from[t].intMin);
+    into[t].intMax = std::max(into[t].intMax, from[t].intMax);
+    into[t].doubleMin = std::min(into[t].doubleMin, from[t].doubleMin);
+    into[t].doubleMax = std::max(into[t].doubleMax, from[t].doubleMax);
+  }
+}
+
+Aggregator::Value Aggregator::result(size_t i, const State &state) const {
+  const Term &term = terms[i];
+  bool isInteger = term.type == RowLayout::ColumnType::Integer;
+  Value value;
+  if (term.function == Function::Count) {
+    value.isNull = false;
+    value.isInteger = true;
+    value.intValue = state.count;
+    return value;
+  }
+  if (state.count == 0) {
+    return value;
+  }
+
+  value.isNull = false;
+  value.isInteger = isInteger && term.function != Function::Avg;
+  switch (term.function) {
+  case Function::Sum:
+    value.intValue = state.intSum;
+    value.doubleValue = state.doubleSum;
+    break;
+  case Function::Avg:
+    value.doubleValue =
+        (isInteger ? static_cast<double>(state.intSum) : state.doubleSum) /
+        static_cast<double>(state.count);
+    break;
+  case Function::Min:
+    value.intValue = state.intMin;
+    value.doubleValue = state.doubleMin;
+    break;
+  default:
+    value.intValue = state.intMax;
+    value.doubleValue = state.doubleMax;
+    break;
+  }
+  return value;
+}
+
+void Aggregator::print(std::ostream &os, const Value &value) {
+  if (value.isNull) {
+    os << "NULL";
+  } else if (value.isInteger) {
+    os << value.intValue;
+  } else {
+    os << value.doubleValue;
+  }
+}
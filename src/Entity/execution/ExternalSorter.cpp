@@ -0,0 +1,359 @@
+#include "Entity/execution/ExternalSorter.h"
+#include "Entity/storage/HeapFile.h"
+#include "Entity/storage/Page.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace {
+std::atomic<size_t> sortMemoryBudget{64u << 20}; // 默认 64 MiB
+
+constexpr size_t MAX_FAN_IN = 64;        // 一次归并最多同时读的段数
+constexpr size_t RUN_BUFFER = 64u << 10; // 每个段的读缓冲
+
+template <typename T> T loadField(const char *field, int width) {
+  T value = 0;
+  std::memcpy(&value, field, std::min<size_t>(sizeof(value), width));
+  return value;
+}
+} // namespace
+
+// 顺序读一个有序段，每次读入一整块
+class ExternalSorter::RunReader {
+public:
+  RunReader(const fs::path &path, int recordWidth)
+      : in(path, std::ios::binary), width(recordWidth),
+        buffer((RUN_BUFFER / recordWidth + 1) * recordWidth) {}
+
+  bool good() const { return static_cast<bool>(in) || in.eof(); }
+
+  // 返回下一条记录，段读完时返回 nullptr
+  const char *next() {
+    if (pos == end) {
+      in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      end = static_cast<size_t>(in.gcount()) / width * width;
+      pos = 0;
+      if (end == 0) {
+        return nullptr;
+      }
+    }
+    const char *record = buffer.data() + pos;
+    pos += width;
+    return record;
+  }
+
+private:
+  std::ifstream in;
+  int width;
+  std::vector<char> buffer;
+  size_t pos = 0;
+  size_t end = 0;
+};
+
+ExternalSorter::ExternalSorter(std::shared_ptr<const RowLayout> layout,
+                               std::vector<Key> keys,
+                               const std::vector<int> &carried,
+                               fs::path tempPrefix, size_t limit)
+    : layout(std::move(layout)), prefix(std::move(tempPrefix)), limit(limit) {
+  // 每一列在记录中只放一次，排序列在前
+  auto slotOf = [&](int col) {
+    for (const Field &field : fields) {
+      if (field.offset == this->layout->field(col).offset) {
+        return field;
+      }
+    }
+    const RowLayout::Field &source = this->layout->field(col);
+    fields.push_back(Field{source.offset, source.width, recordWidth,
+                           source.type});
+    recordWidth += source.width;
+    return fields.back();
+  };
+  for (const Key &key : keys) {
+    if (key.column != -1) {
+      sortKeys.push_back(SortKey{slotOf(key.column), key.ascending});
+    }
+  }
+  for (int col : carried) {
+    if (col != -1) {
+      slotOf(col);
+    }
+  }
+  recordWidth = std::max(recordWidth, 1);
+
+  // 堆中每条记录另有一个下标和一个序号
+  size_t perRecord = recordWidth + sizeof(uint32_t) + sizeof(uint64_t);
+  bounded = limit <= memoryBudget() / perRecord;
+  candidate.resize(recordWidth);
+}
+
+ExternalSorter::~ExternalSorter() {
+  for (const fs::path &run : runs) {
+    std::error_code ec;
+    fs::remove(run, ec);
+  }
+}
+
+void ExternalSorter::setMemoryBudget(size_t bytes) {
+  sortMemoryBudget = std::max<size_t>(bytes, PAGE_SIZE);
+}
+
+size_t ExternalSorter::memoryBudget() { return sortMemoryBudget; }
+
+int ExternalSorter::compare(const char *a, const char *b) const {
+  for (const SortKey &key : sortKeys) {
+    const char *x = a + key.field.slot;
+    const char *y = b + key.field.slot;
+    int width = key.field.width;
+    int c = 0;
+    switch (key.field.type) {
+    case RowLayout::ColumnType::Integer: {
+      int32_t u = loadField<int32_t>(x, width);
+      int32_t v = loadField<int32_t>(y, width);
+      c = u < v ? -1 : (v < u ? 1 : 0);
+      break;
+    }
+    case RowLayout::ColumnType::Number: {
+      float u = loadField<float>(x, width);
+      float v = loadField<float>(y, width);
+      if (std::isnan(u) || std::isnan(v)) {
+        c = static_cast<int>(std::isnan(u)) - static_cast<int>(std::isnan(v));
+      } else {
+        c = u < v ? -1 : (v < u ? 1 : 0);
+      }
+      break;
+    }
+    case RowLayout::ColumnType::Bool:
+      c = (x[0] != 0) - (y[0] != 0);
+      break;
+    default:
+      c = std::string_view(x, strnlen(x, width))
+              .compare(std::string_view(y, strnlen(y, width)));
+      break;
+    }
+    if (c != 0) {
+      return key.ascending ? c : -c;
+    }
+  }
+  return 0;
+}
+
+bool ExternalSorter::ordered(uint32_t a, uint32_t b) const {
+  int c = compare(records.data() + static_cast<size_t>(a) * recordWidth,
+                  records.data() + static_cast<size_t>(b) * recordWidth);
+  return c < 0 || (c == 0 && sequence[a] < sequence[b]);
+}
+
+void ExternalSorter::pack(const char *row, char *record) const {
+  for (const Field &field : fields) {
+    std::memcpy(record + field.slot, row + field.offset, field.width);
+  }
+}
+
+void ExternalSorter::keepTop(const char *row) {
+  auto before = [this](uint32_t a, uint32_t b) { return ordered(a, b); };
+  uint64_t seq = added++;
+  if (heap.size() < limit) {
+    uint32_t slot = static_cast<uint32_t>(heap.size());
+    records.resize(records.size() + recordWidth);
+    pack(row, records.data() + static_cast<size_t>(slot) * recordWidth);
+    sequence.push_back(seq);
+    heap.push_back(slot);
+    std::push_heap(heap.begin(), heap.end(), before);
+    return;
+  }
+  if (heap.empty()) {
+    return;
+  }
+  // 只有比当前第 limit 行更靠前的行才替换它（键相同时先加入的行靠前）
+  pack(row, candidate.data());
+  uint32_t worst = heap.front();
+  char *record = records.data() + static_cast<size_t>(worst) * recordWidth;
+  if (compare(candidate.data(), record) >= 0) {
+    return;
+  }
+  std::pop_heap(heap.begin(), heap.end(), before);
+  std::memcpy(record, candidate.data(), recordWidth);
+  sequence[worst] = seq;
+  std::push_heap(heap.begin(), heap.end(), before);
+}
+
+bool ExternalSorter::add(const char *row) {
+  if (bounded) {
+    keepTop(row);
+    return true;
+  }
+  size_t at = records.size();
+  records.resize(at + recordWidth);
+  pack(row, records.data() + at);
+  // 记录本身加上排序时每条记录一个下标
+  size_t count = records.size() / recordWidth;
+  if (records.size() + count * sizeof(uint32_t) >= memoryBudget()) {
+    return spillRun();
+  }
+  return true;
+}
+
+void ExternalSorter::sortBuffered() {
+  size_t count = records.size() / recordWidth;
+  order.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    order[i] = static_cast<uint32_t>(i);
+  }
+  if (bounded) {
+    // Top-N 的记录不按加入顺序存放，键相同时按序号排
+    std::sort(order.begin(), order.end(),
+              [this](uint32_t a, uint32_t b) { return ordered(a, b); });
+  } else {
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return compare(records.data() + static_cast<size_t>(a) * recordWidth,
+                     records.data() + static_cast<size_t>(b) * recordWidth) <
+             0;
+    });
+  }
+  position = 0;
+}
+
+fs::path ExternalSorter::nextRunPath() {
+  return HeapFile::temporaryPath(prefix, "S");
+}
+
+bool ExternalSorter::spillRun() {
+  if (records.empty()) {
+    return true;
+  }
+  fs::path path = nextRunPath();
+  runs.push_back(path);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  sortBuffered();
+  for (uint32_t i : order) {
+    out.write(records.data() + static_cast<size_t>(i) * recordWidth,
+              recordWidth);
+  }
+  out.close();
+  std::vector<char>().swap(records);
+  std::vector<uint32_t>().swap(order);
+  if (!out) {
+    std::cerr << "Failed to write sort run " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool ExternalSorter::mergeLater(size_t a, size_t b) const {
+  // 键相同时先输出靠前的段，保持稳定
+  int c = compare(heads[a], heads[b]);
+  return c > 0 || (c == 0 && a > b);
+}
+
+bool ExternalSorter::openMerge(const std::vector<fs::path> &inputs) {
+  readers.clear();
+  pendingRun = NO_RUN;
+  heads.clear();
+  mergeHeap.clear();
+  for (const fs::path &input : inputs) {
+    readers.push_back(std::make_unique<RunReader>(input, recordWidth));
+    if (!readers.back()->good()) {
+      std::cerr << "Failed to read sort run " << input << std::endl;
+      return false;
+    }
+    heads.push_back(readers.back()->next());
+  }
+  auto later = [this](size_t a, size_t b) { return mergeLater(a, b); };
+  for (size_t i = 0; i < heads.size(); ++i) {
+    if (heads[i] != nullptr) {
+      mergeHeap.push_back(i);
+      std::push_heap(mergeHeap.begin(), mergeHeap.end(), later);
+    }
+  }
+  return true;
+}
+
+const char *ExternalSorter::nextMerged() {
+  auto later = [this](size_t a, size_t b) { return mergeLater(a, b); };
+  // 上一次返回的记录用完之后才读它所在段的下一条，读缓冲不会提前被覆盖
+  if (pendingRun != NO_RUN) {
+    heads[pendingRun] = readers[pendingRun]->next();
+    if (heads[pendingRun] != nullptr) {
+      mergeHeap.push_back(pendingRun);
+      std::push_heap(mergeHeap.begin(), mergeHeap.end(), later);
+    }
+    pendingRun = NO_RUN;
+  }
+  if (mergeHeap.empty()) {
+    return nullptr;
+  }
+  std::pop_heap(mergeHeap.begin(), mergeHeap.end(), later);
+  pendingRun = mergeHeap.back();
+  mergeHeap.pop_back();
+  return heads[pendingRun];
+}
+
+bool ExternalSorter::sort() {
+  if (runs.empty()) {
+    sortBuffered();
+    return true;
+  }
+  if (!spillRun()) {
+    error = true;
+    return false;
+  }
+
+  // 段太多时先把相邻的段分批归并成一个，新段放在原来的位置上，保持稳定
+  while (runs.size() > MAX_FAN_IN) {
+    std::vector<fs::path> group(runs.begin(), runs.begin() + MAX_FAN_IN);
+    fs::path path = nextRunPath();
+    runs.insert(runs.begin() + MAX_FAN_IN, path);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    bool ok = openMerge(group);
+    for (const char *record = nullptr; ok && (record = nextMerged());) {
+      out.write(record, recordWidth);
+    }
+    readers.clear();
+    out.close();
+    if (!ok || !out) {
+      std::cerr << "Failed to write sort run " << path << std::endl;
+      error = true;
+      return false;
+    }
+    for (const fs::path &merged : group) {
+      std::error_code ec;
+      fs::remove(merged, ec);
+    }
+    runs.erase(runs.begin(), runs.begin() + MAX_FAN_IN);
+  }
+  if (!openMerge(runs)) {
+    error = true;
+    return false;
+  }
+  return true;
+}
+
+size_t ExternalSorter::read(char *rows, size_t maxRows) {
+  // 把记录中的列放回原来的位置，调用方按行格式读取
+  int rowWidth = layout->rowWidth();
+  size_t count = 0;
+  for (; count < maxRows && emitted < limit; ++count, ++emitted) {
+    const char *record = nullptr;
+    if (runs.empty()) {
+      if (position == order.size()) {
+        break;
+      }
+      record = records.data() + static_cast<size_t>(order[position++]) *
+                                    recordWidth;
+    } else if ((record = nextMerged()) == nullptr) {
+      break;
+    }
+    char *row = rows + count * rowWidth;
+    std::memset(row, 0, rowWidth);
+    for (const Field &field : fields) {
+      std::memcpy(row + field.offset, record + field.slot, field.width);
+    }
+  }
+  return count;
+}
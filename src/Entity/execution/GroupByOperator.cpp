@@ -0,0 +1,157 @@
+#include "Entity/execution/GroupByOperator.h"
+#include "Entity/execution/HashPartitioner.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+std::atomic<size_t> groupMemoryBudget{64u << 20}; // 默认 64 MiB
+
+constexpr size_t PARTITIONS = 16;
+} // namespace
+
+GroupByOperator::GroupByOperator(std::shared_ptr<const RowLayout> layout,
+                                 const HeapFile &heap,
+                                 std::vector<int> groupColumns,
+                                 const Aggregator &aggregator,
+                                 const Predicate &where)
+    : layout(std::move(layout)), heap(heap), columns(std::move(groupColumns)),
+      aggregator(aggregator), where(where) {
+  for (int col : columns) {
+    keyWidth += this->layout->field(col).width;
+  }
+}
+
+void GroupByOperator::setMemoryBudget(size_t bytes) {
+  groupMemoryBudget = std::max<size_t>(bytes, PAGE_SIZE);
+}
+
+size_t GroupByOperator::memoryBudget() { return groupMemoryBudget; }
+
+bool GroupByOperator::run(const Emit &emit) {
+  return aggregate(heap, where, 0, emit);
+}
+
+void GroupByOperator::makeKey(const char *row, std::string &key) const {
+  key.resize(keyWidth);
+  char *out = key.data();
+  for (int col : columns) {
+    const RowLayout::Field &field = layout->field(col);
+    std::memcpy(out, row + field.offset, field.width);
+    if (field.type == RowLayout::ColumnType::Number &&
+        field.width >= static_cast<int>(sizeof(float))) {
+      float value = 0;
+      std::memcpy(&value, out, sizeof(value));
+      if (std::isnan(value)) {
+        value = std::numeric_limits<float>::quiet_NaN();
+      } else if (value == 0) {
+        value = 0; // -0 与 +0 同组
+      }
+      std::memcpy(out, &value, sizeof(value));
+    }
+    out += field.width;
+  }
+}
+
+bool GroupByOperator::aggregate(const HeapFile &input, const Predicate &filter,
+                                int depth, const Emit &emit) {
+  size_t stateCount = aggregator.size();
+  size_t groupBytes = keyWidth + HashPartitioner::ENTRY_OVERHEAD +
+                      stateCount * sizeof(Aggregator::State);
+  size_t maxGroups = std::max<size_t>(memoryBudget() / groupBytes, 1);
+
+  std::unordered_map<std::string, size_t> groups;
+  std::vector<const std::string *> order; // 分组首次出现的顺序
+  std::vector<Aggregator::State> states;
+
+  std::vector<std::unique_ptr<HeapFile>> parts;
+  auto discardAll = [&]() {
+    for (auto &part : parts) {
+      HeapFile::discard(part->path());
+    }
+  };
+  // 第一次需要溢出时才创建分区文件
+  auto openParts = [&]() {
+    for (size_t k = 0; k < PARTITIONS; ++k) {
+      parts.push_back(std::make_unique<HeapFile>(
+          HeapFile::temporaryPath(heap.path(), "G"), input.rowWidth()));
+      if (!parts.back()->create()) {
+        std::cerr << "Failed to create group-by partition files."
+                  << std::endl;
+        return false;
+      }
+    }
+    return true;
+  };
+
+  std::string key;
+  std::vector<uint16_t> selection(HeapFile::BATCH_ROWS);
+  bool ok = true;
+  bool scanned = input.forEachBatch([&](const HeapFile::Batch &batch) {
+    uint32_t selected = filter.select(batch, selection.data());
+    for (uint32_t i = 0; i < selected; ++i) {
+      const char *row = batch.rows[selection[i]];
+      makeKey(row, key);
+      auto it = groups.find(key);
+      if (it == groups.end()) {
+        if (groups.size() >= maxGroups && depth < HashPartitioner::MAX_DEPTH) {
+          // 表已满：新分组的行留到分区里再聚合
+          if (parts.empty() && !openParts()) {
+            ok = false;
+            return false;
+          }
+          size_t k = HashPartitioner::partitionOf(key, depth, PARTITIONS);
+          if (!parts[k]->appendRow(row)) {
+            ok = false;
+            return false;
+          }
+          continue;
+        }
+        it = groups.emplace(key, order.size()).first;
+        order.push_back(&it->first);
+        states.resize(states.size() + stateCount);
+      }
+      aggregator.accumulate(row, states.data() + it->second * stateCount);
+    }
+    return true;
+  });
+  if (!scanned || !ok) {
+    discardAll();
+    return false;
+  }
+
+  std::vector<char> groupRow(layout->rowWidth());
+  std::vector<Aggregator::Value> values(stateCount);
+  for (size_t g = 0; g < order.size(); ++g) {
+    // 把键拆回分组列所在的位置，方便按行格式输出
+    const char *field = order[g]->data();
+    for (int col : columns) {
+      std::memcpy(groupRow.data() + layout->field(col).offset, field,
+                  layout->field(col).width);
+      field += layout->field(col).width;
+    }
+    for (size_t t = 0; t < stateCount; ++t) {
+      values[t] = aggregator.result(t, states[g * stateCount + t]);
+    }
+    emit(groupRow.data(), values);
+  }
+  groups.clear();
+  order.clear();
+  std::vector<Aggregator::State>().swap(states);
+
+  // 分区中的行已经筛选过，递归聚合时不再判断条件
+  Predicate all;
+  for (size_t k = 0; ok && k < parts.size(); ++k) {
+    if (parts[k]->pageCount() > 0) {
+      ok = aggregate(*parts[k], all, depth + 1, emit);
+    }
+  }
+  discardAll();
+  return ok;
+}
@@ -0,0 +1,12 @@
+#include "Entity/execution/HashPartitioner.h"
+#include <functional>
+
+size_t HashPartitioner::partitionOf(const std::string &key, int depth,
+                                    size_t partitions) {
+  size_t hash = std::hash<std::string>()(key);
+  hash ^= static_cast<size_t>(depth + 1) * 0x9e3779b97f4a7c15ull;
+  hash ^= hash >> 29;
+  hash *= 0xbf58476d1ce4e5b9ull;
+  hash ^= hash >> 32;
+  return hash % partitions;
+}
@@ -0,0 +1,282 @@
+#include "Entity/execution/JoinOperator.h"
+#include "Entity/execution/HashPartitioner.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+std::atomic<size_t> joinMemoryBudget{64u << 20}; // 默认 64 MiB
+
+constexpr size_t MAX_PARTITIONS = 64;
+} // namespace
+
+JoinOperator::JoinOperator(Input left, Input right)
+    : left(std::move(left)), right(std::move(right)),
+      joinType(this->left.layout->type(this->left.column)) {}
+
+void JoinOperator::setMemoryBudget(size_t bytes) {
+  joinMemoryBudget = std::max<size_t>(bytes, PAGE_SIZE);
+}
+
+size_t JoinOperator::memoryBudget() { return joinMemoryBudget; }
+
+size_t JoinOperator::estimateBytes(const HeapFile &heap) {
+  return static_cast<size_t>(heap.pageCount()) * heap.rowsPerPage() *
+         (heap.rowWidth() + HashPartitioner::ENTRY_OVERHEAD);
+}
+
+JoinOperator::Strategy JoinOperator::chooseStrategy() const {
+  // 较小的一边放得进内存预算时哈希连接只需各扫一遍表，总是最省；
+  // 两边都放不下时哈希连接要把两边都分区落盘，这时如果两边都能按连接键有序读出
+  // （键的比较方式一致）就改用归并，它只占常数内存。number 列不归并：
+  // NaN 与任何键比较都相等，索引里它前后的键不一定有序
+  size_t smaller =
+      std::min(estimateBytes(*left.heap), estimateBytes(*right.heap));
+  if (smaller <= memoryBudget()) {
+    return Strategy::Hash;
+  }
+  if (left.index != nullptr && right.index != nullptr &&
+      right.layout->type(right.column) == joinType &&
+      (joinType == RowLayout::ColumnType::Integer ||
+       joinType == RowLayout::ColumnType::Str)) {
+    return Strategy::SortMerge;
+  }
+  return Strategy::GraceHash;
+}
+
+bool JoinOperator::extractKey(const Side &side, const char *row,
+                              std::string &key) const {
+  // 按左表连接列的类型取键，数值键统一成定长字节，可以直接哈希和比较
+  switch (joinType) {
+  case RowLayout::ColumnType::Integer: {
+    int32_t value = side.layout->getInt(row, side.column);
+    key.assign(reinterpret_cast<const char *>(&value), sizeof(value));
+    return true;
+  }
+  case RowLayout::ColumnType::Number: {
+    float value = side.layout->getNumber(row, side.column);
+    if (std::isnan(value)) {
+      return false; // NaN 不等于任何值
+    }
+    if (value == 0) {
+      value = 0; // -0 与 +0 相等
+    }
+    key.assign(reinterpret_cast<const char *>(&value), sizeof(value));
+    return true;
+  }
+  default: {
+    std::string_view value = side.layout->getStr(row, side.column);
+    key.assign(value.data(), value.size());
+    return true;
+  }
+  }
+}
+
+bool JoinOperator::run(const Emit &emit) {
+  Strategy strategy = chooseStrategy();
+  if (strategy == Strategy::SortMerge) {
+    return mergeJoin(emit);
+  }
+
+  // 在较小的一边上建表；大小相同时在右表上建表，左表探测，输出顺序与嵌套循环一致
+  Side leftSide{left.layout.get(), left.heap, left.column, true};
+  Side rightSide{right.layout.get(), right.heap, right.column, false};
+  bool buildLeft = estimateBytes(*left.heap) < estimateBytes(*right.heap);
+  const Side &build = buildLeft ? leftSide : rightSide;
+  const Side &probe = buildLeft ? rightSide : leftSide;
+  if (strategy == Strategy::GraceHash) {
+    return partitionedJoin(build, probe, 0, emit);
+  }
+  return hashJoin(build, probe, 0, emit);
+}
+
+bool JoinOperator::hashJoin(const Side &build, const Side &probe, int depth,
+                            const Emit &emit) {
+  if (depth < HashPartitioner::MAX_DEPTH &&
+      estimateBytes(*build.heap) > memoryBudget()) {
+    return partitionedJoin(build, probe, depth, emit);
+  }
+
+  // 建表：行拷贝进连续缓冲区，相同键的行用 next 串成链（保持原始顺序）
+  int buildWidth = build.layout->rowWidth();
+  std::vector<char> rows;
+  std::vector<uint32_t> next;
+  std::unordered_map<std::string, std::pair<uint32_t, uint32_t>> table;
+  std::string key;
+  bool ok = build.heap->forEachRow([&](const char *row, RowId) {
+    if (!extractKey(build, row, key)) {
+      return true;
+    }
+    uint32_t index = static_cast<uint32_t>(next.size());
+    rows.insert(rows.end(), row, row + buildWidth);
+    next.push_back(UINT32_MAX);
+    auto [it, inserted] = table.try_emplace(key, index, index);
+    if (!inserted) {
+      next[it->second.second] = index;
+      it->second.second = index;
+    }
+    return true;
+  });
+  if (!ok) {
+    return false;
+  }
+
+  return probe.heap->forEachRow([&](const char *row, RowId) {
+    if (!extractKey(probe, row, key)) {
+      return true;
+    }
+    auto it = table.find(key);
+    if (it == table.end()) {
+      return true;
+    }
+    for (uint32_t i = it->second.first; i != UINT32_MAX; i = next[i]) {
+      const char *match = rows.data() + static_cast<size_t>(i) * buildWidth;
+      if (build.isLeft) {
+        emit(match, row);
+      } else {
+        emit(row, match);
+      }
+    }
+    return true;
+  });
+}
+
+bool JoinOperator::partitionedJoin(const Side &build, const Side &probe,
+                                   int depth, const Emit &emit) {
+  size_t partitions = std::clamp<size_t>(
+      estimateBytes(*build.heap) * 2 / memoryBudget() + 1, 2, MAX_PARTITIONS);
+
+  // 两边按同一个哈希函数分区，相同的键一定落进编号相同的分区
+  auto partitionPath = [](const Side &side) {
+    return HeapFile::temporaryPath(side.heap->path(), side.isLeft ? "L" : "R");
+  };
+  std::vector<std::unique_ptr<HeapFile>> buildParts;
+  std::vector<std::unique_ptr<HeapFile>> probeParts;
+  auto discardAll = [&]() {
+    for (auto &part : buildParts) {
+      HeapFile::discard(part->path());
+    }
+    for (auto &part : probeParts) {
+      HeapFile::discard(part->path());
+    }
+  };
+  for (size_t k = 0; k < partitions; ++k) {
+    buildParts.push_back(std::make_unique<HeapFile>(
+        partitionPath(build), build.layout->rowWidth()));
+    probeParts.push_back(std::make_unique<HeapFile>(
+        partitionPath(probe), probe.layout->rowWidth()));
+    if (!buildParts.back()->create() || !probeParts.back()->create()) {
+      std::cerr << "Failed to create join partition files." << std::endl;
+      discardAll();
+      return false;
+    }
+  }
+
+  std::string key;
+  auto scatter = [&](const Side &side,
+                     std::vector<std::unique_ptr<HeapFile>> &parts) {
+    return side.heap->forEachRow([&](const char *row, RowId) {
+      if (!extractKey(side, row, key)) {
+        return true;
+      }
+      size_t k = HashPartitioner::partitionOf(key, depth, partitions);
+      return parts[k]->appendRow(row);
+    });
+  };
+  bool ok = scatter(build, buildParts) && scatter(probe, probeParts);
+
+  for (size_t k = 0; ok && k < partitions; ++k) {
+    if (buildParts[k]->pageCount() == 0 || probeParts[k]->pageCount() == 0) {
+      continue;
+    }
+    Side buildPart{build.layout, buildParts[k].get(), build.column,
+                   build.isLeft};
+    Side probePart{probe.layout, probeParts[k].get(), probe.column,
+                   probe.isLeft};
+    ok = hashJoin(buildPart, probePart, depth + 1, emit);
+  }
+  discardAll();
+  return ok;
+}
+
+int JoinOperator::compareKeys(const char *a, int widthA, const char *b,
+                              int widthB) const {
+  switch (joinType) {
+  case RowLayout::ColumnType::Integer: {
+    int32_t x = 0;
+    int32_t y = 0;
+    std::memcpy(&x, a, std::min<int>(sizeof(x), widthA));
+    std::memcpy(&y, b, std::min<int>(sizeof(y), widthB));
+    return x < y ? -1 : (y < x ? 1 : 0);
+  }
+  case RowLayout::ColumnType::Number: {
+    float x = 0;
+    float y = 0;
+    std::memcpy(&x, a, std::min<int>(sizeof(x), widthA));
+    std::memcpy(&y, b, std::min<int>(sizeof(y), widthB));
+    return x < y ? -1 : (y < x ? 1 : 0);
+  }
+  default:
+    return std::string_view(a, strnlen(a, widthA))
+        .compare(std::string_view(b, strnlen(b, widthB)));
+  }
+}
+
+bool JoinOperator::mergeJoin(const Emit &emit) {
+  // 两棵索引的叶子都按连接键有序：各用一个游标顺链拉取并归并，条目不读进内存。
+  // 键相同的一段，左边的每个条目都让右边的游标回到这一段的开头重新走一遍
+  BPlusTree::Scanner leftScan = left.index->tree().scanner();
+  BPlusTree::Scanner rightScan = right.index->tree().scanner();
+  int leftKey = left.index->tree().keyWidth();
+  int rightKey = right.index->tree().keyWidth();
+  auto ridOf = [](const char *entry, int keyWidth) {
+    RowId rid;
+    std::memcpy(&rid, entry + keyWidth, sizeof(rid));
+    return rid;
+  };
+
+  std::vector<char> key(leftKey);
+  const char *l = leftScan.next();
+  const char *r = rightScan.next();
+  while (l != nullptr && r != nullptr) {
+    int cmp = compareKeys(l, leftKey, r, rightKey);
+    if (cmp < 0) {
+      l = leftScan.next();
+      continue;
+    }
+    if (cmp > 0) {
+      r = rightScan.next();
+      continue;
+    }
+
+    // 输出两边键相同的一段的笛卡尔积
+    BPlusTree::Scanner::Position runStart = rightScan.position();
+    std::memcpy(key.data(), l, leftKey);
+    for (; l != nullptr && compareKeys(l, leftKey, key.data(), leftKey) == 0;
+         l = leftScan.next()) {
+      rightScan.rewind(runStart);
+      const char *match = rightScan.next();
+      bool ok = left.heap->withRow(ridOf(l, leftKey), [&](const char *leftRow) {
+        for (; match != nullptr &&
+               compareKeys(key.data(), leftKey, match, rightKey) == 0;
+             match = rightScan.next()) {
+          right.heap->withRow(ridOf(match, rightKey),
+                              [&](const char *rightRow) {
+                                emit(leftRow, rightRow);
+                              });
+        }
+      });
+      if (!ok) {
+        return false;
+      }
+      r = match;
+    }
+  }
+  return !leftScan.failed() && !rightScan.failed();
+}
@@ -0,0 +1,74 @@
+#include "Entity/execution/ParallelScan.h"
+#include "Entity/execution/WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+namespace {
+// 每个工作者的 morsel 队列：自己从队首取，别人从队尾偷
+struct MorselQueue {
+  std::mutex mutex;
+  std::deque<size_t> morsels;
+
+  bool takeFront(size_t &morsel) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (morsels.empty()) {
+      return false;
+    }
+    morsel = morsels.front();
+    morsels.pop_front();
+    return true;
+  }
+
+  bool takeBack(size_t &morsel) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (morsels.empty()) {
+      return false;
+    }
+    morsel = morsels.back();
+    morsels.pop_back();
+    return true;
+  }
+};
+} // namespace
+
+ParallelScan::ParallelScan(const HeapFile &heap, size_t parallelism)
+    : morselCount((heap.pageCount() + MORSEL_PAGES - 1) / MORSEL_PAGES),
+      workerCount(std::max<size_t>(
+          1, std::min(std::max<size_t>(parallelism, 1), morselCount))) {}
+
+bool ParallelScan::run(const MorselTask &task) {
+  if (workerCount == 1) {
+    for (size_t morsel = 0; morsel < morselCount; ++morsel) {
+      if (!task(0, morsel)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // 先按顺序连续地分配，每个工作者拿到相邻的一段 morsel
+  std::vector<MorselQueue> queues(workerCount);
+  for (size_t morsel = 0; morsel < morselCount; ++morsel) {
+    queues[morsel * workerCount / morselCount].morsels.push_back(morsel);
+  }
+
+  std::atomic<bool> stopped{false};
+  WorkerPool::instance().run(workerCount, [&](size_t worker) {
+    while (!stopped.load(std::memory_order_relaxed)) {
+      size_t morsel = 0;
+      bool found = queues[worker].takeFront(morsel);
+      for (size_t i = 1; !found && i < workerCount; ++i) {
+        found = queues[(worker + i) % workerCount].takeBack(morsel);
+      }
+      if (!found) {
+        return;
+      }
+      if (!task(worker, morsel)) {
+        stopped = true;
+      }
+    }
+  });
+  return !stopped;
+}
@@ -0,0 +1,340 @@
+#include "Entity/execution/Predicate.h"
+#include "Entity/execution/SelectionKernels.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string_view>
+
+namespace {
+using Term = Predicate::Term;
+using Eval = bool (*)(const Term &, const char *);
+
+// 每种列类型怎样从行中读出字段、怎样取出预先解析好的常量
+struct IntValue {
+  static int64_t load(const Term &term, const char *row) {
+    int32_t value = 0;
+    std::memcpy(&value, row + term.offset,
+                std::min<size_t>(sizeof(value), term.width));
+    return value;
+  }
+  static int64_t constant(const Term &term) { return term.intValue; }
+};
+
+// integer 列与带小数的常量比较
+struct IntAsDouble {
+  static double load(const Term &term, const char *row) {
+    return static_cast<double>(IntValue::load(term, row));
+  }
+  static double constant(const Term &term) { return term.doubleValue; }
+};
+
+// number 列按 float 存储，常量也解析成 float，= 才能和写入时的值一致
+struct FloatValue {
+  static float load(const Term &term, const char *row) {
+    float value = 0;
+    std::memcpy(&value, row + term.offset,
+                std::min<size_t>(sizeof(value), term.width));
+    return value;
+  }
+  static float constant(const Term &term) { return term.floatValue; }
+};
+
+struct BoolValue {
+  static bool load(const Term &term, const char *row) {
+    return row[term.offset] != 0;
+  }
+  static bool constant(const Term &term) { return term.intValue != 0; }
+};
+
+// 页中该列的取值都在 [low, high] 内时，比较是否一定不成立
+template <typename T> bool outside(Predicate::Op op, T low, T high, T value) {
+  switch (op) {
+  case Predicate::Op::Eq:
+    return value < low || high < value;
+  case Predicate::Op::Lt:
+    return !(low < value);
+  case Predicate::Op::Le:
+    return value < low;
+  case Predicate::Op::Gt:
+    return !(value < high);
+  case Predicate::Op::Ge:
+    return high < value;
+  default:
+    return false;
+  }
+}
+
+struct StrValue {
+  static std::string_view load(const Term &term, const char *row) {
+    const char *begin = row + term.offset;
+    return std::string_view(begin, strnlen(begin, term.width));
+  }
+  static std::string_view constant(const Term &term) { return term.strValue; }
+};
+
+template <typename Value, typename Compare>
+bool compareField(const Term &term, const char *row) {
+  return Compare()(Value::load(term, row), Value::constant(term));
+}
+
+template <typename Value> Eval bindCompare(Predicate::Op op) {
+  switch (op) {
+  case Predicate::Op::Eq:
+    return compareField<Value, std::equal_to<>>;
+  case Predicate::Op::Ne:
+    return compareField<Value, std::not_equal_to<>>;
+  case Predicate::Op::Lt:
+    return compareField<Value, std::less<>>;
+  case Predicate::Op::Gt:
+    return compareField<Value, std::greater<>>;
+  case Predicate::Op::Le:
+    return compareField<Value, std::less_equal<>>;
+  default:
+    return compareField<Value, std::greater_equal<>>;
+  }
+}
+
+bool isNull(const Term &term, const char *row) {
+  const char *field = row + term.offset;
+  return std::all_of(field, field + term.width,
+                     [](char c) { return c == '\0'; });
+}
+
+bool isNotNull(const Term &term, const char *row) {
+  return !isNull(term, row);
+}
+
+bool never(const Term &, const char *) { return false; }
+
+// 把一批行中的 4 字节数值字段抽到连续数组里；字段不足 4 字节时高位补 0
+template <typename T>
+void gatherColumn(const HeapFile::Batch &batch, const Term &term, T *out) {
+  static_assert(sizeof(T) == 4, "integer and number fields are 4 bytes");
+  if (term.width >= 4) {
+    for (uint32_t i = 0; i < batch.count; ++i) {
+      std::memcpy(out + i, batch.rows[i] + term.offset, 4);
+    }
+    return;
+  }
+  for (uint32_t i = 0; i < batch.count; ++i) {
+    out[i] = 0;
+    std::memcpy(out + i, batch.rows[i] + term.offset, term.width);
+  }
+}
+
+// 整个字符串都是合法数值时才算解析成功
+bool parseInt(const std::string &text, int64_t &value) {
+  char *end = nullptr;
+  errno = 0;
+  value = std::strtoll(text.c_str(), &end, 10);
+  return end != text.c_str() && *end == '\0' && errno != ERANGE;
+}
+
+bool parseDouble(const std::string &text, double &value) {
+  char *end = nullptr;
+  value = std::strtod(text.c_str(), &end);
+  return end != text.c_str() && *end == '\0';
+}
+} // namespace
+
+bool Predicate::parseOp(const std::string &text, Op &op) {
+  static const std::pair<const char *, Op> ops[] = {
+      {"=", Op::Eq}, {"!=", Op::Ne}, {"<", Op::Lt},
+      {">", Op::Gt}, {"<=", Op::Le}, {">=", Op::Ge}};
+  for (const auto &[name, value] : ops) {
+    if (text == name) {
+      op = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Predicate::compile(const RowLayout &layout,
+                        const std::vector<int> &columns,
+                        const std::vector<std::string> &ops,
+                        const std::vector<std::string> &values) {
+  terms.clear();
+  for (size_t i = 0; i < columns.size() && i < ops.size() && i < values.size();
+       ++i) {
+    int col = columns[i];
+    if (col == -1) {
+      continue;
+    }
+    Term term;
+    term.source = i;
+    term.op = Op::Eq;
+    term.offset = layout.field(col).offset;
+    term.width = layout.field(col).width;
+    const std::string &text = values[i];
+
+    Op op;
+    if (!parseOp(ops[i], op)) {
+      term.eval = never;
+      terms.push_back(std::move(term));
+      continue;
+    }
+    term.op = op;
+    if (text.empty()) {
+      // NULL 只能判断是否相等
+      term.eval = op == Op::Eq ? isNull : op == Op::Ne ? isNotNull : never;
+      terms.push_back(std::move(term));
+      continue;
+    }
+
+    bool valid = true;
+    switch (layout.type(col)) {
+    case RowLayout::ColumnType::Integer:
+      if (parseInt(text, term.intValue)) {
+        term.eval = bindCompare<IntValue>(op);
+        // 超出 int32 范围的常量只能按 int64 逐行比较
+        if (term.intValue >= std::numeric_limits<int32_t>::min() &&
+            term.intValue <= std::numeric_limits<int32_t>::max()) {
+          term.kind = Kind::Int32;
+        }
+      } else if (parseDouble(text, term.doubleValue)) {
+        term.eval = bindCompare<IntAsDouble>(op);
+      } else {
+        valid = false;
+      }
+      break;
+    case RowLayout::ColumnType::Number:
+      valid = parseDouble(text, term.doubleValue);
+      term.floatValue = static_cast<float>(term.doubleValue);
+      term.eval = bindCompare<FloatValue>(op);
+      term.kind = Kind::Float;
+      break;
+    case RowLayout::ColumnType::Bool:
+      valid = text == "true" || text == "false" || text == "1" || text == "0";
+      term.intValue = text == "true" || text == "1";
+      term.eval = bindCompare<BoolValue>(op);
+      break;
+    default:
+      term.strValue = text;
+      term.eval = bindCompare<StrValue>(op);
+      break;
+    }
+    if (!valid) {
+      std::cerr << "Invalid value '" << text << "' for column '"
+                << layout.table().columns[col].name << "' in WHERE clause."
+                << std::endl;
+      return false;
+    }
+    terms.push_back(std::move(term));
+  }
+  return true;
+}
+
+void Predicate::removeCovered(const std::vector<bool> &covered) {
+  terms.erase(std::remove_if(terms.begin(), terms.end(),
+                             [&](const Term &term) {
+                               return term.source < covered.size() &&
+                                      covered[term.source];
+                             }),
+              terms.end());
+}
+
+uint32_t Predicate::select(const HeapFile::Batch &batch,
+                           uint16_t *selection) const {
+  constexpr uint32_t WORD = SelectionKernels::WORD_BITS;
+  uint32_t count = batch.count;
+  uint32_t words = (count + WORD - 1) / WORD;
+  uint64_t mask[HeapFile::BATCH_ROWS / WORD];
+  std::fill(mask, mask + words, ~uint64_t{0});
+  if (count % WORD != 0) {
+    mask[words - 1] = (uint64_t{1} << (count % WORD)) - 1;
+  }
+
+  // 先做能向量化的比较：把列抽到连续数组里（补齐到 64 的倍数）再成批比较
+  int32_t ints[HeapFile::BATCH_ROWS];
+  float floats[HeapFile::BATCH_ROWS];
+  bool rowTerms = false;
+  for (const Term &term : terms) {
+    if (term.kind == Kind::Int32) {
+      gatherColumn(batch, term, ints);
+      std::fill(ints + count, ints + words * WORD, 0);
+      SelectionKernels::compareInt32(ints, count, term.op,
+                                     static_cast<int32_t>(term.intValue), mask);
+    } else if (term.kind == Kind::Float) {
+      gatherColumn(batch, term, floats);
+      std::fill(floats + count, floats + words * WORD, 0.0f);
+      SelectionKernels::compareFloat(floats, count, term.op, term.floatValue,
+                                     mask);
+    } else {
+      rowTerms = true;
+    }
+  }
+
+  uint32_t selected = SelectionKernels::toSelection(mask, count, selection);
+  if (!rowTerms) {
+    return selected;
+  }
+  // 其余的比较只对还留下的行逐行判断
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < selected; ++i) {
+    const char *row = batch.rows[selection[i]];
+    bool match = true;
+    for (const Term &term : terms) {
+      if (term.kind == Kind::Row && !term.eval(term, row)) {
+        match = false;
+        break;
+      }
+    }
+    if (match) {
+      selection[kept++] = selection[i];
+    }
+  }
+  return kept;
+}
+
+std::vector<bool> Predicate::pagesToSkip(const HeapFile &heap,
+                                         uint32_t firstPage,
+                                         uint32_t endPage) const {
+  std::vector<bool> skip;
+  const ZoneMap *zones = heap.zoneMap();
+  if (zones == nullptr || firstPage >= endPage) {
+    return skip;
+  }
+  // 只有按 int32 / float 比较的项能用范围判断；!= 不用（NaN 与任何值都不相等）
+  std::vector<std::pair<const Term *, int>> usable;
+  for (const Term &term : terms) {
+    if ((term.kind == Kind::Int32 || term.kind == Kind::Float) &&
+        term.op != Op::Ne) {
+      int column =
+          zones->find(term.offset, term.width, term.kind == Kind::Float);
+      if (column != -1) {
+        usable.emplace_back(&term, column);
+      }
+    }
+  }
+  if (usable.empty()) {
+    return skip;
+  }
+
+  skip.assign(endPage - firstPage, false);
+  zones->forEachEntry(
+      firstPage, endPage,
+      [&](uint32_t pageNo, const ZoneMap::Entry &entry) {
+        if (!entry.known()) {
+          return;
+        }
+        for (const auto &[term, column] : usable) {
+          bool disjoint =
+              term->kind == Kind::Float
+                  ? outside(term->op, entry.low<float>(column),
+                            entry.high<float>(column), term->floatValue)
+                  : outside(term->op, entry.low<int32_t>(column),
+                            entry.high<int32_t>(column),
+                            static_cast<int32_t>(term->intValue));
+          if (disjoint) {
+            skip[pageNo - firstPage] = true;
+            return;
+          }
+        }
+      });
+  return skip;
+}
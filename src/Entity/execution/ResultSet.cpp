@@ -0,0 +1,66 @@
+#include "Entity/execution/ResultSet.h"
+#include <cstring>
+#include <sstream>
+
+ResultSet::ResultSet(std::vector<std::shared_ptr<const RowLayout>> inputs,
+                     std::vector<Column> columns,
+                     std::unique_ptr<Source> source, size_t limit,
+                     size_t offset)
+    : inputs(std::move(inputs)), outputs(std::move(columns)),
+      source(std::move(source)), remaining(limit), skip(offset) {}
+
+bool ResultSet::next(Batch &batch) {
+  batch.count = 0;
+  // 够 limit 行之后不再向算子要行，后面的页不会被读
+  while (!error && remaining > 0) {
+    if (!source->next(batch)) {
+      error = true;
+      break;
+    }
+    if (batch.count == 0) {
+      break;
+    }
+    if (skip >= batch.count) {
+      skip -= batch.count;
+      batch.count = 0;
+      continue;
+    }
+    if (skip > 0) {
+      std::memmove(batch.rows, batch.rows + skip,
+                   (batch.count - skip) * sizeof(batch.rows[0]));
+      batch.count -= static_cast<uint32_t>(skip);
+      skip = 0;
+    }
+    if (batch.count > remaining) {
+      batch.count = static_cast<uint32_t>(remaining);
+    }
+    remaining -= batch.count;
+    return true;
+  }
+  batch.count = 0;
+  return false;
+}
+
+bool ResultSet::print(std::ostream &out) {
+  out << "\n";
+  for (const Column &column : outputs) {
+    out << column.name << "\t";
+  }
+  out << "\n";
+
+  auto batch = std::make_unique<Batch>();
+  std::ostringstream text;
+  while (next(*batch)) {
+    text.str("");
+    for (uint32_t i = 0; i < batch->count; ++i) {
+      for (int col = 0; col < columnCount(); ++col) {
+        print(text, *batch, i, col);
+        text << "\t";
+      }
+      text << "\n";
+    }
+    out << text.str();
+  }
+  out.flush();
+  return !error;
+}
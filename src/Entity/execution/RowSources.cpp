@@ -0,0 +1,149 @@
+#include "Entity/execution/RowSources.h"
+#include "Entity/execution/ParallelScan.h"
+#include "Entity/execution/WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+RowIdSource::RowIdSource(HeapFile heap, std::vector<RowId> rids,
+                         Predicate where)
+    : heap(std::move(heap)), where(std::move(where)), rids(std::move(rids)) {}
+
+bool RowIdSource::next(ResultSet::Batch &batch) {
+  pinned.clear();
+  batch.count = 0;
+  uint32_t pinnedPage = 0;
+  bool pageUsed = false;
+  while (batch.count < ResultSet::BATCH_ROWS) {
+    if (position == rids.size()) {
+      if (!refill()) {
+        return false;
+      }
+      if (position == rids.size()) {
+        break;
+      }
+    }
+    RowId rid = rids[position];
+    if (pinned.empty() || rid.pageNo != pinnedPage) {
+      // 没有返回任何行的页不必继续 pin 住
+      if (!pinned.empty() && !pageUsed) {
+        pinned.pop_back();
+      }
+      if (pinned.size() == HeapFile::BATCH_PAGES) {
+        break;
+      }
+      HeapFile::PageView page = heap.readPage(rid.pageNo);
+      if (!page) {
+        return false;
+      }
+      pinned.push_back(std::move(page));
+      pinnedPage = rid.pageNo;
+      pageUsed = false;
+    }
+    ++position;
+
+    const HeapFile::PageView &page = pinned.back();
+    if (page.header()->magic != PAGE_MAGIC ||
+        rid.slot >= page.header()->rowCount ||
+        isDeleted(page.data(), heap.rowsPerPage(), rid.slot)) {
+      continue;
+    }
+    const char *row =
+        page.rows() + static_cast<size_t>(rid.slot) * heap.rowWidth();
+    if (!where.matches(row)) {
+      continue;
+    }
+    batch.rows[batch.count][0] = row;
+    ++batch.count;
+    pageUsed = true;
+  }
+  return true;
+}
+
+ScanSource::ScanSource(HeapFile heap, Predicate where, size_t parallelism)
+    : RowIdSource(std::move(heap), {}, std::move(where)),
+      parallelism(std::max<size_t>(parallelism, 1)) {}
+
+bool ScanSource::refill() {
+  rids.clear();
+  position = 0;
+  uint32_t pages = heap.pageCount();
+  while (rids.empty() && nextPage < pages) {
+    size_t left = (pages - nextPage + ParallelScan::MORSEL_PAGES - 1) /
+                  ParallelScan::MORSEL_PAGES;
+    size_t morsels = std::min(parallelism, left);
+
+    // 各 morsel 的结果按 morsel 顺序拼接，与串行扫描的顺序一致
+    std::vector<std::vector<RowId>> parts(morsels);
+    std::atomic<bool> ok{true};
+    auto scanMorsel = [&](size_t m) {
+      uint32_t first =
+          nextPage + static_cast<uint32_t>(m) * ParallelScan::MORSEL_PAGES;
+      bool scanned = where.forEachMatch(
+          heap, first, first + ParallelScan::MORSEL_PAGES,
+          [&](const char *, RowId rid) {
+            parts[m].push_back(rid);
+            return true;
+          });
+      if (!scanned) {
+        ok = false;
+      }
+    };
+    if (morsels == 1) {
+      scanMorsel(0);
+    } else {
+      WorkerPool::instance().run(morsels, scanMorsel);
+    }
+    if (!ok) {
+      return false;
+    }
+    for (const auto &part : parts) {
+      rids.insert(rids.end(), part.begin(), part.end());
+    }
+    nextPage += static_cast<uint32_t>(morsels) * ParallelScan::MORSEL_PAGES;
+  }
+  return true;
+}
+
+SortSource::SortSource(std::unique_ptr<ExternalSorter> sorter, int rowWidth)
+    : sorter(std::move(sorter)), rowWidth(rowWidth),
+      buffer(static_cast<size_t>(ResultSet::BATCH_ROWS) * rowWidth) {}
+
+bool SortSource::next(ResultSet::Batch &batch) {
+  batch.count = static_cast<uint32_t>(
+      sorter->read(buffer.data(), ResultSet::BATCH_ROWS));
+  for (uint32_t i = 0; i < batch.count; ++i) {
+    batch.rows[i][0] = buffer.data() + static_cast<size_t>(i) * rowWidth;
+  }
+  return !sorter->failed();
+}
+
+SpoolSource::SpoolSource(std::vector<int> widths) : widths(std::move(widths)) {
+  for (int width : this->widths) {
+    tupleWidth += width;
+  }
+}
+
+void SpoolSource::append(const char *const *rows) {
+  size_t at = tuples.size();
+  tuples.resize(at + tupleWidth);
+  for (size_t k = 0; k < widths.size(); ++k) {
+    std::memcpy(tuples.data() + at, rows[k], widths[k]);
+    at += widths[k];
+  }
+}
+
+bool SpoolSource::next(ResultSet::Batch &batch) {
+  batch.count = 0;
+  while (batch.count < ResultSet::BATCH_ROWS &&
+         position + tupleWidth <= tuples.size()) {
+    const char *tuple = tuples.data() + position;
+    for (size_t k = 0; k < widths.size(); ++k) {
+      batch.rows[batch.count][k] = tuple;
+      tuple += widths[k];
+    }
+    ++batch.count;
+    position += tupleWidth;
+  }
+  return true;
+}
@@ -0,0 +1,291 @@
+#include "Entity/execution/SelectionKernels.h"
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SELECTION_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+using Op = Predicate::Op;
+constexpr uint32_t WORD = SelectionKernels::WORD_BITS;
+
+enum class Isa { Scalar, Sse2, Avx2 };
+
+Isa detectIsa() {
+#if defined(SELECTION_KERNELS_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Isa::Avx2;
+  }
+#endif
+#if defined(__SSE2__)
+  return Isa::Sse2;
+#else
+  return Isa::Scalar;
+#endif
+}
+
+Isa isa() {
+  static const Isa detected = detectIsa();
+  return detected;
+}
+
+// 把运行时的比较符变成编译期常量，每种比较符各生成一份内核
+template <typename Visit> void withOp(Op op, Visit &&visit) {
+  switch (op) {
+  case Op::Eq:
+    visit(std::integral_constant<Op, Op::Eq>());
+    break;
+  case Op::Ne:
+    visit(std::integral_constant<Op, Op::Ne>());
+    break;
+  case Op::Lt:
+    visit(std::integral_constant<Op, Op::Lt>());
+    break;
+  case Op::Gt:
+    visit(std::integral_constant<Op, Op::Gt>());
+    break;
+  case Op::Le:
+    visit(std::integral_constant<Op, Op::Le>());
+    break;
+  case Op::Ge:
+    visit(std::integral_constant<Op, Op::Ge>());
+    break;
+  }
+}
+
+template <Op op, typename T> bool test(T value, T constant) {
+  if constexpr (op == Op::Eq) {
+    return value == constant;
+  } else if constexpr (op == Op::Ne) {
+    return value != constant;
+  } else if constexpr (op == Op::Lt) {
+    return value < constant;
+  } else if constexpr (op == Op::Gt) {
+    return value > constant;
+  } else if constexpr (op == Op::Le) {
+    return value <= constant;
+  } else {
+    return value >= constant;
+  }
+}
+
+template <Op op, typename T>
+void scalarKernel(const T *values, uint32_t words, T constant,
+                  uint64_t *mask) {
+  for (uint32_t w = 0; w < words; ++w) {
+    const T *block = values + static_cast<size_t>(w) * WORD;
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < WORD; ++i) {
+      bits |= static_cast<uint64_t>(test<op>(block[i], constant)) << i;
+    }
+    mask[w] &= bits;
+  }
+}
+
+// 整数只有 == 和 > 两种比较指令：!=、<=、>= 先算相反的比较再取反
+template <Op op> constexpr bool invertedInt() {
+  return op == Op::Ne || op == Op::Le || op == Op::Ge;
+}
+
+#if defined(SELECTION_KERNELS_X86)
+template <Op op>
+__attribute__((target("avx2"))) void
+avx2Int(const int32_t *values, uint32_t words, int32_t constant,
+        uint64_t *mask) {
+  const __m256i c = _mm256_set1_epi32(constant);
+  for (uint32_t w = 0; w < words; ++w) {
+    const int32_t *block = values + static_cast<size_t>(w) * WORD;
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < WORD; i += 8) {
+      __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+      __m256i r;
+      if constexpr (op == Op::Eq || op == Op::Ne) {
+        r = _mm256_cmpeq_epi32(v, c);
+      } else if constexpr (op == Op::Gt || op == Op::Le) {
+        r = _mm256_cmpgt_epi32(v, c);
+      } else {
+        r = _mm256_cmpgt_epi32(c, v);
+      }
+      bits |= static_cast<uint64_t>(static_cast<uint32_t>(
+                  _mm256_movemask_ps(_mm256_castsi256_ps(r))))
+              << i;
+    }
+    mask[w] &= invertedInt<op>() ? ~bits : bits;
+  }
+}
+
+// 浮点比较用有序谓词，只有 != 用无序谓词，NaN 的结果与标量比较一致
+template <Op op> constexpr int avxPredicate() {
+  if constexpr (op == Op::Eq) {
+    return _CMP_EQ_OQ;
+  } else if constexpr (op == Op::Ne) {
+    return _CMP_NEQ_UQ;
+  } else if constexpr (op == Op::Lt) {
+    return _CMP_LT_OQ;
+  } else if constexpr (op == Op::Gt) {
+    return _CMP_GT_OQ;
+  } else if constexpr (op == Op::Le) {
+    return _CMP_LE_OQ;
+  } else {
+    return _CMP_GE_OQ;
+  }
+}
+
+template <Op op>
+__attribute__((target("avx2"))) void avx2Float(const float *values,
+                                               uint32_t words, float constant,
+                                               uint64_t *mask) {
+  const __m256 c = _mm256_set1_ps(constant);
+  constexpr int predicate = avxPredicate<op>();
+  for (uint32_t w = 0; w < words; ++w) {
+    const float *block = values + static_cast<size_t>(w) * WORD;
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < WORD; i += 8) {
+      __m256 r = _mm256_cmp_ps(_mm256_loadu_ps(block + i), c, predicate);
+      bits |= static_cast<uint64_t>(
+                  static_cast<uint32_t>(_mm256_movemask_ps(r)))
+              << i;
+    }
+    mask[w] &= bits;
+  }
+}
+#endif
+
+#if defined(__SSE2__)
+template <Op op>
+void sse2Int(const int32_t *values, uint32_t words, int32_t constant,
+             uint64_t *mask) {
+  const __m128i c = _mm_set1_epi32(constant);
+  for (uint32_t w = 0; w < words; ++w) {
+    const int32_t *block = values + static_cast<size_t>(w) * WORD;
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < WORD; i += 4) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+      __m128i r;
+      if constexpr (op == Op::Eq || op == Op::Ne) {
+        r = _mm_cmpeq_epi32(v, c);
+      } else if constexpr (op == Op::Gt || op == Op::Le) {
+        r = _mm_cmpgt_epi32(v, c);
+      } else {
+        r = _mm_cmplt_epi32(v, c);
+      }
+      bits |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(r))) << i;
+    }
+    mask[w] &= invertedInt<op>() ? ~bits : bits;
+  }
+}
+
+template <Op op> __m128 sse2Compare(__m128 v, __m128 c) {
+  if constexpr (op == Op::Eq) {
+    return _mm_cmpeq_ps(v, c);
+  } else if constexpr (op == Op::Ne) {
+    return _mm_cmpneq_ps(v, c);
+  } else if constexpr (op == Op::Lt) {
+    return _mm_cmplt_ps(v, c);
+  } else if constexpr (op == Op::Gt) {
+    return _mm_cmpgt_ps(v, c);
+  } else if constexpr (op == Op::Le) {
+    return _mm_cmple_ps(v, c);
+  } else {
+    return _mm_cmpge_ps(v, c);
+  }
+}
+
+template <Op op>
+void sse2Float(const float *values, uint32_t words, float constant,
+               uint64_t *mask) {
+  const __m128 c = _mm_set1_ps(constant);
+  for (uint32_t w = 0; w < words; ++w) {
+    const float *block = values + static_cast<size_t>(w) * WORD;
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < WORD; i += 4) {
+      __m128 r = sse2Compare<op>(_mm_loadu_ps(block + i), c);
+      bits |= static_cast<uint64_t>(_mm_movemask_ps(r)) << i;
+    }
+    mask[w] &= bits;
+  }
+}
+#endif
+
+uint32_t trailingZeros(uint64_t bits) {
+#if defined(__GNUC__)
+  return static_cast<uint32_t>(__builtin_ctzll(bits));
+#else
+  uint32_t n = 0;
+  while ((bits & 1) == 0) {
+    bits >>= 1;
+    ++n;
+  }
+  return n;
+#endif
+}
+} // namespace
+
+void SelectionKernels::compareInt32(const int32_t *values, uint32_t count,
+                                    Predicate::Op op, int32_t constant,
+                                    uint64_t *mask) {
+  uint32_t words = (count + WORD - 1) / WORD;
+  withOp(op, [&](auto tag) {
+    constexpr Op o = decltype(tag)::value;
+    switch (isa()) {
+#if defined(SELECTION_KERNELS_X86)
+    case Isa::Avx2:
+      avx2Int<o>(values, words, constant, mask);
+      return;
+#endif
+#if defined(__SSE2__)
+    case Isa::Sse2:
+      sse2Int<o>(values, words, constant, mask);
+      return;
+#endif
+    default:
+      scalarKernel<o>(values, words, constant, mask);
+      return;
+    }
+  });
+}
+
+void SelectionKernels::compareFloat(const float *values, uint32_t count,
+                                    Predicate::Op op, float constant,
+                                    uint64_t *mask) {
+  uint32_t words = (count + WORD - 1) / WORD;
+  withOp(op, [&](auto tag) {
+    constexpr Op o = decltype(tag)::value;
+    switch (isa()) {
+#if defined(SELECTION_KERNELS_X86)
+    case Isa::Avx2:
+      avx2Float<o>(values, words, constant, mask);
+      return;
+#endif
+#if defined(__SSE2__)
+    case Isa::Sse2:
+      sse2Float<o>(values, words, constant, mask);
+      return;
+#endif
+    default:
+      scalarKernel<o>(values, words, constant, mask);
+      return;
+    }
+  });
+}
+
+uint32_t SelectionKernels::toSelection(const uint64_t *mask, uint32_t count,
+                                       uint16_t *selection) {
+  uint32_t selected = 0;
+  uint32_t words = (count + WORD - 1) / WORD;
+  for (uint32_t w = 0; w < words; ++w) {
+    uint64_t bits = mask[w];
+    while (bits != 0) {
+      selection[selected++] =
+          static_cast<uint16_t>(w * WORD + trailingZeros(bits));
+      bits &= bits - 1;
+    }
+  }
+  return selected;
+}
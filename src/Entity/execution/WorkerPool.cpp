@@ -0,0 +1,77 @@
+#include "Entity/execution/WorkerPool.h"
+#include <algorithm>
+
+WorkerPool &WorkerPool::instance() {
+  static WorkerPool pool;
+  return pool;
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+void WorkerPool::run(size_t workers,
+                     const std::function<void(size_t worker)> &task) {
+  if (workers <= 1) {
+    task(0);
+    return;
+  }
+
+  Job job{&task, workers - 1};
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // 线程数只增不减，最多和单个任务要求的工作者数一样多
+    size_t wanted = std::min(workers - 1, MAX_THREADS);
+    while (threads.size() < wanted) {
+      threads.emplace_back([this] { workerLoop(); });
+    }
+    for (size_t worker = 1; worker < workers; ++worker) {
+      pending.push_back(Slot{&job, worker});
+    }
+  }
+  wake.notify_all();
+
+  task(0);
+
+  // 本任务还没被领走的份额由调用线程自己执行
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    auto it = std::find_if(pending.begin(), pending.end(),
+                           [&](const Slot &slot) { return slot.job == &job; });
+    if (it == pending.end()) {
+      break;
+    }
+    size_t worker = it->worker;
+    pending.erase(it);
+    lock.unlock();
+    task(worker);
+    lock.lock();
+    --job.unfinished;
+  }
+  finished.wait(lock, [&] { return job.unfinished == 0; });
+}
+
+void WorkerPool::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [&] { return stopping || !pending.empty(); });
+    if (pending.empty()) {
+      return;
+    }
+    Slot slot = pending.front();
+    pending.pop_front();
+    lock.unlock();
+    (*slot.job->task)(slot.worker);
+    lock.lock();
+    if (--slot.job->unfinished == 0) {
+      finished.notify_all();
+    }
+  }
+}
@@ -0,0 +1,547 @@
+#include "Entity/index/BPlusTree.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace {
+int compareRid(RowId a, RowId b) {
+  if (a.pageNo != b.pageNo) {
+    return a.pageNo < b.pageNo ? -1 : 1;
+  }
+  if (a.slot != b.slot) {
+    return a.slot < b.slot ? -1 : 1;
+  }
+  return 0;
+}
+
+template <typename T> int compareValue(const char *a, const char *b, int width) {
+  T x = 0;
+  T y = 0;
+  std::memcpy(&x, a, std::min<int>(sizeof(T), width));
+  std::memcpy(&y, b, std::min<int>(sizeof(T), width));
+  return x < y ? -1 : (y < x ? 1 : 0);
+}
+} // namespace
+
+BPlusTree::BPlusTree(fs::path path, std::vector<KeyPart> parts, bool unique)
+    : filePath(std::move(path)), keyParts(std::move(parts)), unique(unique) {
+  for (const auto &part : keyParts) {
+    keySize += part.width;
+  }
+  leafCapacity = static_cast<uint32_t>((PAGE_SIZE - sizeof(NodeHeader)) /
+                                       leafEntryWidth());
+  innerCapacity = static_cast<uint32_t>((PAGE_SIZE - sizeof(NodeHeader)) /
+                                        innerEntryWidth());
+}
+
+uint32_t BPlusTree::signature() const {
+  // FNV-1a，键的列类型或宽度变化后旧索引文件作废
+  uint32_t hash = 2166136261u;
+  auto mix = [&hash](uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      hash ^= (value >> (i * 8)) & 0xff;
+      hash *= 16777619u;
+    }
+  };
+  for (const auto &part : keyParts) {
+    mix(static_cast<uint32_t>(part.type));
+    mix(static_cast<uint32_t>(part.width));
+  }
+  mix(unique ? 1 : 0);
+  return hash;
+}
+
+int BPlusTree::compareKeys(const char *a, const char *b) const {
+  for (const auto &part : keyParts) {
+    int cmp = 0;
+    switch (part.type) {
+    case RowLayout::ColumnType::Integer:
+      cmp = compareValue<int32_t>(a, b, part.width);
+      break;
+    case RowLayout::ColumnType::Number:
+      cmp = compareValue<float>(a, b, part.width);
+      break;
+    default:
+      cmp = std::memcmp(a, b, part.width);
+      break;
+    }
+    if (cmp != 0) {
+      return cmp;
+    }
+    a += part.width;
+    b += part.width;
+  }
+  return 0;
+}
+
+int BPlusTree::compareEntries(const char *key, RowId rid,
+                              const char *entry) const {
+  int cmp = compareKeys(key, entry);
+  return cmp != 0 ? cmp : compareRid(rid, entryRid(entry));
+}
+
+bool BPlusTree::readMeta(Meta &meta) {
+  BufferPool::PageGuard page = BufferPool::instance().fetchPage(filePath, 0);
+  if (!page) {
+    return false;
+  }
+  std::memcpy(&meta, page.data(), sizeof(meta));
+  return meta.magic == META_MAGIC;
+}
+
+bool BPlusTree::writeMeta(const Meta &meta) {
+  BufferPool::PageGuard page = BufferPool::instance().fetchPage(filePath, 0);
+  if (!page) {
+    return false;
+  }
+  std::memcpy(page.data(), &meta, sizeof(meta));
+  page.markDirty();
+  return true;
+}
+
+bool BPlusTree::open() {
+  if (leafCapacity < 3 || innerCapacity < 3 || !fs::exists(filePath)) {
+    return false;
+  }
+  Meta meta{};
+  return readMeta(meta) && meta.keyWidth == static_cast<uint32_t>(keySize) &&
+         meta.signature == signature() && meta.unique == (unique ? 1u : 0u);
+}
+
+bool BPlusTree::create() {
+  if (leafCapacity < 3 || innerCapacity < 3) {
+    std::cerr << "Index key of " << keySize << " bytes is too wide for a "
+              << PAGE_SIZE << "-byte page." << std::endl;
+    return false;
+  }
+
+  BufferPool &pool = BufferPool::instance();
+  pool.dropFile(filePath);
+  std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "Failed to create index file " << filePath << std::endl;
+    return false;
+  }
+  out.close();
+
+  BufferPool::PageGuard page = pool.appendPage(filePath);
+  if (!page) {
+    return false;
+  }
+  Meta meta{META_MAGIC, static_cast<uint32_t>(keySize), signature(),
+            unique ? 1u : 0u, 0, 0, 0};
+  std::memcpy(page.data(), &meta, sizeof(meta));
+  page.markDirty();
+  return true;
+}
+
+BufferPool::PageGuard BPlusTree::newNode(bool leaf) {
+  BufferPool::PageGuard page = BufferPool::instance().appendPage(filePath);
+  if (page) {
+    NodeHeader *node = nodeHeader(page);
+    node->magic = NODE_MAGIC;
+    node->leaf = leaf ? 1 : 0;
+    node->reserved = 0;
+    node->count = 0;
+    node->link = 0;
+    page.markDirty();
+  }
+  return page;
+}
+
+uint32_t BPlusTree::lowerBound(const BufferPool::PageGuard &page,
+                               const char *key, RowId rid) const {
+  const NodeHeader *node = nodeHeader(page);
+  int width = node->leaf ? leafEntryWidth() : innerEntryWidth();
+  const char *base = entryAt(page, 0);
+  uint32_t low = 0;
+  uint32_t high = node->count;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (compareEntries(key, rid, base + static_cast<size_t>(mid) * width) > 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+bool BPlusTree::findLeaf(uint32_t root, const char *key, RowId rid,
+                         std::vector<uint32_t> *path, uint32_t &leafPage) {
+  uint32_t pageNo = root;
+  while (true) {
+    BufferPool::PageGuard page =
+        BufferPool::instance().fetchPage(filePath, pageNo);
+    if (!page || nodeHeader(page)->magic != NODE_MAGIC) {
+      std::cerr << "Corrupted index page " << pageNo << " in " << filePath
+                << std::endl;
+      return false;
+    }
+    const NodeHeader *node = nodeHeader(page);
+    if (node->leaf) {
+      leafPage = pageNo;
+      return true;
+    }
+
+    // 进入最后一个分隔键 <= (key, rid) 的孩子；没有这样的分隔键时进入最左孩子
+    uint32_t child = node->link;
+    if (key != nullptr) {
+      const char *base = entryAt(page, 0);
+      uint32_t low = 0;
+      uint32_t high = node->count;
+      while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        const char *entry = base + static_cast<size_t>(mid) * innerEntryWidth();
+        if (compareEntries(key, rid, entry) >= 0) {
+          low = mid + 1;
+        } else {
+          high = mid;
+        }
+      }
+      if (low > 0) {
+        child = entryChild(base + static_cast<size_t>(low - 1) *
+                                      innerEntryWidth());
+      }
+    }
+    if (path != nullptr) {
+      path->push_back(pageNo);
+    }
+    pageNo = child;
+  }
+}
+
+bool BPlusTree::seek(const char *key, bool inclusive, Cursor &cursor) {
+  Meta meta{};
+  if (!readMeta(meta)) {
+    return false;
+  }
+  cursor = Cursor();
+  if (meta.rootPage == 0) {
+    return true;
+  }
+
+  // 包含下界时定位到 (key, 最小 rid)，不包含时定位到 (key, 最大 rid) 之后
+  RowId rid = inclusive ? RowId{0, 0} : RowId{UINT32_MAX, UINT32_MAX};
+  uint32_t leafPage = 0;
+  if (!findLeaf(meta.rootPage, key, rid, nullptr, leafPage)) {
+    return false;
+  }
+  cursor.page = leafPage;
+  if (key != nullptr) {
+    BufferPool::PageGuard page =
+        BufferPool::instance().fetchPage(filePath, leafPage);
+    if (!page) {
+      return false;
+    }
+    cursor.pos = lowerBound(page, key, rid);
+  }
+  return true;
+}
+
+BPlusTree::Scanner BPlusTree::scanner(const char *low) {
+  Scanner scanner;
+  scanner.tree = this;
+  Cursor cursor;
+  scanner.error = !seek(low, true, cursor);
+  scanner.cursor = {cursor.page, cursor.pos};
+  return scanner;
+}
+
+const char *BPlusTree::Scanner::next() {
+  while (cursor.page != 0) {
+    if (!page || loaded != cursor.page) {
+      page = BufferPool::instance().fetchPage(tree->filePath, cursor.page);
+      if (!page) {
+        error = true;
+        cursor.page = 0;
+        return nullptr;
+      }
+      loaded = cursor.page;
+    }
+    const NodeHeader *node = nodeHeader(page);
+    if (cursor.pos < node->count) {
+      last = cursor;
+      return tree->entryAt(page, cursor.pos++);
+    }
+    // 空叶子和读完的叶子都顺链跳到右兄弟
+    cursor = {node->link, 0};
+  }
+  return nullptr;
+}
+
+bool BPlusTree::contains(const char *key) {
+  bool found = false;
+  lookup(key, [&found](const char *, RowId) {
+    found = true;
+    return false;
+  });
+  return found;
+}
+
+bool BPlusTree::insert(const char *key, RowId rid) {
+  Meta meta{};
+  if (!readMeta(meta)) {
+    return false;
+  }
+  if (unique && contains(key)) {
+    return false;
+  }
+
+  BufferPool &pool = BufferPool::instance();
+  if (meta.rootPage == 0) {
+    BufferPool::PageGuard root = newNode(true);
+    if (!root) {
+      return false;
+    }
+    char *entry = entryAt(root, 0);
+    std::memcpy(entry, key, keySize);
+    std::memcpy(entry + keySize, &rid, sizeof(rid));
+    nodeHeader(root)->count = 1;
+    meta.rootPage = root.pageNo();
+    meta.height = 1;
+    meta.entryCount = 1;
+    return writeMeta(meta);
+  }
+
+  // 自顶向下找到叶子，记录路径用于向上传播分裂
+  std::vector<uint32_t> path;
+  uint32_t leafPage = 0;
+  if (!findLeaf(meta.rootPage, key, rid, &path, leafPage)) {
+    return false;
+  }
+  BufferPool::PageGuard page = pool.fetchPage(filePath, leafPage);
+  if (!page) {
+    return false;
+  }
+
+  NodeHeader *leaf = nodeHeader(page);
+  int width = leafEntryWidth();
+  uint32_t pos = lowerBound(page, key, rid);
+  char *entry = entryAt(page, pos);
+  std::memmove(entry + width, entry, static_cast<size_t>(leaf->count - pos) * width);
+  std::memcpy(entry, key, keySize);
+  std::memcpy(entry + keySize, &rid, sizeof(rid));
+  ++leaf->count;
+  page.markDirty();
+  ++meta.entryCount;
+
+  if (leaf->count >= leafCapacity) {
+    // 叶子满了：后一半移到新叶子，新叶子的第一个条目作为分隔键插入父节点
+    BufferPool::PageGuard right = newNode(true);
+    if (!right) {
+      return false;
+    }
+    uint32_t half = leaf->count / 2;
+    NodeHeader *rightNode = nodeHeader(right);
+    rightNode->count = leaf->count - half;
+    std::memcpy(entryAt(right, 0), entryAt(page, half),
+                static_cast<size_t>(rightNode->count) * width);
+    rightNode->link = leaf->link;
+    leaf->count = half;
+    leaf->link = right.pageNo();
+
+    std::vector<char> separator(entryAt(right, 0), entryAt(right, 0) + width);
+    uint32_t rightPage = right.pageNo();
+    page.release();
+    right.release();
+    if (!insertIntoParent(path, meta, separator.data(),
+                          entryRid(separator.data()), rightPage)) {
+      return false;
+    }
+  }
+  return writeMeta(meta);
+}
+
+bool BPlusTree::insertIntoParent(std::vector<uint32_t> &path, Meta &meta,
+                                 const char *sepKey, RowId sepRid,
+                                 uint32_t rightPage) {
+  int width = innerEntryWidth();
+  if (path.empty()) {
+    // 根节点分裂，树长高一层
+    BufferPool::PageGuard root = newNode(false);
+    if (!root) {
+      return false;
+    }
+    NodeHeader *node = nodeHeader(root);
+    node->link = meta.rootPage;
+    node->count = 1;
+    char *entry = entryAt(root, 0);
+    std::memcpy(entry, sepKey, keySize);
+    std::memcpy(entry + keySize, &sepRid, sizeof(sepRid));
+    std::memcpy(entry + leafEntryWidth(), &rightPage, sizeof(rightPage));
+    meta.rootPage = root.pageNo();
+    ++meta.height;
+    return true;
+  }
+
+  uint32_t pageNo = path.back();
+  path.pop_back();
+  BufferPool::PageGuard page = BufferPool::instance().fetchPage(filePath, pageNo);
+  if (!page) {
+    return false;
+  }
+  NodeHeader *node = nodeHeader(page);
+  char *entry = entryAt(page, lowerBound(page, sepKey, sepRid));
+  uint32_t pos = static_cast<uint32_t>((entry - entryAt(page, 0)) / width);
+  std::memmove(entry + width, entry, static_cast<size_t>(node->count - pos) * width);
+  std::memcpy(entry, sepKey, keySize);
+  std::memcpy(entry + keySize, &sepRid, sizeof(sepRid));
+  std::memcpy(entry + leafEntryWidth(), &rightPage, sizeof(rightPage));
+  ++node->count;
+  page.markDirty();
+
+  if (node->count < innerCapacity) {
+    return true;
+  }
+
+  // 内部节点满了：中间条目上移，它的孩子成为新节点的最左孩子
+  BufferPool::PageGuard right = newNode(false);
+  if (!right) {
+    return false;
+  }
+  uint32_t mid = node->count / 2;
+  const char *middle = entryAt(page, mid);
+  NodeHeader *rightNode = nodeHeader(right);
+  rightNode->link = entryChild(middle);
+  rightNode->count = node->count - mid - 1;
+  std::memcpy(entryAt(right, 0), middle + width,
+              static_cast<size_t>(rightNode->count) * width);
+  node->count = mid;
+
+  std::vector<char> separator(middle, middle + leafEntryWidth());
+  uint32_t newRight = right.pageNo();
+  page.release();
+  right.release();
+  return insertIntoParent(path, meta, separator.data(),
+                          entryRid(separator.data()), newRight);
+}
+
+bool BPlusTree::erase(const char *key, RowId rid) {
+  Meta meta{};
+  if (!readMeta(meta) || meta.rootPage == 0) {
+    return false;
+  }
+
+  uint32_t leafPage = 0;
+  if (!findLeaf(meta.rootPage, key, rid, nullptr, leafPage)) {
+    return false;
+  }
+  BufferPool::PageGuard page =
+      BufferPool::instance().fetchPage(filePath, leafPage);
+  if (!page) {
+    return false;
+  }
+  NodeHeader *leaf = nodeHeader(page);
+  uint32_t pos = lowerBound(page, key, rid);
+  char *entry = entryAt(page, pos);
+  if (pos >= leaf->count || compareEntries(key, rid, entry) != 0) {
+    return false;
+  }
+  std::memmove(entry, entry + leafEntryWidth(),
+               static_cast<size_t>(leaf->count - pos - 1) * leafEntryWidth());
+  --leaf->count;
+  page.markDirty();
+  --meta.entryCount;
+  return writeMeta(meta);
+}
+
+bool BPlusTree::bulkLoad(std::vector<char> &entries, const char **duplicate) {
+  int width = leafEntryWidth();
+  size_t count = entries.size() / width;
+
+  std::vector<const char *> sorted;
+  sorted.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    sorted.push_back(entries.data() + i * width);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [this](const char *a, const char *b) {
+              return compareEntries(a, entryRid(a), b) < 0;
+            });
+  if (unique) {
+    for (size_t i = 1; i < count; ++i) {
+      if (compareKeys(sorted[i - 1], sorted[i]) == 0) {
+        if (duplicate != nullptr) {
+          *duplicate = sorted[i];
+        }
+        return false;
+      }
+    }
+  }
+
+  if (!create()) {
+    return false;
+  }
+  Meta meta{};
+  if (!readMeta(meta)) {
+    return false;
+  }
+  meta.entryCount = count;
+  if (count == 0) {
+    return writeMeta(meta);
+  }
+
+  // 叶子层：按顺序装填，每页留一成空位给之后的插入
+  struct Child {
+    uint32_t page;
+    const char *first; // 子树中最小的条目
+  };
+  std::vector<Child> level;
+  uint32_t leafFill = std::max<uint32_t>(1, (leafCapacity - 1) * 9 / 10);
+  BufferPool::PageGuard previous;
+  for (size_t i = 0; i < count; i += leafFill) {
+    BufferPool::PageGuard page = newNode(true);
+    if (!page) {
+      return false;
+    }
+    uint32_t n = static_cast<uint32_t>(std::min<size_t>(leafFill, count - i));
+    char *out = entryAt(page, 0);
+    for (uint32_t j = 0; j < n; ++j, out += width) {
+      std::memcpy(out, sorted[i + j], width);
+    }
+    nodeHeader(page)->count = n;
+    if (previous) {
+      nodeHeader(previous)->link = page.pageNo();
+    }
+    level.push_back({page.pageNo(), sorted[i]});
+    previous = std::move(page);
+  }
+  previous.release();
+  meta.height = 1;
+
+  // 内部层：每个节点最左孩子放在 link，其余孩子以其最小条目作为分隔键
+  uint32_t innerFill = std::max<uint32_t>(2, (innerCapacity - 1) * 9 / 10);
+  while (level.size() > 1) {
+    std::vector<Child> parents;
+    for (size_t i = 0; i < level.size(); i += innerFill + 1) {
+      BufferPool::PageGuard page = newNode(false);
+      if (!page) {
+        return false;
+      }
+      size_t end = std::min(level.size(), i + innerFill + 1);
+      NodeHeader *node = nodeHeader(page);
+      node->link = level[i].page;
+      char *out = entryAt(page, 0);
+      for (size_t j = i + 1; j < end; ++j, out += innerEntryWidth()) {
+        std::memcpy(out, level[j].first, width);
+        std::memcpy(out + width, &level[j].page, sizeof(uint32_t));
+      }
+      node->count = static_cast<uint32_t>(end - i - 1);
+      parents.push_back({page.pageNo(), level[i].first});
+    }
+    level = std::move(parents);
+    ++meta.height;
+  }
+  meta.rootPage = level.front().page;
+  return writeMeta(meta);
+}
+
+uint64_t BPlusTree::size() {
+  Meta meta{};
+  return readMeta(meta) ? meta.entryCount : 0;
+}
+
+bool BPlusTree::flush() { return BufferPool::instance().flushFile(filePath); }
@@ -0,0 +1,347 @@
+#include "Entity/index/TableIndex.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+// 把键的一个分量填成按该列类型比较时的最小值或最大值
+void fillBound(const RowLayout::Field &field, bool high, char *part) {
+  std::memset(part, high ? 0xff : 0, field.width);
+  if (field.type == RowLayout::ColumnType::Integer &&
+      field.width >= static_cast<int>(sizeof(int32_t))) {
+    int32_t value = high ? std::numeric_limits<int32_t>::max()
+                         : std::numeric_limits<int32_t>::min();
+    std::memcpy(part, &value, sizeof(value));
+  } else if (field.type == RowLayout::ColumnType::Number &&
+             field.width >= static_cast<int>(sizeof(float))) {
+    float value = high ? std::numeric_limits<float>::infinity()
+                       : -std::numeric_limits<float>::infinity();
+    std::memcpy(part, &value, sizeof(value));
+  }
+}
+} // namespace
+
+TableIndex::TableIndex(fs::path path, std::shared_ptr<const RowLayout> layout,
+                       std::vector<int> columns, bool unique)
+    : rowLayout(std::move(layout)), keyColumns(std::move(columns)),
+      index(std::move(path), keyParts(*rowLayout, keyColumns), unique) {}
+
+std::vector<BPlusTree::KeyPart>
+TableIndex::keyParts(const RowLayout &layout, const std::vector<int> &columns) {
+  std::vector<BPlusTree::KeyPart> parts;
+  parts.reserve(columns.size());
+  for (int col : columns) {
+    parts.push_back({layout.type(col), layout.field(col).width});
+  }
+  return parts;
+}
+
+std::unique_ptr<TableIndex>
+TableIndex::forPrimaryKey(const fs::path &tableDirPath,
+                          const std::string &tableName,
+                          std::shared_ptr<const RowLayout> layout) {
+  std::vector<int> columns;
+  for (int i = 0; i < layout->columnCount(); ++i) {
+    if (layout->table().columns[i].isPrimaryKey) {
+      columns.push_back(i);
+    }
+  }
+  if (columns.empty()) {
+    return nullptr;
+  }
+  return std::make_unique<TableIndex>(tableDirPath / (tableName + ".tid"),
+                                      std::move(layout), std::move(columns),
+                                      true);
+}
+
+std::unique_ptr<TableIndex>
+TableIndex::forColumn(const fs::path &tableDirPath,
+                      const std::string &tableName,
+                      std::shared_ptr<const RowLayout> layout, int column) {
+  std::unique_ptr<TableIndex> primary =
+      forPrimaryKey(tableDirPath, tableName, layout);
+  if (primary && primary->columns() == std::vector<int>{column}) {
+    return primary;
+  }
+  fs::path path =
+      tableDirPath /
+      (tableName + "." + layout->table().columns[column].name + ".tid");
+  return std::make_unique<TableIndex>(std::move(path), std::move(layout),
+                                      std::vector<int>{column}, false);
+}
+
+std::vector<std::unique_ptr<TableIndex>>
+TableIndex::forTable(const fs::path &tableDirPath, const std::string &tableName,
+                     std::shared_ptr<const RowLayout> layout) {
+  std::vector<std::unique_ptr<TableIndex>> indexes;
+  std::unique_ptr<TableIndex> primary =
+      forPrimaryKey(tableDirPath, tableName, layout);
+  if (primary) {
+    indexes.push_back(std::move(primary));
+  }
+
+  std::set<std::string> defined;
+  for (const Definition &definition :
+       readDefinitions(tableDirPath, tableName)) {
+    defined.insert(definition.name);
+    std::unique_ptr<TableIndex> index =
+        forDefinition(tableDirPath, tableName, layout, definition);
+    if (index) {
+      indexes.push_back(std::move(index));
+    }
+  }
+
+  // 外键建立的列索引按文件名找：<table>.<column>.tid，列已经不存在的文件不用
+  std::string prefix = tableName + ".";
+  std::vector<int> columns;
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(tableDirPath, ec)) {
+    std::string name = entry.path().filename().string();
+    if (entry.path().extension() != ".tid" ||
+        name.size() <= prefix.size() + 4 || name.compare(0, prefix.size(),
+                                                         prefix) != 0) {
+      continue;
+    }
+    std::string column =
+        name.substr(prefix.size(), name.size() - prefix.size() - 4);
+    int col = layout->columnIndex(column);
+    if (col != -1 && defined.count(column) == 0 &&
+        (indexes.empty() || indexes[0]->columns() != std::vector<int>{col})) {
+      columns.push_back(col);
+    }
+  }
+  std::sort(columns.begin(), columns.end());
+  for (int col : columns) {
+    indexes.push_back(forColumn(tableDirPath, tableName, layout, col));
+  }
+  return indexes;
+}
+
+std::unique_ptr<TableIndex>
+TableIndex::forDefinition(const fs::path &tableDirPath,
+                          const std::string &tableName,
+                          std::shared_ptr<const RowLayout> layout,
+                          const Definition &definition) {
+  std::vector<int> columns;
+  for (const auto *names : {&definition.columns, &definition.include}) {
+    for (const auto &name : *names) {
+      int col = layout->columnIndex(name);
+      if (col == -1) {
+        return nullptr;
+      }
+      columns.push_back(col);
+    }
+  }
+  return std::make_unique<TableIndex>(
+      tableDirPath / (tableName + "." + definition.name + ".tid"),
+      std::move(layout), std::move(columns), false);
+}
+
+std::vector<TableIndex::Definition>
+TableIndex::readDefinitions(const fs::path &tableDirPath,
+                            const std::string &tableName) {
+  // 每行一个索引：索引名，之后是各列的列名，以空白分隔；INCLUDE 的列写在 "|" 之后
+  std::vector<Definition> definitions;
+  std::ifstream in(tableDirPath / (tableName + ".tix"));
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    Definition definition;
+    if (!(fields >> definition.name)) {
+      continue;
+    }
+    std::vector<std::string> *columns = &definition.columns;
+    std::string column;
+    while (fields >> column) {
+      if (column == "|") {
+        columns = &definition.include;
+      } else {
+        columns->push_back(column);
+      }
+    }
+    definitions.push_back(std::move(definition));
+  }
+  return definitions;
+}
+
+bool TableIndex::writeDefinitions(const fs::path &tableDirPath,
+                                  const std::string &tableName,
+                                  const std::vector<Definition> &definitions) {
+  fs::path path = tableDirPath / (tableName + ".tix");
+  fs::path tempPath = path;
+  tempPath += ".tmp";
+  {
+    std::ofstream out(tempPath, std::ios::trunc);
+    for (const Definition &definition : definitions) {
+      out << definition.name;
+      for (const auto &column : definition.columns) {
+        out << " " << column;
+      }
+      if (!definition.include.empty()) {
+        out << " |";
+        for (const auto &column : definition.include) {
+          out << " " << column;
+        }
+      }
+      out << "\n";
+    }
+    if (!out) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  fs::rename(tempPath, path, ec);
+  return !ec;
+}
+
+void TableIndex::invalidate(const fs::path &path) {
+  BufferPool::instance().dropFile(path);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+}
+
+void TableIndex::invalidateAll(const fs::path &tableDirPath) {
+  std::error_code ec;
+  for (const auto &entry : fs::directory_iterator(tableDirPath, ec)) {
+    if (entry.path().extension() == ".tid") {
+      invalidate(entry.path());
+    }
+  }
+}
+
+bool TableIndex::open(const HeapFile &heap) {
+  if (index.open()) {
+    return true;
+  }
+  return rebuild(heap);
+}
+
+bool TableIndex::rebuild(const HeapFile &heap) {
+  std::vector<char> entries;
+  if (!heap.forEachRow([&](const char *row, RowId rid) {
+        collect(row, rid, entries);
+        return true;
+      })) {
+    return false;
+  }
+
+  std::string duplicate;
+  if (!load(entries, &duplicate)) {
+    if (!duplicate.empty()) {
+      std::cerr << "Cannot build index " << index.path().filename()
+                << ": duplicate key '" << duplicate << "'." << std::endl;
+    }
+    return false;
+  }
+  return true;
+}
+
+void TableIndex::makeKey(const char *row, char *key) const {
+  for (int col : keyColumns) {
+    const RowLayout::Field &field = rowLayout->field(col);
+    std::memcpy(key, row + field.offset, field.width);
+    key += field.width;
+  }
+}
+
+void TableIndex::rowFromKey(const char *key, char *row) const {
+  for (int col : keyColumns) {
+    const RowLayout::Field &field = rowLayout->field(col);
+    std::memcpy(row + field.offset, key, field.width);
+    key += field.width;
+  }
+}
+
+bool TableIndex::encodeKey(const std::vector<std::string> &values,
+                           std::vector<char> &key) const {
+  std::vector<char> row(rowLayout->rowWidth(), '\0');
+  for (size_t i = 0; i < keyColumns.size() && i < values.size(); ++i) {
+    if (!rowLayout->encodeField(row.data(), keyColumns[i], values[i])) {
+      return false;
+    }
+  }
+  key.resize(index.keyWidth());
+  makeKey(row.data(), key.data());
+  return true;
+}
+
+bool TableIndex::encodePrefix(const std::vector<std::string> &values,
+                              bool high, std::vector<char> &key) const {
+  if (!encodeKey(values, key)) {
+    return false;
+  }
+  char *part = key.data();
+  for (size_t i = 0; i < keyColumns.size(); ++i) {
+    const RowLayout::Field &field = rowLayout->field(keyColumns[i]);
+    if (i >= values.size()) {
+      fillBound(field, high, part);
+    }
+    part += field.width;
+  }
+  return true;
+}
+
+std::string TableIndex::describeKey(const char *key) const {
+  std::vector<char> row(rowLayout->rowWidth(), '\0');
+  for (int col : keyColumns) {
+    const RowLayout::Field &field = rowLayout->field(col);
+    std::memcpy(row.data() + field.offset, key, field.width);
+    key += field.width;
+  }
+
+  std::string text;
+  for (size_t i = 0; i < keyColumns.size(); ++i) {
+    if (i > 0) {
+      text += ", ";
+    }
+    text += rowLayout->toString(row.data(), keyColumns[i]);
+  }
+  return text;
+}
+
+bool TableIndex::containsRow(const char *row) {
+  std::vector<char> key(index.keyWidth());
+  makeKey(row, key.data());
+  return index.contains(key.data());
+}
+
+bool TableIndex::insert(const char *row, RowId rid) {
+  std::vector<char> key(index.keyWidth());
+  makeKey(row, key.data());
+  return index.insert(key.data(), rid);
+}
+
+bool TableIndex::erase(const char *row, RowId rid) {
+  std::vector<char> key(index.keyWidth());
+  makeKey(row, key.data());
+  return index.erase(key.data(), rid);
+}
+
+void TableIndex::collect(const char *row, RowId rid,
+                         std::vector<char> &entries) const {
+  size_t offset = entries.size();
+  entries.resize(offset + index.leafEntryWidth());
+  makeKey(row, entries.data() + offset);
+  std::memcpy(entries.data() + offset + index.keyWidth(), &rid, sizeof(rid));
+}
+
+bool TableIndex::load(std::vector<char> &entries, std::string *duplicate) {
+  const char *duplicateKey = nullptr;
+  if (!index.bulkLoad(entries, &duplicateKey)) {
+    if (duplicateKey != nullptr && duplicate != nullptr) {
+      *duplicate = describeKey(duplicateKey);
+    }
+    return false;
+  }
+  return index.flush();
+}
+
+bool TableIndex::covers(int column) const {
+  return std::find(keyColumns.begin(), keyColumns.end(), column) !=
+         keyColumns.end();
+}
@@ -0,0 +1,342 @@
+#include "Entity/storage/BufferPool.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+BufferPool::PageGuard &
+BufferPool::PageGuard::operator=(PageGuard &&other) noexcept {
+  if (this != &other) {
+    release();
+    pool = other.pool;
+    frame = other.frame;
+    other.frame = nullptr;
+  }
+  return *this;
+}
+
+void BufferPool::PageGuard::markDirty() {
+  if (frame != nullptr) {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    frame->dirty = true;
+  }
+}
+
+void BufferPool::PageGuard::release() {
+  if (frame != nullptr) {
+    pool->unpin(frame, false);
+    frame = nullptr;
+  }
+}
+
+BufferPool &BufferPool::instance() {
+  static BufferPool pool;
+  return pool;
+}
+
+BufferPool::~BufferPool() { flushAll(); }
+
+std::string BufferPool::makeKey(const fs::path &file) {
+  if (!file.is_absolute()) {
+    return fs::absolute(file).lexically_normal().string();
+  }
+  // 每次取页都要把路径规范化，热路径上按原始路径缓存结果
+  thread_local std::unordered_map<std::string, std::string> normalized;
+  auto it = normalized.find(file.native());
+  if (it != normalized.end()) {
+    return it->second;
+  }
+  if (normalized.size() >= 1024) {
+    normalized.clear();
+  }
+  return normalized.emplace(file.native(), file.lexically_normal().string())
+      .first->second;
+}
+
+BufferPool::FileState *BufferPool::openFileLocked(const std::string &key) {
+  auto it = files.find(key);
+  if (it != files.end()) {
+    return &it->second;
+  }
+
+  std::error_code ec;
+  std::uintmax_t size = fs::file_size(key, ec);
+  if (ec) {
+    return nullptr;
+  }
+  FileState &state = files[key];
+  state.stream.open(key, std::ios::in | std::ios::out | std::ios::binary);
+  if (!state.stream) {
+    files.erase(key);
+    return nullptr;
+  }
+  state.pageCount = static_cast<uint32_t>((size + PAGE_SIZE - 1) / PAGE_SIZE);
+  return &state;
+}
+
+BufferPool::Frame *BufferPool::allocateFrameLocked() {
+  if (frames.size() < capacity) {
+    frames.push_back(std::make_unique<Frame>());
+    frames.back()->data = std::make_unique<char[]>(PAGE_SIZE);
+    return frames.back().get();
+  }
+
+  // CLOCK：跳过被 pin 的页，清掉引用位给第二次机会，最多转两圈
+  for (size_t step = 0; step < 2 * frames.size(); ++step) {
+    Frame *frame = frames[clockHand].get();
+    clockHand = (clockHand + 1) % frames.size();
+    if (frame->pinCount > 0) {
+      continue; // 文件被替换后，读者仍 pin 着的旧页也不能复用
+    }
+    if (!frame->valid) {
+      return frame;
+    }
+    if (frame->referenced) {
+      frame->referenced = false;
+      continue;
+    }
+
+    auto it = files.find(frame->file);
+    if (it != files.end()) {
+      if (frame->dirty && !writeFrameLocked(it->second, *frame)) {
+        continue; // 写回失败的页保留在内存中
+      }
+      it->second.pages.erase(frame->pageNo);
+    }
+    frame->valid = false;
+    ++counters.evictions;
+    return frame;
+  }
+
+  // 所有页都被 pin 住时临时扩容，避免死等
+  frames.push_back(std::make_unique<Frame>());
+  frames.back()->data = std::make_unique<char[]>(PAGE_SIZE);
+  return frames.back().get();
+}
+
+bool BufferPool::writeFrameLocked(FileState &state, Frame &frame) {
+  state.stream.clear();
+  state.stream.seekp(static_cast<std::streamoff>(frame.pageNo) * PAGE_SIZE);
+  state.stream.write(frame.data.get(), PAGE_SIZE);
+  if (!state.stream) {
+    std::cerr << "Failed to write page " << frame.pageNo << " of " << frame.file
+              << std::endl;
+    state.stream.clear();
+    return false;
+  }
+  frame.dirty = false;
+  ++counters.writes;
+  return true;
+}
+
+BufferPool::PageGuard BufferPool::fetchPage(const fs::path &file,
+                                            uint32_t pageNo) {
+  std::string key = makeKey(file);
+  std::lock_guard<std::mutex> lock(mutex);
+  FileState *state = openFileLocked(key);
+  if (state == nullptr || pageNo >= state->pageCount) {
+    return PageGuard();
+  }
+
+  auto it = state->pages.find(pageNo);
+  if (it != state->pages.end()) {
+    Frame *frame = it->second;
+    ++frame->pinCount;
+    frame->referenced = true;
+    ++counters.hits;
+    return PageGuard(this, frame);
+  }
+
+  Frame *frame = allocateFrameLocked();
+  state->stream.clear();
+  state->stream.seekg(static_cast<std::streamoff>(pageNo) * PAGE_SIZE);
+  state->stream.read(frame->data.get(), PAGE_SIZE);
+  std::streamsize got = state->stream.gcount();
+  if (got < static_cast<std::streamsize>(PAGE_SIZE)) {
+    // 文件尾部不足一页（或是稀疏空洞）时按 0 补齐
+    std::memset(frame->data.get() + std::max<std::streamsize>(got, 0), 0,
+                PAGE_SIZE - std::max<std::streamsize>(got, 0));
+  }
+  state->stream.clear();
+
+  frame->file = key;
+  frame->pageNo = pageNo;
+  frame->pinCount = 1;
+  frame->dirty = false;
+  frame->referenced = true;
+  frame->valid = true;
+  state->pages[pageNo] = frame;
+  ++counters.misses;
+  return PageGuard(this, frame);
+}
+
+BufferPool::PageGuard BufferPool::appendPage(const fs::path &file) {
+  std::string key = makeKey(file);
+  std::lock_guard<std::mutex> lock(mutex);
+  FileState *state = openFileLocked(key);
+  if (state == nullptr) {
+    return PageGuard();
+  }
+
+  Frame *frame = allocateFrameLocked();
+  std::memset(frame->data.get(), 0, PAGE_SIZE);
+  frame->file = key;
+  frame->pageNo = state->pageCount++;
+  frame->pinCount = 1;
+  frame->dirty = true;
+  frame->referenced = true;
+  frame->valid = true;
+  state->pages[frame->pageNo] = frame;
+  return PageGuard(this, frame);
+}
+
+uint32_t BufferPool::pageCount(const fs::path &file) {
+  std::lock_guard<std::mutex> lock(mutex);
+  FileState *state = openFileLocked(makeKey(file));
+  return state == nullptr ? 0 : state->pageCount;
+}
+
+bool BufferPool::isOpen(const fs::path &file) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return files.find(makeKey(file)) != files.end();
+}
+
+bool BufferPool::flushFile(const fs::path &file) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = files.find(makeKey(file));
+  if (it == files.end()) {
+    return true;
+  }
+  return flushFileLocked(it->first, it->second);
+}
+
+bool BufferPool::flushFileLocked(const std::string &key, FileState &state) {
+  std::vector<Frame *> dirtyFrames;
+  for (const auto &[pageNo, frame] : state.pages) {
+    if (frame->dirty) {
+      dirtyFrames.push_back(frame);
+    }
+  }
+  std::sort(dirtyFrames.begin(), dirtyFrames.end(),
+            [](const Frame *a, const Frame *b) { return a->pageNo < b->pageNo; });
+
+  // 页号连续的脏页拼成一次大的顺序写
+  std::vector<char> staging;
+  bool ok = true;
+  for (size_t begin = 0; begin < dirtyFrames.size();) {
+    size_t end = begin + 1;
+    while (end < dirtyFrames.size() && end - begin < MAX_WRITE_PAGES &&
+           dirtyFrames[end]->pageNo == dirtyFrames[end - 1]->pageNo + 1) {
+      ++end;
+    }
+    if (end - begin == 1) {
+      ok &= writeFrameLocked(state, *dirtyFrames[begin]);
+      begin = end;
+      continue;
+    }
+
+    staging.resize((end - begin) * PAGE_SIZE);
+    for (size_t i = begin; i < end; ++i) {
+      std::memcpy(staging.data() + (i - begin) * PAGE_SIZE,
+                  dirtyFrames[i]->data.get(), PAGE_SIZE);
+    }
+    state.stream.clear();
+    state.stream.seekp(static_cast<std::streamoff>(dirtyFrames[begin]->pageNo) *
+                       PAGE_SIZE);
+    state.stream.write(staging.data(), staging.size());
+    if (!state.stream) {
+      std::cerr << "Failed to write pages " << dirtyFrames[begin]->pageNo
+                << "-" << dirtyFrames[end - 1]->pageNo << " of " << key
+                << std::endl;
+      state.stream.clear();
+      ok = false;
+    } else {
+      for (size_t i = begin; i < end; ++i) {
+        dirtyFrames[i]->dirty = false;
+      }
+      counters.writes += end - begin;
+    }
+    begin = end;
+  }
+  state.stream.flush();
+  return ok;
+}
+
+void BufferPool::dropFileLocked(const std::string &key) {
+  auto it = files.find(key);
+  if (it == files.end()) {
+    return;
+  }
+  for (auto &[pageNo, frame] : it->second.pages) {
+    frame->valid = false;
+    frame->dirty = false;
+    frame->file.clear();
+  }
+  files.erase(it);
+}
+
+void BufferPool::dropFile(const fs::path &file) {
+  std::lock_guard<std::mutex> lock(mutex);
+  dropFileLocked(makeKey(file));
+}
+
+void BufferPool::dropDirectory(const fs::path &dir) {
+  std::string prefix = makeKey(dir);
+  if (prefix.empty() || prefix.back() != fs::path::preferred_separator) {
+    prefix += fs::path::preferred_separator;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<std::string> keys;
+  for (const auto &[key, state] : files) {
+    if (key.compare(0, prefix.size(), prefix) == 0) {
+      keys.push_back(key);
+    }
+  }
+  for (const auto &key : keys) {
+    dropFileLocked(key);
+  }
+}
+
+bool BufferPool::flushDirectory(const fs::path &dir) {
+  std::string prefix = makeKey(dir);
+  if (prefix.empty() || prefix.back() != fs::path::preferred_separator) {
+    prefix += fs::path::preferred_separator;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  bool ok = true;
+  for (auto &[key, state] : files) {
+    if (key.compare(0, prefix.size(), prefix) == 0) {
+      ok = flushFileLocked(key, state) && ok;
+    }
+  }
+  return ok;
+}
+
+bool BufferPool::flushAll() {
+  // 不经过 makeKey：进程退出时析构函数也会调用这里，此时线程局部的路径缓存可能已经销毁
+  std::lock_guard<std::mutex> lock(mutex);
+  bool ok = true;
+  for (auto &[key, state] : files) {
+    ok = flushFileLocked(key, state) && ok;
+  }
+  return ok;
+}
+
+void BufferPool::setCapacity(size_t frameCount) {
+  std::lock_guard<std::mutex> lock(mutex);
+  capacity = std::max<size_t>(frameCount, 1);
+}
+
+BufferPool::Stats BufferPool::stats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return counters;
+}
+
+void BufferPool::unpin(Frame *frame, bool dirty) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (frame->pinCount > 0) {
+    --frame->pinCount;
+  }
+  frame->dirty |= dirty;
+}
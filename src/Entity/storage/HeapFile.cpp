@@ -0,0 +1,425 @@
+#include "Entity/storage/HeapFile.h"
+#include "Entity/index/TableIndex.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+HeapFile::HeapFile(fs::path path, int rowWidth)
+    : filePath(std::move(path)), width(rowWidth),
+      capacity(pageCapacity(static_cast<uint32_t>(rowWidth))) {}
+
+bool HeapFile::open() {
+  if (capacity == 0) {
+    std::cerr << "Row width " << width << " does not fit in a " << PAGE_SIZE
+              << "-byte page." << std::endl;
+    return false;
+  }
+  // 每次打开都重新找 zone map：它可能在别的对象上刚建立或被删除
+  auto zoneMap = std::make_shared<ZoneMap>(ZoneMap::pathFor(filePath));
+  zones = zoneMap->open() ? zoneMap : nullptr;
+
+  BufferPool &pool = BufferPool::instance();
+  if (pool.isOpen(filePath)) {
+    // 文件已在缓冲池中时不再读磁盘，用缓存的第 0 页核对行宽
+    if (pool.pageCount(filePath) == 0) {
+      return true;
+    }
+    BufferPool::PageGuard page = pool.fetchPage(filePath, 0);
+    if (!page) {
+      return false;
+    }
+    PageHeader header{};
+    std::memcpy(&header, page.data(), sizeof(header));
+    if (header.magic == PAGE_MAGIC &&
+        header.rowWidth != static_cast<uint32_t>(width)) {
+      std::cerr << "Data file " << filePath << " has row width "
+                << header.rowWidth << ", schema expects " << width << "."
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+  if (!fs::exists(filePath)) {
+    std::cerr << "Data file " << filePath << " does not exist." << std::endl;
+    return false;
+  }
+
+  std::error_code ec;
+  std::uintmax_t size = fs::file_size(filePath, ec);
+  if (!ec && size > 0) {
+    PageHeader header{};
+    std::ifstream in(filePath, std::ios::binary);
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    in.close();
+    if (header.magic != PAGE_MAGIC && header.magic != PAGE_MAGIC_V1) {
+      if (!upgradeLegacyFile()) {
+        return false;
+      }
+    } else if (header.rowWidth != static_cast<uint32_t>(width)) {
+      std::cerr << "Data file " << filePath << " has row width "
+                << header.rowWidth << ", schema expects " << width << "."
+                << std::endl;
+      return false;
+    } else if (header.magic == PAGE_MAGIC_V1 && !upgradeUnmarkedFile()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool HeapFile::create() {
+  BufferPool::instance().dropFile(filePath);
+  ZoneMap::remove(filePath);
+  zones = nullptr;
+  std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "Failed to create data file " << filePath << std::endl;
+    return false;
+  }
+  out.close();
+  return capacity != 0;
+}
+
+bool HeapFile::upgradeLegacyFile() {
+  // 旧格式：行紧密排列、没有页头。逐行读出后按页重写到临时文件再替换
+  fs::path tempPath = filePath;
+  tempPath += ".upgrade";
+  HeapFile upgraded(tempPath, width);
+  if (!upgraded.create()) {
+    return false;
+  }
+
+  std::ifstream in(filePath, std::ios::binary);
+  std::vector<char> rowBuffer(width);
+  while (in.read(rowBuffer.data(), width)) {
+    if (!upgraded.appendRow(rowBuffer.data())) {
+      discard(tempPath);
+      return false;
+    }
+  }
+  in.close();
+
+  std::cout << "Upgraded data file " << filePath.filename()
+            << " to the paged format." << std::endl;
+  return replace(tempPath, filePath);
+}
+
+bool HeapFile::upgradeUnmarkedFile() {
+  // 没有删除位图的分页格式：每页能放的行更多，逐页读出后按当前格式重新排列
+  fs::path tempPath = filePath;
+  tempPath += ".upgrade";
+  HeapFile upgraded(tempPath, width);
+  if (!upgraded.create()) {
+    return false;
+  }
+
+  uint32_t oldCapacity = (PAGE_SIZE - sizeof(PageHeader)) / width;
+  std::ifstream in(filePath, std::ios::binary);
+  std::vector<char> page(PAGE_SIZE);
+  while (in.read(page.data(), PAGE_SIZE)) {
+    PageHeader header{};
+    std::memcpy(&header, page.data(), sizeof(header));
+    if (header.magic != PAGE_MAGIC_V1) {
+      continue;
+    }
+    if (!upgraded.appendRows(page.data() + sizeof(PageHeader),
+                             std::min(header.rowCount, oldCapacity))) {
+      discard(tempPath);
+      return false;
+    }
+  }
+  in.close();
+
+  // 行位置变了，旧的索引都不能再用
+  TableIndex::invalidateAll(filePath.parent_path());
+  std::cout << "Upgraded data file " << filePath.filename()
+            << " to the tombstone page format." << std::endl;
+  return replace(tempPath, filePath);
+}
+
+bool HeapFile::appendRow(const char *row, RowId *rid) {
+  if (capacity == 0) {
+    return false;
+  }
+  BufferPool &pool = BufferPool::instance();
+  uint32_t pages = pool.pageCount(filePath);
+
+  BufferPool::PageGuard page;
+  if (pages > 0) {
+    page = pool.fetchPage(filePath, pages - 1);
+    if (!page) {
+      return false;
+    }
+    if (page.header()->magic == PAGE_MAGIC &&
+        page.header()->rowCount >= capacity) {
+      page.release();
+    }
+  }
+  if (!page) {
+    page = pool.appendPage(filePath);
+    if (!page) {
+      std::cerr << "Failed to allocate a page in " << filePath << std::endl;
+      return false;
+    }
+  }
+
+  PageHeader *header = page.header();
+  bool fresh = header->magic != PAGE_MAGIC;
+  if (fresh) {
+    header->magic = PAGE_MAGIC;
+    header->rowWidth = static_cast<uint32_t>(width);
+    header->rowCount = 0;
+    header->lsn = 0;
+  }
+  if (zones) {
+    zones->note(page.pageNo(), row, fresh);
+  }
+  uint32_t slot = header->rowCount++;
+  std::memcpy(page.rows() + static_cast<size_t>(slot) * width, row, width);
+  page.markDirty();
+  if (rid != nullptr) {
+    *rid = RowId{page.pageNo(), slot};
+  }
+  return true;
+}
+
+bool HeapFile::appendRows(const char *rows, size_t count,
+                          std::vector<RowId> *rids) {
+  if (capacity == 0) {
+    return false;
+  }
+  if (rids != nullptr) {
+    rids->reserve(rids->size() + count);
+  }
+  BufferPool &pool = BufferPool::instance();
+  uint32_t pages = pool.pageCount(filePath);
+  size_t done = 0;
+
+  while (done < count) {
+    BufferPool::PageGuard page;
+    if (pages > 0 && done == 0) {
+      page = pool.fetchPage(filePath, pages - 1);
+      if (!page) {
+        return false;
+      }
+      if (page.header()->magic == PAGE_MAGIC &&
+          page.header()->rowCount >= capacity) {
+        page.release();
+      }
+    }
+    if (!page) {
+      page = pool.appendPage(filePath);
+      if (!page) {
+        std::cerr << "Failed to allocate a page in " << filePath << std::endl;
+        return false;
+      }
+    }
+
+    PageHeader *header = page.header();
+    bool fresh = header->magic != PAGE_MAGIC;
+    if (fresh) {
+      header->magic = PAGE_MAGIC;
+      header->rowWidth = static_cast<uint32_t>(width);
+      header->rowCount = 0;
+      header->lsn = 0;
+    }
+    size_t n = std::min<size_t>(capacity - header->rowCount, count - done);
+    for (size_t i = 0; zones && i < n; ++i) {
+      zones->note(page.pageNo(), rows + (done + i) * width, fresh && i == 0);
+    }
+    std::memcpy(page.rows() + static_cast<size_t>(header->rowCount) * width,
+                rows + done * width, n * width);
+    if (rids != nullptr) {
+      for (size_t i = 0; i < n; ++i) {
+        rids->push_back(
+            RowId{page.pageNo(), header->rowCount + static_cast<uint32_t>(i)});
+      }
+    }
+    header->rowCount += static_cast<uint32_t>(n);
+    page.markDirty();
+    done += n;
+  }
+  return true;
+}
+
+bool HeapFile::nextRowIds(size_t count, std::vector<RowId> &rids) const {
+  if (capacity == 0) {
+    return false;
+  }
+  BufferPool &pool = BufferPool::instance();
+  uint32_t pages = pool.pageCount(filePath);
+  uint32_t pageNo = pages;
+  uint32_t slot = 0;
+  if (pages > 0) {
+    BufferPool::PageGuard page = pool.fetchPage(filePath, pages - 1);
+    if (!page) {
+      return false;
+    }
+    uint32_t used =
+        page.header()->magic == PAGE_MAGIC ? page.header()->rowCount : 0;
+    if (used < capacity) {
+      pageNo = pages - 1;
+      slot = used;
+    }
+  }
+  rids.reserve(rids.size() + count);
+  for (size_t i = 0; i < count; ++i) {
+    if (slot == capacity) {
+      ++pageNo;
+      slot = 0;
+    }
+    rids.push_back(RowId{pageNo, slot++});
+  }
+  return true;
+}
+
+bool HeapFile::placeRow(RowId rid, const char *row, uint32_t lsn) {
+  if (capacity == 0 || rid.slot >= capacity) {
+    return false;
+  }
+  BufferPool &pool = BufferPool::instance();
+  while (pool.pageCount(filePath) <= rid.pageNo) {
+    BufferPool::PageGuard page = pool.appendPage(filePath);
+    if (!page) {
+      std::cerr << "Failed to allocate a page in " << filePath << std::endl;
+      return false;
+    }
+  }
+  BufferPool::PageGuard page = pool.fetchPage(filePath, rid.pageNo);
+  if (!page) {
+    return false;
+  }
+  PageHeader *header = page.header();
+  bool fresh = header->magic != PAGE_MAGIC;
+  if (fresh) {
+    header->magic = PAGE_MAGIC;
+    header->rowWidth = static_cast<uint32_t>(width);
+    header->rowCount = 0;
+    header->lsn = 0;
+  }
+  if (zones) {
+    zones->note(rid.pageNo, row, fresh);
+  }
+  std::memcpy(page.rows() + static_cast<size_t>(rid.slot) * width, row, width);
+  setDeleted(page.data(), capacity, rid.slot, false);
+  header->rowCount = std::max(header->rowCount, rid.slot + 1);
+  header->lsn = std::max(header->lsn, lsn);
+  page.markDirty();
+  return true;
+}
+
+bool HeapFile::updateRow(RowId rid, const char *row, uint32_t lsn) {
+  if (rid.pageNo >= pageCount()) {
+    return false;
+  }
+  BufferPool::PageGuard page =
+      BufferPool::instance().fetchPage(filePath, rid.pageNo);
+  if (!page || page.header()->magic != PAGE_MAGIC ||
+      rid.slot >= page.header()->rowCount) {
+    return false;
+  }
+  if (zones) {
+    zones->note(rid.pageNo, row, false);
+  }
+  std::memcpy(page.rows() + static_cast<size_t>(rid.slot) * width, row, width);
+  page.header()->lsn = std::max(page.header()->lsn, lsn);
+  page.markDirty();
+  return true;
+}
+
+bool HeapFile::eraseRow(RowId rid, uint32_t lsn) {
+  if (rid.pageNo >= pageCount()) {
+    return false;
+  }
+  BufferPool::PageGuard page =
+      BufferPool::instance().fetchPage(filePath, rid.pageNo);
+  if (!page || page.header()->magic != PAGE_MAGIC ||
+      rid.slot >= page.header()->rowCount) {
+    return false;
+  }
+  setDeleted(page.data(), capacity, rid.slot, true);
+  page.header()->lsn = std::max(page.header()->lsn, lsn);
+  page.markDirty();
+  return true;
+}
+
+bool HeapFile::countRows(size_t &live, size_t &dead) const {
+  live = 0;
+  dead = 0;
+  uint32_t pages = pageCount();
+  for (uint32_t pageNo = 0; pageNo < pages; ++pageNo) {
+    BufferPool::PageGuard page =
+        BufferPool::instance().fetchPage(filePath, pageNo);
+    if (!page) {
+      return false;
+    }
+    uint32_t rowCount =
+        page.header()->magic == PAGE_MAGIC ? page.header()->rowCount : 0;
+    for (uint32_t slot = 0; slot < rowCount; ++slot) {
+      ++(isDeleted(page.data(), capacity, slot) ? dead : live);
+    }
+  }
+  return true;
+}
+
+bool HeapFile::flush() {
+  BufferPool &pool = BufferPool::instance();
+  return pool.flushFile(filePath) &&
+         (!zones || pool.flushFile(ZoneMap::pathFor(filePath)));
+}
+
+bool HeapFile::buildZoneMap(std::vector<ZoneMap::Column> columns) {
+  auto zoneMap = std::make_shared<ZoneMap>(ZoneMap::pathFor(filePath));
+  if (!zoneMap->build(*this, std::move(columns))) {
+    return false;
+  }
+  zones = zoneMap;
+  return true;
+}
+
+bool HeapFile::mapForRead() {
+  // 映射读的是磁盘上的内容，缓冲池中尚未写回的修改要先落盘
+  if (!BufferPool::instance().flushFile(filePath)) {
+    return false;
+  }
+  mapping = MappedFile::open(filePath);
+  return mapping != nullptr;
+}
+
+bool HeapFile::replace(const fs::path &tempPath, const fs::path &targetPath) {
+  BufferPool &pool = BufferPool::instance();
+  if (!pool.flushFile(tempPath)) {
+    return false;
+  }
+  pool.dropFile(tempPath);
+  pool.dropFile(targetPath);
+  // 旧文件的 zone map 对新文件无效（临时文件上不会建立 zone map）
+  ZoneMap::remove(targetPath);
+
+  // rename 直接覆盖目标文件，任何时刻目标路径上都有一个完整的文件
+  std::error_code ec;
+  fs::rename(tempPath, targetPath, ec);
+  if (ec) {
+    std::cerr << "Failed to replace data file " << targetPath << ": "
+              << ec.message() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void HeapFile::discard(const fs::path &tempPath) {
+  BufferPool::instance().dropFile(tempPath);
+  std::error_code ec;
+  fs::remove(tempPath, ec);
+}
+
+fs::path HeapFile::temporaryPath(const fs::path &base, const std::string &tag) {
+  static std::atomic<uint64_t> counter{0};
+  fs::path path = base;
+  path += "." + tag + std::to_string(counter++) + ".tmp";
+  return path;
+}
@@ -0,0 +1,66 @@
+#include "Entity/storage/MappedFile.h"
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+std::shared_ptr<const MappedFile> MappedFile::open(const fs::path &path) {
+#ifdef _WIN32
+  (void)path;
+  return nullptr;
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0 ||
+      info.st_size % PAGE_SIZE != 0) {
+    // 末尾不足一页时，映射中超出文件长度的部分访问时会出错，这种文件不映射
+    ::close(fd);
+    return nullptr;
+  }
+  size_t length = static_cast<size_t>(info.st_size);
+  void *base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd); // 映射建立后不再需要文件描述符
+  if (base == MAP_FAILED) {
+    return nullptr;
+  }
+  madvise(base, length, MADV_SEQUENTIAL);
+  return std::shared_ptr<const MappedFile>(new MappedFile(
+      static_cast<const char *>(base),
+      static_cast<uint32_t>(length / PAGE_SIZE)));
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  munmap(const_cast<char *>(base), static_cast<size_t>(pages) * PAGE_SIZE);
+#endif
+}
+
+void MappedFile::willNeed(uint32_t firstPage, uint32_t endPage) const {
+#ifndef _WIN32
+  endPage = std::min(endPage, pages);
+  if (firstPage >= endPage) {
+    return;
+  }
+  char *begin = const_cast<char *>(page(firstPage));
+  size_t length = static_cast<size_t>(endPage - firstPage) * PAGE_SIZE;
+#ifdef MADV_POPULATE_READ
+  // 顺带建好页表，扫描时不会每 4 KiB 缺页一次；老内核不支持时退回预读提示
+  if (madvise(begin, length, MADV_POPULATE_READ) == 0) {
+    return;
+  }
+#endif
+  madvise(begin, length, MADV_WILLNEED);
+#else
+  (void)firstPage;
+  (void)endPage;
+#endif
+}
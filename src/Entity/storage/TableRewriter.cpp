@@ -0,0 +1,195 @@
+#include "Entity/storage/TableRewriter.h"
+#include "Entity/index/TableIndex.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+TableRewriter::TableRewriter(WriteAheadLog &wal, std::string tableName,
+                             int rowWidth)
+    : log(wal), table(std::move(tableName)), width(rowWidth),
+      dataPath(log.dir / table / (table + ".trd")), tempPath(dataPath) {
+  tempPath += ".tmp";
+}
+
+bool TableRewriter::run(const Options &options, const RowOrder &order,
+                        const SwapHook &onSwap, Stats *stats) {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point start = Clock::now();
+  Stats result;
+  HeapFile source(dataPath, width);
+  if (!source.open()) {
+    return false;
+  }
+
+  // 开始捕获和确定复制顺序在同一次暂停里完成：没有被复制到的修改一定会被捕获
+  std::vector<RowId> rids;
+  {
+    std::unique_lock<std::shared_mutex> guard(log.commitLock);
+    {
+      std::lock_guard<std::mutex> lock(log.captureMutex);
+      if (!log.captures.emplace(table, std::vector<Changes>()).second) {
+        std::cerr << "Table '" << table << "' is already being rewritten."
+                  << std::endl;
+        return false;
+      }
+    }
+    if (!order || !order(rids)) {
+      rids.clear();
+      source.forEachRow([&](const char *, RowId rid) {
+        rids.push_back(rid);
+        return true;
+      });
+    }
+    result.pagesBefore = source.pageCount();
+  }
+
+  HeapFile target(tempPath, width);
+  if (!target.create()) {
+    abandon();
+    return false;
+  }
+  moved.clear();
+  moved.reserve(rids.size());
+
+  // 分批复制：批内暂停提交，批间按限速休眠，读始终不受影响
+  size_t batchRows = std::max<size_t>(options.batchRows, 1);
+  bool ok = true;
+  for (size_t begin = 0; ok && begin < rids.size(); begin += batchRows) {
+    size_t end = std::min(rids.size(), begin + batchRows);
+    {
+      std::unique_lock<std::shared_mutex> guard(log.commitLock);
+      for (size_t i = begin; ok && i < end; ++i) {
+        source.withRow(rids[i], [&](const char *row) {
+          RowId rid{};
+          ok = target.appendRow(row, &rid);
+          moved[Transaction::keyOf(rids[i])] = rid;
+        });
+      }
+    }
+    if (options.bytesPerSecond != 0) {
+      std::chrono::duration<double> due(static_cast<double>(end) * width /
+                                        options.bytesPerSecond);
+      std::chrono::duration<double> elapsed = Clock::now() - start;
+      if (due > elapsed) {
+        std::this_thread::sleep_for(due - elapsed);
+      }
+    }
+  }
+  if (!ok) {
+    std::cerr << "Failed to copy table '" << table << "'." << std::endl;
+    abandon();
+    return false;
+  }
+
+  // 追赶复制期间的修改；每一轮追完后新捕获的修改越来越少，足够少时进入最后一步
+  for (int round = 0; round < 8; ++round) {
+    std::vector<Changes> changes;
+    {
+      std::lock_guard<std::mutex> lock(log.captureMutex);
+      changes.swap(log.captures[table]);
+    }
+    if (!catchUp(changes, target, result.caughtUp)) {
+      abandon();
+      return false;
+    }
+    if (changes.size() < 16) {
+      break;
+    }
+  }
+
+  // 最后一步暂停提交：追完剩余的修改，新文件落盘并清空日志后原子地换上。
+  // 先拿表的写锁，等已经按旧文件算出行位置的语句提交并维护完索引
+  {
+    WriteAheadLog::TableLocks locks = log.lockTables({table});
+    std::unique_lock<std::shared_mutex> guard(log.commitLock);
+    std::vector<Changes> changes;
+    {
+      std::lock_guard<std::mutex> lock(log.captureMutex);
+      changes.swap(log.captures[table]);
+    }
+    if (!catchUp(changes, target, result.caughtUp)) {
+      abandon();
+      return false;
+    }
+    result.rows = moved.size();
+    result.pagesAfter = target.pageCount();
+    {
+      std::lock_guard<std::mutex> lock(log.captureMutex);
+      log.captures.erase(table);
+    }
+
+    // 行位置全部变化：先清空表的所有索引，换文件后崩溃时下一次打开会重建
+    TableIndex::invalidateAll(dataPath.parent_path());
+    bool replaced;
+    {
+      std::lock_guard<std::mutex> lock(log.mutex);
+      replaced = log.replaceTableLocked(tempPath, dataPath);
+    }
+    if (!replaced) {
+      std::cerr << "Failed to replace data file of table '" << table << "'."
+                << std::endl;
+      HeapFile::discard(tempPath);
+      return false;
+    }
+    if (onSwap) {
+      onSwap(source);
+    }
+  }
+
+  result.seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  if (stats != nullptr) {
+    *stats = result;
+  }
+  return true;
+}
+
+bool TableRewriter::catchUp(std::vector<Changes> &changes, HeapFile &target,
+                            size_t &applied) {
+  for (const Changes &change : changes) {
+    if (change.inserts.empty() && change.updates.empty() &&
+        change.deletes.empty()) {
+      std::cerr << "Table '" << table
+                << "' was bulk loaded during the rewrite. Rewrite aborted."
+                << std::endl;
+      return false;
+    }
+    for (const auto &[rid, row] : change.inserts) {
+      RowId newRid{};
+      if (!target.appendRow(row.data(), &newRid)) {
+        return false;
+      }
+      moved[Transaction::keyOf(rid)] = newRid;
+    }
+    // 复制之前就已被删除的行不在新文件中，对它们的更新和删除直接跳过
+    for (const auto &[key, row] : change.updates) {
+      auto it = moved.find(key);
+      if (it != moved.end() && !target.updateRow(it->second, row.data(), 0)) {
+        return false;
+      }
+    }
+    for (uint64_t key : change.deletes) {
+      auto it = moved.find(key);
+      if (it != moved.end()) {
+        if (!target.eraseRow(it->second, 0)) {
+          return false;
+        }
+        moved.erase(it);
+      }
+    }
+    applied += change.inserts.size() + change.updates.size() +
+               change.deletes.size();
+  }
+  return true;
+}
+
+void TableRewriter::abandon() {
+  {
+    std::lock_guard<std::mutex> lock(log.captureMutex);
+    log.captures.erase(table);
+  }
+  HeapFile::discard(tempPath);
+}
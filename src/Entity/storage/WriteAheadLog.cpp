@@ -0,0 +1,527 @@
+#include "Entity/storage/WriteAheadLog.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr uint32_t LOG_MAGIC = 0x4c415754;    // "TWAL"
+constexpr uint32_t RECORD_MAGIC = 0x524c4157; // "WALR"
+constexpr uint32_t LOG_VERSION = 1;
+
+std::atomic<size_t> checkpointBytes{16u << 20}; // 默认 16 MiB
+
+struct LogHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t baseLsn; // 清空日志时的下一个记录号，保证重启后记录号仍然递增
+  uint32_t reserved;
+};
+
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t lsn;
+  uint32_t length; // 记录体字节数
+  uint32_t checksum;
+};
+
+uint32_t checksumOf(const char *data, size_t size) {
+  uint32_t hash = 2166136261u; // FNV-1a
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+bool syncFile(std::FILE *file) {
+#ifdef _WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool syncPath(const fs::path &path) {
+  std::FILE *file = std::fopen(path.string().c_str(), "r+b");
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = syncFile(file);
+  std::fclose(file);
+  return ok;
+}
+
+template <typename T> void put(std::vector<char> &out, const T &value) {
+  const char *bytes = reinterpret_cast<const char *>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// 顺序读取记录体，越界时 ok 变为 false
+struct Reader {
+  const char *data;
+  size_t size;
+  size_t pos = 0;
+  bool ok = true;
+
+  template <typename T> T get() {
+    T value{};
+    if (pos + sizeof(T) > size) {
+      ok = false;
+      return value;
+    }
+    std::memcpy(&value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+
+  const char *take(size_t n) {
+    if (pos + n > size) {
+      ok = false;
+      return nullptr;
+    }
+    const char *p = data + pos;
+    pos += n;
+    return p;
+  }
+};
+} // namespace
+
+struct WriteAheadLog::Registry {
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<WriteAheadLog>> logs;
+
+  ~Registry() {
+    // 正常退出时做检查点，下次启动不必重做。用 flushAll 而不是按目录写回：
+    // 此时线程局部的路径缓存可能已经销毁
+    BufferPool::instance().flushAll();
+    for (auto &[dir, log] : logs) {
+      std::unique_lock<std::shared_mutex> guard(log->commitLock);
+      std::lock_guard<std::mutex> lock(log->mutex);
+      log->checkpointLocked(false);
+    }
+  }
+
+  static Registry &instance() {
+    // 先构造缓冲池，保证析构时缓冲池还在
+    BufferPool::instance();
+    static Registry registry;
+    return registry;
+  }
+};
+
+void WriteAheadLog::Transaction::insert(const std::string &table,
+                                        const HeapFile &heap, RowId rid,
+                                        const char *row) {
+  TableChanges &changes = changesOf(table, heap);
+  changes.inserts.emplace_back(rid,
+                               std::vector<char>(row, row + heap.rowWidth()));
+}
+
+void WriteAheadLog::Transaction::update(const std::string &table,
+                                        const HeapFile &heap, RowId rid,
+                                        const char *row) {
+  TableChanges &changes = changesOf(table, heap);
+  changes.updates[keyOf(rid)].assign(row, row + heap.rowWidth());
+}
+
+void WriteAheadLog::Transaction::erase(const std::string &table,
+                                       const HeapFile &heap, RowId rid) {
+  TableChanges &changes = changesOf(table, heap);
+  changes.updates.erase(keyOf(rid));
+  changes.deletes.insert(keyOf(rid));
+}
+
+void WriteAheadLog::Transaction::touch(const std::string &table,
+                                       const HeapFile &heap) {
+  changesOf(table, heap);
+}
+
+const char *WriteAheadLog::Transaction::pendingRow(const std::string &table,
+                                                   RowId rid,
+                                                   bool &deleted) const {
+  deleted = false;
+  auto it = tables.find(table);
+  if (it == tables.end()) {
+    return nullptr;
+  }
+  uint64_t key = keyOf(rid);
+  if (it->second.deletes.count(key) != 0) {
+    deleted = true;
+    return nullptr;
+  }
+  auto updated = it->second.updates.find(key);
+  return updated == it->second.updates.end() ? nullptr
+                                             : updated->second.data();
+}
+
+WriteAheadLog::Transaction::TableChanges &
+WriteAheadLog::Transaction::changesOf(const std::string &table,
+                                      const HeapFile &heap) {
+  TableChanges &changes = tables[table];
+  changes.rowWidth = heap.rowWidth();
+  return changes;
+}
+
+WriteAheadLog &WriteAheadLog::forDatabase(const fs::path &dbDir) {
+  Registry &registry = Registry::instance();
+  std::string key = fs::absolute(dbDir).lexically_normal().string();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto it = registry.logs.find(key);
+  if (it == registry.logs.end()) {
+    std::unique_ptr<WriteAheadLog> log(new WriteAheadLog(key));
+    log->recover();
+    it = registry.logs.emplace(key, std::move(log)).first;
+  }
+  return *it->second;
+}
+
+void WriteAheadLog::discard(const fs::path &dbDir) {
+  Registry &registry = Registry::instance();
+  std::string key = fs::absolute(dbDir).lexically_normal().string();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.logs.erase(key);
+}
+
+void WriteAheadLog::setCheckpointBytes(size_t bytes) {
+  checkpointBytes = std::max<size_t>(bytes, PAGE_SIZE);
+}
+
+WriteAheadLog::WriteAheadLog(fs::path dbDir)
+    : dir(std::move(dbDir)), logPath(dir / "wal.log") {}
+
+WriteAheadLog::~WriteAheadLog() {
+  if (file != nullptr) {
+    std::fclose(file);
+  }
+}
+
+std::vector<std::string> WriteAheadLog::takeRecoveredTables() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return std::move(recoveredTables);
+}
+
+void WriteAheadLog::encode(const Transaction &txn, std::vector<char> &payload) {
+  // 每张表一段：表名、行宽、三类修改的条数，然后依次是插入 (rid, 行)、更新 (rid, 行)、删除 rid
+  for (const auto &[table, changes] : txn.tables) {
+    put(payload, static_cast<uint16_t>(table.size()));
+    payload.insert(payload.end(), table.begin(), table.end());
+    put(payload, static_cast<uint32_t>(changes.rowWidth));
+    put(payload, static_cast<uint32_t>(changes.inserts.size()));
+    put(payload, static_cast<uint32_t>(changes.updates.size()));
+    put(payload, static_cast<uint32_t>(changes.deletes.size()));
+    for (const auto &[rid, row] : changes.inserts) {
+      put(payload, rid);
+      payload.insert(payload.end(), row.begin(), row.end());
+    }
+    for (const auto &[key, row] : changes.updates) {
+      put(payload, Transaction::rowIdOf(key));
+      payload.insert(payload.end(), row.begin(), row.end());
+    }
+    for (uint64_t key : changes.deletes) {
+      put(payload, Transaction::rowIdOf(key));
+    }
+  }
+}
+
+bool WriteAheadLog::decode(const char *data, size_t size, Transaction &txn) {
+  Reader in{data, size};
+  while (in.ok && in.pos < size) {
+    uint16_t nameLength = in.get<uint16_t>();
+    const char *name = in.take(nameLength);
+    uint32_t rowWidth = in.get<uint32_t>();
+    uint32_t inserts = in.get<uint32_t>();
+    uint32_t updates = in.get<uint32_t>();
+    uint32_t deletes = in.get<uint32_t>();
+    if (!in.ok) {
+      break;
+    }
+    Transaction::TableChanges &changes =
+        txn.tables[std::string(name, nameLength)];
+    changes.rowWidth = static_cast<int>(rowWidth);
+    for (uint32_t i = 0; in.ok && i < inserts; ++i) {
+      RowId rid = in.get<RowId>();
+      const char *row = in.take(rowWidth);
+      if (row != nullptr) {
+        changes.inserts.emplace_back(rid,
+                                     std::vector<char>(row, row + rowWidth));
+      }
+    }
+    for (uint32_t i = 0; in.ok && i < updates; ++i) {
+      RowId rid = in.get<RowId>();
+      const char *row = in.take(rowWidth);
+      if (row != nullptr) {
+        changes.updates[Transaction::keyOf(rid)].assign(row, row + rowWidth);
+      }
+    }
+    for (uint32_t i = 0; in.ok && i < deletes; ++i) {
+      changes.deletes.insert(Transaction::keyOf(in.get<RowId>()));
+    }
+  }
+  return in.ok;
+}
+
+bool WriteAheadLog::recover() {
+  std::unique_lock<std::shared_mutex> guard(commitLock);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!fs::exists(logPath)) {
+    return true;
+  }
+
+  std::ifstream in(logPath, std::ios::binary);
+  std::vector<char> data((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+  in.close();
+  LogHeader header{};
+  if (data.size() < sizeof(header)) {
+    return resetLocked();
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != LOG_MAGIC || header.version != LOG_VERSION) {
+    std::cerr << "Unrecognized log file " << logPath << ", ignored."
+              << std::endl;
+    return resetLocked();
+  }
+  nextLsn = std::max<uint32_t>(header.baseLsn, 1);
+
+  // 读出所有完整的记录；末尾写了一半的记录（校验和不对）说明提交没有完成，丢弃
+  std::vector<std::pair<uint32_t, Transaction>> records;
+  size_t pos = sizeof(header);
+  while (pos + sizeof(RecordHeader) <= data.size()) {
+    RecordHeader record{};
+    std::memcpy(&record, data.data() + pos, sizeof(record));
+    const char *body = data.data() + pos + sizeof(record);
+    if (record.magic != RECORD_MAGIC || record.lsn < nextLsn ||
+        record.length > data.size() - pos - sizeof(record) ||
+        checksumOf(body, record.length) != record.checksum) {
+      break;
+    }
+    Transaction txn;
+    if (!decode(body, record.length, txn)) {
+      break;
+    }
+    records.emplace_back(record.lsn, std::move(txn));
+    nextLsn = record.lsn + 1;
+    pos += sizeof(record) + record.length;
+  }
+  if (records.empty()) {
+    return resetLocked();
+  }
+
+  // 每条记录都是对行槽的物理修改（写入行、改写行、打墓碑），按顺序全部重做一遍结果不变。
+  // 不按页头的记录号跳过：检查点写回一半时崩溃，页头可能已经是新的而行槽还是旧的
+  std::set<std::string> touched;
+  bool ok = true;
+  for (const auto &[lsn, txn] : records) {
+    for (const auto &[table, changes] : txn.tables) {
+      touched.insert(table);
+      if (!fs::exists(dir / table / (table + ".trd"))) {
+        continue;
+      }
+      ok = applyTable(table, changes, lsn) && ok;
+    }
+  }
+  recoveredTables.assign(touched.begin(), touched.end());
+  std::cout << "Replayed " << records.size() << " log records in "
+            << dir.filename() << "." << std::endl;
+  logBytes = data.size();
+  return ok && checkpointLocked(true);
+}
+
+uint32_t WriteAheadLog::append(const std::vector<char> &payload) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (file == nullptr && !resetLocked()) {
+    return 0;
+  }
+  uint32_t lsn = nextLsn++;
+  RecordHeader record{RECORD_MAGIC, lsn, static_cast<uint32_t>(payload.size()),
+                      checksumOf(payload.data(), payload.size())};
+  put(pending, record);
+  pending.insert(pending.end(), payload.begin(), payload.end());
+
+  while (durableLsn < lsn && failedLsn < lsn) {
+    if (flushing) {
+      flushed.wait(lock);
+      continue;
+    }
+    // 成为这一组的写盘者：把此刻排队的所有记录一起写入并只 fsync 一次
+    flushing = true;
+    std::vector<char> group;
+    group.swap(pending);
+    uint32_t groupLsn = nextLsn - 1;
+    lock.unlock();
+    bool ok = std::fwrite(group.data(), 1, group.size(), file) ==
+                  group.size() &&
+              std::fflush(file) == 0 && syncFile(file);
+    lock.lock();
+    flushing = false;
+    if (ok) {
+      durableLsn = groupLsn;
+      logBytes += group.size();
+    } else {
+      // 截掉写了一半的内容，避免后面的记录接在损坏的记录之后
+      std::cerr << "Failed to write log file " << logPath << std::endl;
+      failedLsn = groupLsn;
+      std::fclose(file);
+      std::error_code ec;
+      fs::resize_file(logPath, logBytes, ec);
+      file = std::fopen(logPath.string().c_str(), "ab");
+    }
+    flushed.notify_all();
+  }
+  return durableLsn >= lsn ? lsn : 0;
+}
+
+bool WriteAheadLog::commit(const Transaction &txn) {
+  if (txn.empty()) {
+    return true;
+  }
+  std::vector<char> payload;
+  encode(txn, payload);
+
+  bool ok = false;
+  size_t bytes = 0;
+  {
+    std::shared_lock<std::shared_mutex> guard(commitLock);
+    uint32_t lsn = append(payload);
+    if (lsn == 0) {
+      return false;
+    }
+    ok = apply(txn, lsn);
+    std::lock_guard<std::mutex> lock(mutex);
+    bytes = logBytes;
+  }
+  if (!ok) {
+    // 记录已经落盘，语句已经提交；页上只应用了一部分，不能当作回滚报告给调用方
+    std::cerr << "Failed to apply committed log record; aborting so that it "
+                 "is redone on the next start."
+              << std::endl;
+    std::abort();
+  }
+  if (bytes > checkpointBytes) {
+    checkpoint();
+  }
+  return true;
+}
+
+WriteAheadLog::TableLocks
+WriteAheadLog::lockTables(std::vector<std::string> tables) {
+  std::sort(tables.begin(), tables.end());
+  tables.erase(std::unique(tables.begin(), tables.end()), tables.end());
+  TableLocks locks;
+  for (const std::string &table : tables) {
+    std::mutex *writeLock;
+    {
+      std::lock_guard<std::mutex> lock(writeLocksMutex);
+      writeLock = &writeLocks[table];
+    }
+    locks.held.emplace_back(*writeLock);
+  }
+  return locks;
+}
+
+bool WriteAheadLog::apply(const Transaction &txn, uint32_t lsn) {
+  bool ok = true;
+  for (const auto &[table, changes] : txn.tables) {
+    // 正在在线改写的表：应用和捕获在同一把锁里，捕获的顺序就是修改落到页上的顺序
+    std::unique_lock<std::mutex> lock(captureMutex);
+    auto capture = captures.find(table);
+    if (capture == captures.end()) {
+      lock.unlock();
+      ok = applyTable(table, changes, lsn) && ok;
+      continue;
+    }
+    ok = applyTable(table, changes, lsn) && ok;
+    capture->second.push_back(changes);
+  }
+  return ok;
+}
+
+bool WriteAheadLog::applyTable(const std::string &table,
+                               const Transaction::TableChanges &changes,
+                               uint32_t lsn) {
+  HeapFile heap(dir / table / (table + ".trd"), changes.rowWidth);
+  if (!heap.open()) {
+    return false;
+  }
+  // 所有修改都直接落在行所在的页上（只弄脏这些页），页在检查点或被淘汰时写回。
+  // 日志已经先于页落盘，崩溃后按日志重做即可
+  for (const auto &[rid, row] : changes.inserts) {
+    if (!heap.placeRow(rid, row.data(), lsn)) {
+      return false;
+    }
+  }
+  for (const auto &[key, row] : changes.updates) {
+    if (!heap.updateRow(Transaction::rowIdOf(key), row.data(), lsn)) {
+      return false;
+    }
+  }
+  for (uint64_t key : changes.deletes) {
+    if (!heap.eraseRow(Transaction::rowIdOf(key), lsn)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool WriteAheadLog::checkpoint() {
+  std::unique_lock<std::shared_mutex> guard(commitLock);
+  std::lock_guard<std::mutex> lock(mutex);
+  return checkpointLocked(true);
+}
+
+bool WriteAheadLog::checkpointLocked(bool flushPages) {
+  if (logBytes <= sizeof(LogHeader)) {
+    return true; // 上次检查点之后没有新记录
+  }
+  if (flushPages && !BufferPool::instance().flushDirectory(dir)) {
+    return false;
+  }
+  std::error_code ec;
+  for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    if (it->is_regular_file(ec) && it->path() != logPath &&
+        !syncPath(it->path())) {
+      std::cerr << "Failed to sync " << it->path() << std::endl;
+      return false;
+    }
+  }
+  return resetLocked();
+}
+
+bool WriteAheadLog::replaceTableLocked(const fs::path &tempPath,
+                                       const fs::path &dataPath) {
+  // 新文件先完整落盘，再做检查点清空日志（日志里的行位置只对旧文件有效），最后 rename 换上
+  if (!BufferPool::instance().flushFile(tempPath) || !syncPath(tempPath) ||
+      !checkpointLocked(true)) {
+    return false;
+  }
+  return HeapFile::replace(tempPath, dataPath);
+}
+
+bool WriteAheadLog::resetLocked() {
+  if (file != nullptr) {
+    std::fclose(file);
+  }
+  file = std::fopen(logPath.string().c_str(), "wb");
+  if (file == nullptr) {
+    std::cerr << "Failed to open log file " << logPath << std::endl;
+    return false;
+  }
+  LogHeader header{LOG_MAGIC, LOG_VERSION, nextLsn, 0};
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fflush(file) == 0 && syncFile(file);
+  logBytes = sizeof(header);
+  durableLsn = nextLsn - 1;
+  return ok;
+}
@@ -0,0 +1,242 @@
+#include "Entity/storage/ZoneMap.h"
+#include "Entity/storage/HeapFile.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr uint32_t ZONE_MAGIC = 0x315A4D54; // "TZM1"
+
+struct ZoneHeader {
+  uint32_t magic;
+  uint32_t columnCount;
+};
+
+template <typename T> T load(const ZoneMap::Column &column, const char *row) {
+  T value = 0;
+  std::memcpy(&value, row + column.offset,
+              std::min<size_t>(sizeof(value), column.width));
+  return value;
+}
+
+template <typename T> void store(char *slot, T value) {
+  std::memcpy(slot, &value, sizeof(value));
+}
+
+template <typename T> T fetch(const char *slot) {
+  T value;
+  std::memcpy(&value, slot, sizeof(value));
+  return value;
+}
+} // namespace
+
+ZoneMap::ZoneMap(fs::path path) : filePath(std::move(path)) {}
+
+fs::path ZoneMap::pathFor(const fs::path &dataPath) {
+  fs::path path = dataPath;
+  path.replace_extension(".tzm");
+  return path;
+}
+
+void ZoneMap::remove(const fs::path &dataPath) {
+  fs::path path = pathFor(dataPath);
+  BufferPool::instance().dropFile(path);
+  std::error_code ec;
+  fs::remove(path, ec);
+}
+
+bool ZoneMap::open() {
+  BufferPool &pool = BufferPool::instance();
+  if (pool.pageCount(filePath) == 0) {
+    return false;
+  }
+  BufferPool::PageGuard page = pool.fetchPage(filePath, 0);
+  if (!page) {
+    return false;
+  }
+  ZoneHeader header{};
+  std::memcpy(&header, page.data(), sizeof(header));
+  if (header.magic != ZONE_MAGIC || header.columnCount == 0 ||
+      header.columnCount > MAX_COLUMNS) {
+    return false;
+  }
+  std::vector<Column> columns(header.columnCount);
+  std::memcpy(columns.data(), page.data() + sizeof(header),
+              columns.size() * sizeof(Column));
+  setLayout(std::move(columns));
+  return true;
+}
+
+bool ZoneMap::build(const HeapFile &heap, std::vector<Column> columns) {
+  if (columns.empty()) {
+    return false;
+  }
+  if (columns.size() > MAX_COLUMNS) {
+    columns.resize(MAX_COLUMNS);
+  }
+  setLayout(std::move(columns));
+
+  BufferPool &pool = BufferPool::instance();
+  fs::path tempPath = filePath;
+  tempPath += ".tmp";
+  pool.dropFile(tempPath);
+  {
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+  }
+
+  bool ok = true;
+  {
+    BufferPool::PageGuard page = pool.appendPage(tempPath);
+    ok = static_cast<bool>(page);
+    if (ok) {
+      ZoneHeader header{ZONE_MAGIC, static_cast<uint32_t>(tracked.size())};
+      std::memcpy(page.data(), &header, sizeof(header));
+      std::memcpy(page.data() + sizeof(header), tracked.data(),
+                  tracked.size() * sizeof(Column));
+      page.markDirty();
+    }
+
+    // 建立期间之前打开的数据文件对象还可能往最后一页追加行，最后一页的范围留作未知
+    uint32_t pages = heap.pageCount();
+    for (uint32_t pageNo = 0; ok && pageNo + 1 < pages; ++pageNo) {
+      if (pageNo % entriesPerPage == 0) {
+        page = pool.appendPage(tempPath);
+        if (!page) {
+          ok = false;
+          break;
+        }
+        page.markDirty();
+      }
+      char *entry =
+          page.data() + static_cast<size_t>(pageNo % entriesPerPage) * entryWidth;
+      reset(entry, nullptr);
+      HeapFile::PageView view = heap.readPage(pageNo);
+      if (!view) {
+        ok = false;
+        break;
+      }
+      uint32_t rowCount =
+          view.header()->magic == PAGE_MAGIC ? view.header()->rowCount : 0;
+      const char *row = view.rows();
+      for (uint32_t slot = 0; slot < rowCount; ++slot, row += heap.rowWidth()) {
+        if (!isDeleted(view.data(), heap.rowsPerPage(), slot)) {
+          widen(entry, row);
+        }
+      }
+    }
+  }
+
+  std::error_code ec;
+  if (ok && pool.flushFile(tempPath)) {
+    pool.dropFile(tempPath);
+    pool.dropFile(filePath);
+    fs::rename(tempPath, filePath, ec);
+    if (!ec) {
+      return true;
+    }
+  }
+  pool.dropFile(tempPath);
+  fs::remove(tempPath, ec);
+  return false;
+}
+
+void ZoneMap::note(uint32_t pageNo, const char *row, bool freshPage) {
+  if (tracked.empty()) {
+    return;
+  }
+  BufferPool &pool = BufferPool::instance();
+  uint32_t zonePage = 1 + pageNo / entriesPerPage;
+  // 新分配的 .tzm 页全 0，其中各项的范围都是未知
+  while (pool.pageCount(filePath) <= zonePage) {
+    if (!pool.appendPage(filePath)) {
+      return;
+    }
+  }
+  BufferPool::PageGuard page = pool.fetchPage(filePath, zonePage);
+  if (!page) {
+    return;
+  }
+  char *entry =
+      page.data() + static_cast<size_t>(pageNo % entriesPerPage) * entryWidth;
+  if (freshPage) {
+    reset(entry, row);
+  } else if (entry[0] != 0) {
+    widen(entry, row);
+  } else {
+    return;
+  }
+  page.markDirty();
+}
+
+int ZoneMap::find(int offset, int width, bool isFloat) const {
+  for (size_t k = 0; k < tracked.size(); ++k) {
+    if (tracked[k].offset == offset && tracked[k].width == width &&
+        (tracked[k].isFloat != 0) == isFloat) {
+      return static_cast<int>(k);
+    }
+  }
+  return -1;
+}
+
+void ZoneMap::setLayout(std::vector<Column> columns) {
+  tracked = std::move(columns);
+  entryWidth =
+      static_cast<uint32_t>(sizeof(uint32_t) + tracked.size() * 2 * 4);
+  entriesPerPage = PAGE_SIZE / entryWidth;
+}
+
+void ZoneMap::reset(char *entry, const char *row) const {
+  // 没有行时最小值取最大、最大值取最小，任何条件都不相交
+  store<uint32_t>(entry, 1);
+  char *slot = entry + sizeof(uint32_t);
+  for (const Column &column : tracked) {
+    if (column.isFloat) {
+      float low = std::numeric_limits<float>::infinity();
+      float high = -low;
+      float value = row != nullptr ? load<float>(column, row) : 0;
+      if (row != nullptr && value == value) { // NaN 不满足可以跳页的比较，不计入范围
+        low = high = value;
+      }
+      store(slot, low);
+      store(slot + 4, high);
+    } else {
+      int32_t low = std::numeric_limits<int32_t>::max();
+      int32_t high = std::numeric_limits<int32_t>::min();
+      if (row != nullptr) {
+        low = high = load<int32_t>(column, row);
+      }
+      store(slot, low);
+      store(slot + 4, high);
+    }
+    slot += 8;
+  }
+}
+
+void ZoneMap::widen(char *entry, const char *row) const {
+  char *slot = entry + sizeof(uint32_t);
+  for (const Column &column : tracked) {
+    if (column.isFloat) {
+      float value = load<float>(column, row);
+      if (value < fetch<float>(slot)) {
+        store(slot, value);
+      }
+      if (value > fetch<float>(slot + 4)) {
+        store(slot + 4, value);
+      }
+    } else {
+      int32_t value = load<int32_t>(column, row);
+      if (value < fetch<int32_t>(slot)) {
+        store(slot, value);
+      }
+      if (value > fetch<int32_t>(slot + 4)) {
+        store(slot + 4, value);
+      }
+    }
+    slot += 8;
+  }
+}
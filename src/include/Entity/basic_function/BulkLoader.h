@@ -0,0 +1,113 @@
+#ifndef BULK_LOADER_H
+#define BULK_LOADER_H
+
+#include "Entity/basic_function/RowLayout.h"
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * LOAD DATA 式的批量导入
+ *
+ * 顺序流式读取输入文件并切成若干块（CSV 只在引号之外的换行处切），多个线程并行地把每一块
+ * 解析、编码成 .trd 的定长行格式并做逐行校验，编码好的行按文件顺序交给 sink 追加到数据文件。
+ * 支持两种输入：
+ *   - CSV：字段按表的列顺序排列，支持双引号转义；空字段按 insertRecord 的规则处理（NULL 或默认值）；
+ *   - Binary：与 .trd 行格式相同的定长行首尾相接（无页头），只做校验不做转换。
+ * 不合法的行被跳过并计数，前若干条错误会带行号输出。
+ */
+class BulkLoader {
+public:
+    enum class Format {
+        Csv,
+        Binary
+    };
+
+    struct Options {
+        Format format = Format::Csv;
+        char delimiter = ',';
+        bool skipHeader = false;
+        unsigned threads = 0;             // 0 表示使用 hardware_concurrency
+        size_t chunkBytes = 4u << 20;     // 每块的大小
+        size_t maxReportedErrors = 10;    // 最多输出多少条错误
+    };
+
+    struct Stats {
+        size_t rows = 0;      // 成功写入的行数
+        size_t rejected = 0;  // 被拒绝的行数
+        size_t bytes = 0;     // 读取的字节数
+        double seconds = 0;
+        double rowsPerSecond() const { return seconds > 0 ? rows / seconds : 0; }
+    };
+
+    /**
+     * 一批按文件顺序排列、已经编码好的行
+     */
+    struct Batch {
+        const char* rows;
+        const size_t* lines; // 每一行在输入文件中的行号（Binary 为记录序号），用于错误信息
+        size_t count;
+        size_t rejected = 0; // sink 拒绝的行数（如主键重复）
+    };
+
+    /**
+     * 逐行校验（在工作线程中调用，必须是线程安全的），不合法时返回 false 并写入 error
+     */
+    using Validator = std::function<bool(const char* row, std::string& error)>;
+    /**
+     * 接收编码好的行（在调用 load 的线程中按顺序调用），返回 false 时终止导入
+     */
+    using Sink = std::function<bool(Batch& batch)>;
+
+    BulkLoader(std::shared_ptr<const RowLayout> layout, Options options);
+    void setValidator(Validator validator) { validate = std::move(validator); }
+    /**
+     * 导入一个文件
+     *
+     * @param input 输入文件路径
+     * @param sink 行接收者
+     * @param stats 导入统计
+     * @return 输入文件无法读取或 sink 终止时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool load(const std::filesystem::path& input, const Sink& sink, Stats& stats);
+    /**
+     * 记录一条被拒绝的行，前 maxReportedErrors 条输出到 std::cerr
+     *
+     * @param line 行号
+     * @param message 错误信息
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void reject(size_t line, const std::string& message);
+
+private:
+    struct Chunk {
+        std::string data;
+        size_t firstLine;
+    };
+
+    struct Parsed {
+        std::vector<char> rows;
+        std::vector<size_t> lines;
+        std::vector<std::pair<size_t, std::string>> errors;
+    };
+
+    Parsed parseCsv(const Chunk& chunk, bool skipFirst) const;
+    Parsed parseBinary(const Chunk& chunk) const;
+    bool encodeCsvRecord(const std::vector<std::string>& fields, char* row, std::string& error) const;
+
+    std::shared_ptr<const RowLayout> layout;
+    Options options;
+    Validator validate;
+    size_t reported = 0;
+    size_t rejectedRows = 0;
+};
+
+#endif // BULK_LOADER_H
@@ -0,0 +1,147 @@
+#ifndef ROW_LAYOUT_H
+#define ROW_LAYOUT_H
+
+#include "Table.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * 编译后的行格式
+ *
+ * 按表结构预先算好每个字段在定长行中的偏移、宽度和类型标签，同一版本的表结构只构建一次
+ * （由 SchemaCatalog 缓存）。逐行处理时只通过列下标访问原始行缓冲区，不做字符串比较、
+ * map 查找，也不构造 std::string。
+ */
+class RowLayout {
+public:
+    enum class ColumnType : uint8_t {
+        Integer,
+        Str,
+        Number,
+        Bool,
+        Unknown
+    };
+
+    struct Field {
+        int offset;
+        int width;
+        ColumnType type;
+    };
+
+    explicit RowLayout(std::shared_ptr<const Table> table);
+    /**
+     * 把 .tdf 里的类型名转换为类型标签
+     *
+     * @param type 字段类型名
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static ColumnType parseType(const std::string& type);
+
+    const Table& table() const { return *schema; }
+    const std::shared_ptr<const Table>& tablePtr() const { return schema; }
+    int rowWidth() const { return width; }
+    int columnCount() const { return static_cast<int>(fields.size()); }
+    const Field& field(int col) const { return fields[col]; }
+    ColumnType type(int col) const { return fields[col].type; }
+    bool isNumeric(int col) const { return fields[col].type == ColumnType::Integer || fields[col].type == ColumnType::Number; }
+    /**
+     * 按字段名查找列下标，只在语句开始时调用一次
+     *
+     * @param name 字段名
+     * @return 列下标；不存在时返回 -1
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    int columnIndex(const std::string& name) const;
+
+    int32_t getInt(const char* row, int col) const {
+        int32_t value = 0;
+        std::memcpy(&value, row + fields[col].offset, std::min<int>(sizeof(value), fields[col].width));
+        return value;
+    }
+    float getNumber(const char* row, int col) const {
+        float value = 0;
+        std::memcpy(&value, row + fields[col].offset, std::min<int>(sizeof(value), fields[col].width));
+        return value;
+    }
+    bool getBool(const char* row, int col) const { return row[fields[col].offset] != 0; }
+    /**
+     * 读取字符串字段，去掉末尾的 '\0' 填充，返回指向行缓冲区的视图
+     */
+    std::string_view getStr(const char* row, int col) const {
+        const char* begin = row + fields[col].offset;
+        return std::string_view(begin, strnlen(begin, fields[col].width));
+    }
+    /**
+     * 按数值读取 integer / number 字段，用于跨类型比较
+     */
+    double getDouble(const char* row, int col) const {
+        return fields[col].type == ColumnType::Number ? getNumber(row, col) : getInt(row, col);
+    }
+
+    void setInt(char* row, int col, int32_t value) const {
+        std::memset(row + fields[col].offset, 0, fields[col].width);
+        std::memcpy(row + fields[col].offset, &value, std::min<int>(sizeof(value), fields[col].width));
+    }
+    void setNumber(char* row, int col, float value) const {
+        std::memset(row + fields[col].offset, 0, fields[col].width);
+        std::memcpy(row + fields[col].offset, &value, std::min<int>(sizeof(value), fields[col].width));
+    }
+    void setBool(char* row, int col, bool value) const {
+        std::memset(row + fields[col].offset, 0, fields[col].width);
+        row[fields[col].offset] = value ? 1 : 0;
+    }
+    void setStr(char* row, int col, std::string_view value) const {
+        size_t n = std::min<size_t>(value.size(), fields[col].width);
+        std::memcpy(row + fields[col].offset, value.data(), n);
+        std::memset(row + fields[col].offset + n, 0, fields[col].width - n);
+    }
+    /**
+     * 把文本值按字段类型编码进行缓冲区，空串编码为全 0（NULL）
+     *
+     * @param row 行缓冲区
+     * @param col 列下标
+     * @param text 文本值
+     * @return 文本无法转换为字段类型时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool encodeField(char* row, int col, const std::string& text) const;
+    /**
+     * 把字段转换为文本（integer/number 使用 std::to_string 的格式）
+     *
+     * @param row 行缓冲区
+     * @param col 列下标
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    std::string toString(const char* row, int col) const;
+    /**
+     * 把字段直接输出到流，不经过中间字符串
+     *
+     * @param os 输出流
+     * @param row 行缓冲区
+     * @param col 列下标
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void print(std::ostream& os, const char* row, int col) const;
+
+private:
+    std::shared_ptr<const Table> schema;
+    std::vector<Field> fields;
+    int width = 0;
+};
+
+#endif // ROW_LAYOUT_H
@@ -0,0 +1,95 @@
+#ifndef SCHEMA_CATALOG_H
+#define SCHEMA_CATALOG_H
+
+#include "Table.h"
+#include "RowLayout.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * 进程内的表结构缓存
+ *
+ * 每张表的 .tdf 只在第一次使用时读取一次，之后以只读快照（shared_ptr<const Table>）
+ * 分发给各个语句。ALTER / RENAME / DROP 等会改写 .tdf 的路径必须调用 invalidate，
+ * 下一次访问会重新读盘并得到新的版本号。
+ */
+class SchemaCatalog {
+public:
+    /**
+     * 获取全局唯一的表结构缓存
+     *
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static SchemaCatalog& instance();
+    /**
+     * 获取表结构快照，缓存未命中时从 .tdf 读取
+     *
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @return 表结构快照；表不存在或文件损坏时返回 nullptr
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    std::shared_ptr<const Table> getSchema(const std::string& dbName, const std::string& tableName);
+    /**
+     * 获取与当前表结构版本对应的行格式，和表结构一起加载、一起失效
+     *
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @return 行格式；表不存在或文件损坏时返回 nullptr
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    std::shared_ptr<const RowLayout> getLayout(const std::string& dbName, const std::string& tableName);
+    /**
+     * 获取表结构的当前版本号，每次 invalidate 后递增
+     *
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    uint64_t version(const std::string& dbName, const std::string& tableName);
+    /**
+     * 使某张表的缓存失效（.tdf 被改写、表被删除或重命名后调用）
+     *
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void invalidate(const std::string& dbName, const std::string& tableName);
+    /**
+     * 使某个数据库下所有表的缓存失效
+     *
+     * @param dbName 数据库名称
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void invalidateDatabase(const std::string& dbName);
+
+private:
+    struct Entry {
+        std::shared_ptr<const RowLayout> layout;
+        uint64_t version = 0;
+    };
+
+    SchemaCatalog() = default;
+    static std::string makeKey(const std::string& dbName, const std::string& tableName);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<std::string, uint64_t> versions; // 失效后保留版本号，保证单调递增
+};
+
+#endif // SCHEMA_CATALOG_H
@@ -71,6 +71,16 @@ public:
  * @author 
  */
     void writeToDisk(std::ofstream& outFile) const;
+/**
+ * ȡͷ
+ *
+ * @param inFile ļ
+ * @return ȡɹ trueļ𻵻򱻽ضϷ false
+ * @throws None
+ *
+ * @author 
+ */
+    bool readFromDisk(std::ifstream& inFile);
 /**
  * һ
  *
@@ -2,6 +2,21 @@
 #define TABLE_MANAGER_H
 
 #include "Table.h"
+#include "SchemaCatalog.h"
+#include "RowLayout.h"
+#include "Entity/storage/HeapFile.h"
+#include "Entity/storage/WriteAheadLog.h"
+#include "Entity/storage/TableRewriter.h"
+#include "Entity/index/TableIndex.h"
+#include "Entity/execution/Aggregator.h"
+#include "Entity/execution/ExternalSorter.h"
+#include "Entity/execution/GroupByOperator.h"
+#include "Entity/execution/JoinOperator.h"
+#include "Entity/execution/ParallelScan.h"
+#include "Entity/execution/Predicate.h"
+#include "Entity/execution/ResultSet.h"
+#include "Entity/execution/RowSources.h"
+#include "BulkLoader.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -12,15 +27,30 @@
 #include <map>
 #include <istream>
 #include <set>
+#include <unordered_set>
 #include <iomanip>
+#include <memory>
+#include <thread>
 
 namespace fs = std::filesystem;
 
 class TableManager {
 private:
     std::string currentDatabase; // 存储当前数据库名称
+    size_t parallelism;          // 全表扫描的并行度（会话设置）
+    bool mappedReads = false;    // 只读查询是否映射数据文件（会话设置）
 
 public:
+    static constexpr size_t NO_LIMIT = ExternalSorter::NO_LIMIT; // 不限制输出行数
+
+    /**
+     * 重做各数据库日志中尚未写入数据文件的修改，并重建受影响的表的索引
+     *
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    TableManager();
     /**
      * 创建数据表
      *
@@ -58,6 +88,26 @@ public:
      * @author 韩玉龙
      */
     bool loadTableSchema(const std::string& dbName, const std::string& tableName, Table& table);
+    /**
+     * 获取表结构只读快照（走 SchemaCatalog 缓存，不重复读 .tdf）
+     *
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @return 表结构快照；读取失败时返回 nullptr
+     *
+     * @author 韩玉龙
+     */
+    std::shared_ptr<const Table> getTableSchema(const std::string& dbName, const std::string& tableName);
+    /**
+     * 获取表的行格式（字段偏移、宽度、类型标签），与表结构快照同一版本
+     *
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @return 行格式；读取失败时返回 nullptr
+     *
+     * @author 韩玉龙
+     */
+    std::shared_ptr<const RowLayout> getRowLayout(const std::string& dbName, const std::string& tableName);
     /**
      * 插入数据表
      *
@@ -69,6 +119,33 @@ public:
      * @author 韩玉龙
      */
     void insertRecord(const std::string& dbName, const std::string& tableName, const std::vector<std::string>& recordData);
+    /**
+     * 批量插入多行：表结构只解析一次，每个外键只扫描一次引用表建立探测集合，
+     * 全部行编码进一块连续缓冲区后一次性追加；任何一行不合法时整批都不插入
+     *
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @param records 插入数据，每个元素是一行
+     * @return 全部插入成功时返回 true
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool insertRecords(const std::string& dbName, const std::string& tableName, const std::vector<std::vector<std::string>>& records);
+    /**
+     * 从文件批量导入数据（LOAD DATA）：流式读取、多线程并行解析和校验，按文件顺序追加到数据文件。
+     * 与 insertRecords 不同，不合法的行（字段错误、外键不存在、主键重复）只被跳过并计数，不影响其余行
+     *
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @param filePath 输入文件路径
+     * @param options 输入格式、分隔符、线程数等
+     * @return 输入文件无法读取或写入失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool loadData(const std::string& dbName, const std::string& tableName, const std::string& filePath, const BulkLoader::Options& options = {});
     /**
      * 读取整表
      *
@@ -79,6 +156,17 @@ public:
      * @author 韩玉龙
      */
     void readTableData(const std::string& dbName, const std::string& tableName);
+    /**
+     * 查询整张表，返回按批拉取的结果集（readTableData 即打印它）
+     *
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @return 读取表结构或打开数据文件失败时返回 nullptr
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    std::unique_ptr<ResultSet> queryTable(const std::string& dbName, const std::string& tableName);
     /**
      * 自定义读取表
      *
@@ -88,6 +176,8 @@ public:
      * @param conditionColumn 条件字段
      * @param operation 比较符
      * @param conditionValue 比较值
+     * @param limit 最多输出的行数（LIMIT），输出够之后不再读数据文件
+     * @param offset 跳过的行数（OFFSET）
      * @throws None
      *
      * @author 韩玉龙
@@ -96,43 +186,84 @@ public:
                      const std::vector<std::string>& fieldNames,
                      const std::vector<std::string>& conditionColumn,
                      const std::vector<std::string>& operation,
-                     const std::vector<std::string>& conditionValue);
+                     const std::vector<std::string>& conditionValue,
+                     size_t limit = NO_LIMIT, size_t offset = 0);
     /**
-     * 自定义删除表
+     * 条件查询，返回按批拉取的结果集（readRecords 即打印它），参数同 readRecords
+     *
+     * @return 读取表结构、打开数据文件或解析条件失败时返回 nullptr
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    std::unique_ptr<ResultSet> queryRecords(const std::string& dbName, const std::string& tableName,
+                                            const std::vector<std::string>& fieldNames,
+                                            const std::vector<std::string>& conditionColumn,
+                                            const std::vector<std::string>& operation,
+                                            const std::vector<std::string>& conditionValue,
+                                            size_t limit = NO_LIMIT, size_t offset = 0);
+    /**
+     * 聚合查询：扫描时按类型直接累加，满足条件的行才参与，结果输出为一行
      *
      * @param dbName 数据库名称
      * @param tableName 表名称
+     * @param functions 聚合函数名（COUNT / SUM / AVG / MIN / MAX）
+     * @param columns 与 functions 一一对应的字段名，COUNT 可以用 "*"
      * @param conditionColumn 条件字段
      * @param operation 比较符
      * @param conditionValue 比较值
+     * @param results 可选，按顺序返回各个聚合的结果
+     * @return 表、函数或字段不合法时输出错误并返回 false
      * @throws None
      *
      * @author 韩玉龙
      */
-    void deleteRecords(const std::string& dbName, const std::string& tableName,
-                       const std::vector<std::string>& conditionColumn,
-                       const std::vector<std::string>& operation,
-                       const std::vector<std::string>& conditionValue);
+    bool aggregateRecords(const std::string& dbName, const std::string& tableName,
+                          const std::vector<std::string>& functions,
+                          const std::vector<std::string>& columns,
+                          const std::vector<std::string>& conditionColumn,
+                          const std::vector<std::string>& operation,
+                          const std::vector<std::string>& conditionValue,
+                          std::vector<Aggregator::Value>* results = nullptr);
     /**
-     * 条件判断
+     * 分组聚合（GROUP BY）：每个分组输出一行，先是分组列，再是各个聚合
      *
-     * @param fieldValue 被比较的字段
-     * @param op 比较符
-     * @param value 被比较的值
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @param groupColumns 分组字段
+     * @param functions 聚合函数名（COUNT / SUM / AVG / MIN / MAX）
+     * @param columns 与 functions 一一对应的字段名，COUNT 可以用 "*"
+     * @param conditionColumn 条件字段
+     * @param operation 比较符
+     * @param conditionValue 比较值
+     * @return 表、分组字段、函数或字段不合法时输出错误并返回 false
      * @throws None
      *
      * @author 韩玉龙
      */
-    bool checkCondition(const std::string& fieldValue, const std::string& op, const std::string& value);
+    bool groupByRecords(const std::string& dbName, const std::string& tableName,
+                        const std::vector<std::string>& groupColumns,
+                        const std::vector<std::string>& functions,
+                        const std::vector<std::string>& columns,
+                        const std::vector<std::string>& conditionColumn,
+                        const std::vector<std::string>& operation,
+                        const std::vector<std::string>& conditionValue);
     /**
-     * 判断是否为浮点数
+     * 自定义删除表
      *
-     * @param fieldValue 被比较的字符串
+     * @param dbName 数据库名称
+     * @param tableName 表名称
+     * @param conditionColumn 条件字段
+     * @param operation 比较符
+     * @param conditionValue 比较值
      * @throws None
      *
      * @author 韩玉龙
      */
-    bool isNumber(const std::string& str);
+    void deleteRecords(const std::string& dbName, const std::string& tableName,
+                       const std::vector<std::string>& conditionColumn,
+                       const std::vector<std::string>& operation,
+                       const std::vector<std::string>& conditionValue);
     /**
      * 自定义更新表
      *
@@ -156,11 +287,23 @@ public:
      * @param sortColumn 排序字段
      * @param orders 顺序
      * @param fieldNames 搜索字段
+     * @param limit 最多输出的行数（LIMIT），指定时只在内存中保留前 offset + limit 行
+     * @param offset 跳过的行数（OFFSET）
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void orderByRecord(const std::string& dbName, const std::string& tableName, const std::vector<std::string>& sortColumn, const std::vector<std::string>& orders, const std::vector<std::string>& fieldNames, size_t limit = NO_LIMIT, size_t offset = 0);
+    /**
+     * 排序查询，返回按批拉取的结果集（orderByRecord 即打印它），参数同 orderByRecord。
+     * 返回前已经读完整张表并排好序
+     *
+     * @return 读取表结构、打开数据文件或读写排序临时文件失败时返回 nullptr
      * @throws None
      *
      * @author 韩玉龙
      */
-    void orderByRecord(const std::string& dbName, const std::string& tableName, const std::vector<std::string>& sortColumn, const std::vector<std::string>& orders, const std::vector<std::string>& fieldNames);
+    std::unique_ptr<ResultSet> queryOrdered(const std::string& dbName, const std::string& tableName, const std::vector<std::string>& sortColumn, const std::vector<std::string>& orders, const std::vector<std::string>& fieldNames, size_t limit = NO_LIMIT, size_t offset = 0);
     /**
      * 顺序返回读取表数据
      *
@@ -244,6 +387,27 @@ public:
      * @author 韩玉龙
      */
     std::string selectDatabase() const;
+    /**
+     * 设置本会话全表扫描（条件查询、读取列）的并行度
+     *
+     * @param degree 最多同时扫描的线程数，0 表示使用 CPU 核数，1 表示串行扫描
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void setParallelism(size_t degree);
+    size_t getParallelism() const { return parallelism; }
+    /**
+     * 设置本会话的只读查询（查询表、条件查询、排序、连接、聚合、分组、读取列）是否通过内存映射
+     * 读取数据文件，默认关闭。打开后不要在持有结果集的同时清空（TRUNCATE）同一张表
+     *
+     * @param enabled 是否映射
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void setMappedReads(bool enabled) { mappedReads = enabled; }
+    bool getMappedReads() const { return mappedReads; }
     /**
      * 显示当前数据库下的所有表名
      *
@@ -290,6 +454,58 @@ public:
      * @author 韩玉龙
      */
     void truncateTable(const std::string& dbName, const std::string& tableName);
+    /**
+     * 整理表：在线把存活的行重新紧密排列，回收已删除的行占用的空间，并重建主键索引。
+     * 删除后墓碑超过一半时自动调用
+     *
+     * @param dbName 数据库名
+     * @param tableName 表名
+     * @return 改写数据文件失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool compactTable(const std::string& dbName, const std::string& tableName);
+    /**
+     * OPTIMIZE TABLE：在线、限速地改写表，回收已删除的行并按主键顺序重新排列（没有主键时保持物理顺序）。
+     * 改写期间读照常进行，写只在复制每一批和最后换文件时短暂暂停
+     *
+     * @param dbName 数据库名
+     * @param tableName 表名
+     * @param options 限速和分批参数
+     * @return 改写失败时返回 false（原数据文件保持不变）
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool optimizeTable(const std::string& dbName, const std::string& tableName, const TableRewriter::Options& options = {});
+    /**
+     * CREATE INDEX：在表的一列或多列上建立 B+ 树索引，保存在 <table>.<index>.tid 中。
+     * 之后的插入、更新、删除同步维护它，条件落在索引键的前缀上时查询、更新和删除走索引
+     *
+     * @param dbName 数据库名
+     * @param tableName 表名
+     * @param indexName 索引名，不能与列名或已有的索引名相同
+     * @param columns 索引列，按键中的顺序排列
+     * @param include INCLUDE 的列：只存进索引项，查询要的列都在索引里时直接从索引返回，不读数据文件
+     * @return 参数不合法或建立索引失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool createIndex(const std::string& dbName, const std::string& tableName, const std::string& indexName, const std::vector<std::string>& columns, const std::vector<std::string>& include = {});
+    /**
+     * DROP INDEX：删除 createIndex 建立的索引
+     *
+     * @param dbName 数据库名
+     * @param tableName 表名
+     * @param indexName 索引名
+     * @return 索引不存在或写入索引定义失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool dropIndex(const std::string& dbName, const std::string& tableName, const std::string& indexName);
     /**
      * 多表查询
      *
@@ -304,14 +520,23 @@ public:
      * @author 韩玉龙
      */
     void innerJoin(const std::string& dbName, const std::string& table1, const std::string& table2, const std::string& column1, const std::string& column2, const std::vector<std::string>& selectColumns);
+    /**
+     * 内连接查询，返回按批拉取的结果集（innerJoin 即打印它），参数同 innerJoin。
+     * 返回前已经执行完连接，结果行暂存在内存中
+     *
+     * @return 读取表结构、打开或读取数据文件失败时返回 nullptr
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    std::unique_ptr<ResultSet> queryJoin(const std::string& dbName, const std::string& table1, const std::string& table2, const std::string& column1, const std::string& column2, const std::vector<std::string>& selectColumns);
 
     void alter_addForeignKey(const std::string& dbName, const std::string& tableName, const std::string& columnName, const std::string& referenceTable, const std::string& referenceColumn, Table::ForeignKeyAction onDelete, Table::ForeignKeyAction onUpdate);
 
     void alter_deleteForeignKey(const std::string& dbName, const std::string& tableName, const std::string& columnName);
 
-    bool handleForeignKeyAction(const std::string& dbName, const Table& table, const std::string& columnName, const std::string& value, Table::ForeignKeyAction action);
     /**
-     * 检查引用的表中是否存在对应的外键值
+     * 检查引用的表中是否存在对应的外键值，在被引用列的索引上查一次，不扫描数据文件
      *
      * @param dbName 数据库名
      * @param referenceTable 对应表
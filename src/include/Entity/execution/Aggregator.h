@@ -0,0 +1,145 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include "Entity/basic_function/RowLayout.h"
+#include "Entity/storage/HeapFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * 类型化的聚合（COUNT / SUM / AVG / MIN / MAX）
+ *
+ * 扫描时直接从行缓冲区读出 integer / number 字段累加：integer 用 int64 累加，不会溢出；
+ * number 用 double 累加。累加状态与线程（或分组）一一对应，各自累加后再合并，
+ * 所以可以和 WHERE 谓词的批量筛选、并行扫描组合使用。
+ * 与原来的 AggregationFunctions 一致，数值列上全 0 的字段按 0 计入；str 列的 COUNT 只统计非空串。
+ * 没有任何值参与时 SUM / AVG / MIN / MAX 的结果为 NULL。
+ */
+class Aggregator {
+public:
+    enum class Function : uint8_t {
+        Count,
+        Sum,
+        Avg,
+        Min,
+        Max
+    };
+
+    /**
+     * 一个聚合的累加状态
+     */
+    struct State {
+        int64_t count = 0;
+        int64_t intSum = 0;
+        double doubleSum = 0;
+        int64_t intMin = std::numeric_limits<int64_t>::max();
+        int64_t intMax = std::numeric_limits<int64_t>::min();
+        double doubleMin = std::numeric_limits<double>::infinity();
+        double doubleMax = -std::numeric_limits<double>::infinity();
+    };
+
+    /**
+     * 聚合结果：integer 列的 COUNT / SUM / MIN / MAX 是整数，其余是浮点数
+     */
+    struct Value {
+        bool isNull = true;
+        bool isInteger = false;
+        int64_t intValue = 0;
+        double doubleValue = 0;
+    };
+
+    /**
+     * 解析聚合函数名（不区分大小写）
+     *
+     * @param name 函数名，如 "SUM"
+     * @param function 解析结果
+     * @return 不认识的函数名返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static bool parseFunction(const std::string& name, Function& function);
+    /**
+     * 添加一个聚合
+     *
+     * @param layout 行格式
+     * @param function 聚合函数
+     * @param columnName 字段名，COUNT 可以用 "*"
+     * @return 字段不存在或类型不支持该函数时输出错误并返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool add(const RowLayout& layout, Function function, const std::string& columnName);
+    /**
+     * 把一批行中被选中的行累加到 states（与 add 的顺序一一对应）
+     *
+     * @param batch 一批行
+     * @param selection 被选中的行号
+     * @param selected 被选中的行数
+     * @param states 累加状态，长度为 size()
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void accumulate(const HeapFile::Batch& batch, const uint16_t* selection, uint32_t selected, State* states) const;
+    /**
+     * 累加一行
+     *
+     * @param row 行缓冲区
+     * @param states 累加状态，长度为 size()
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void accumulate(const char* row, State* states) const;
+    /**
+     * 把 from 合并进 into（并行扫描结束后合并各线程的部分结果）
+     *
+     * @param into 目标状态，长度为 size()
+     * @param from 来源状态，长度为 size()
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void merge(State* into, const State* from) const;
+    /**
+     * 计算第 i 个聚合的结果
+     *
+     * @param i 聚合下标
+     * @param state 该聚合的累加状态
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    Value result(size_t i, const State& state) const;
+    /**
+     * 输出聚合结果，NULL 输出为 "NULL"
+     *
+     * @param os 输出流
+     * @param value 聚合结果
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void print(std::ostream& os, const Value& value);
+
+    size_t size() const { return terms.size(); }
+
+private:
+    struct Term {
+        Function function;
+        int column; // COUNT(*) 为 -1
+        int offset;
+        int width;
+        RowLayout::ColumnType type;
+    };
+
+    std::vector<Term> terms;
+};
+
+#endif // AGGREGATOR_H
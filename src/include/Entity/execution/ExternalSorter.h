@@ -0,0 +1,138 @@
+#ifndef EXTERNAL_SORTER_H
+#define EXTERNAL_SORTER_H
+
+#include "Entity/basic_function/RowLayout.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <vector>
+
+/**
+ * 外部归并排序（ORDER BY）
+ *
+ * 每一行只保留需要的列（排序列和输出列）拼成定长的记录。内存中的记录超过预算时按排序键排好，
+ * 作为一个有序段（run）以二进制写到临时文件，最后对所有段做多路归并；段太多时先分批归并。
+ * 排序键按列的类型比较：integer / number 按数值（NaN 排在最后），str 按字节序，bool 按 false < true。
+ * 排序是稳定的：键相同的行保持加入时的顺序。结果由调用方按需分批读出（最后一轮归并随读随做）。
+ *
+ * 指定 limit 且 limit 行能放进内存预算时按 Top-N 执行：只在一个大顶堆中保留当前最靠前的 limit 行，
+ * 新行不比堆顶靠前时直接丢弃，不会写临时文件；否则照常外部排序，只输出前 limit 行。
+ */
+class ExternalSorter {
+public:
+    struct Key {
+        int column;
+        bool ascending;
+    };
+
+    static constexpr size_t NO_LIMIT = std::numeric_limits<size_t>::max();
+
+    /**
+     * @param layout 行格式
+     * @param keys 排序键，按优先级排列
+     * @param carried 需要随记录带出的列（排序列会自动带上）
+     * @param tempPrefix 临时文件路径前缀，有序段写到 <tempPrefix>.S<n>.tmp（n 在进程内唯一）
+     * @param limit 最多输出的行数
+     */
+    ExternalSorter(std::shared_ptr<const RowLayout> layout, std::vector<Key> keys, const std::vector<int>& carried,
+                   std::filesystem::path tempPrefix, size_t limit = NO_LIMIT);
+    ~ExternalSorter();
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+    /**
+     * 加入一行
+     *
+     * @param row 行缓冲区
+     * @return 写临时文件失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool add(const char* row);
+    /**
+     * 结束输入并排序（有多个有序段时先把段数归并到一次能同时读的数量），之后不能再加入
+     *
+     * @return 读写临时文件失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool sort();
+    /**
+     * 按顺序读出接下来的若干行，总共最多读出 limit 行。
+     * 每行按原来的行格式写到 rows 中，只有排序列和 carried 列有值，其余字节为 0
+     *
+     * @param rows 输出缓冲区，长度至少为 maxRows * rowWidth
+     * @param maxRows 最多读出的行数
+     * @return 读出的行数，读完或出错（见 failed）时返回 0
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    size_t read(char* rows, size_t maxRows);
+    bool failed() const { return error; }
+    /**
+     * 设置排序可用的内存（字节），超过时把有序段写到临时文件
+     *
+     * @param bytes 字节数
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void setMemoryBudget(size_t bytes);
+    static size_t memoryBudget();
+
+private:
+    struct Field {
+        int offset;  // 在原始行中的偏移
+        int width;
+        int slot;    // 在记录中的偏移
+        RowLayout::ColumnType type;
+    };
+
+    struct SortKey {
+        Field field;
+        bool ascending;
+    };
+
+    class RunReader;
+
+    static constexpr size_t NO_RUN = std::numeric_limits<size_t>::max();
+
+    int compare(const char* a, const char* b) const;
+    bool ordered(uint32_t a, uint32_t b) const;
+    void pack(const char* row, char* record) const;
+    void keepTop(const char* row);
+    void sortBuffered();
+    bool spillRun();
+    bool openMerge(const std::vector<std::filesystem::path>& inputs);
+    bool mergeLater(size_t a, size_t b) const;
+    const char* nextMerged();
+    std::filesystem::path nextRunPath();
+
+    std::shared_ptr<const RowLayout> layout;
+    std::vector<SortKey> sortKeys;
+    std::vector<Field> fields;
+    int recordWidth = 0;
+    std::vector<char> records;
+    std::vector<std::filesystem::path> runs;
+    std::filesystem::path prefix;
+    size_t limit;
+    bool bounded = false;            // 按 Top-N 执行
+    std::vector<uint64_t> sequence;  // Top-N：每条记录加入的序号，用于保持稳定
+    std::vector<uint32_t> heap;      // Top-N：记录下标组成的大顶堆，堆顶是最靠后的一行
+    std::vector<char> candidate;
+    uint64_t added = 0;
+    std::vector<uint32_t> order;                     // 内存中排好序的记录下标
+    size_t position = 0;
+    std::vector<std::unique_ptr<RunReader>> readers; // 正在归并的段
+    std::vector<const char*> heads;                  // 各段当前的记录
+    std::vector<size_t> mergeHeap;                   // 段编号组成的小顶堆
+    size_t pendingRun = NO_RUN;                      // 上一次返回的记录所在的段
+    size_t emitted = 0;
+    bool error = false;
+};
+
+#endif // EXTERNAL_SORTER_H
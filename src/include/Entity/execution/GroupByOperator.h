@@ -0,0 +1,72 @@
+#ifndef GROUP_BY_OPERATOR_H
+#define GROUP_BY_OPERATOR_H
+
+#include "Entity/basic_function/RowLayout.h"
+#include "Entity/execution/Aggregator.h"
+#include "Entity/execution/Predicate.h"
+#include "Entity/storage/HeapFile.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * 哈希分组聚合（GROUP BY）
+ *
+ * 分组键由各分组列的原始字段字节拼成定长的键（number 列把 -0 归一为 0、所有 NaN 归为一组），
+ * 在内存哈希表中为每个分组保存一组 Aggregator::State。分组数超过内存预算后不再接纳新的分组：
+ * 已在表中的分组继续在内存中累加，其余的行按键的哈希值分区写到数据文件旁的临时文件中
+ * （DB/<db>/<table>/ 下），内存中的分组输出后再逐个分区递归地聚合，每一层使用不同的哈希种子。
+ * 分组按首次出现的顺序输出，溢出的分组排在内存中的分组之后。
+ */
+class GroupByOperator {
+public:
+    /**
+     * 输出一个分组：groupRow 是只填了分组列的行缓冲区，values 与 Aggregator 中的聚合一一对应
+     */
+    using Emit = std::function<void(const char* groupRow, const std::vector<Aggregator::Value>& values)>;
+
+    /**
+     * @param layout 行格式
+     * @param heap 数据文件
+     * @param groupColumns 分组列下标
+     * @param aggregator 各个聚合
+     * @param where 参与分组的行需要满足的条件
+     */
+    GroupByOperator(std::shared_ptr<const RowLayout> layout, const HeapFile& heap, std::vector<int> groupColumns,
+                    const Aggregator& aggregator, const Predicate& where);
+    /**
+     * 执行分组聚合，对每个分组调用 emit
+     *
+     * @param emit 结果回调
+     * @return 读写数据文件或临时文件失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool run(const Emit& emit);
+    /**
+     * 设置哈希表的内存预算（字节），分组数超过预算时溢出到临时文件
+     *
+     * @param bytes 字节数
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void setMemoryBudget(size_t bytes);
+    static size_t memoryBudget();
+
+private:
+    bool aggregate(const HeapFile& input, const Predicate& filter, int depth, const Emit& emit);
+    void makeKey(const char* row, std::string& key) const;
+
+    std::shared_ptr<const RowLayout> layout;
+    const HeapFile& heap;
+    std::vector<int> columns;
+    const Aggregator& aggregator;
+    const Predicate& where;
+    int keyWidth = 0;
+};
+
+#endif // GROUP_BY_OPERATOR_H
@@ -0,0 +1,35 @@
+#ifndef HASH_PARTITIONER_H
+#define HASH_PARTITIONER_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * 哈希连接和哈希分组共用的分区规则
+ *
+ * 内存放不下时，两个算子都按键的哈希把行写进若干分区文件，再逐个分区处理；
+ * 某个分区仍然放不下时递归分区，最多 MAX_DEPTH 层。
+ */
+class HashPartitioner {
+public:
+    static constexpr int MAX_DEPTH = 3;
+    // 哈希表中每个不同键的额外开销（桶、节点、std::string）的粗略估计
+    static constexpr size_t ENTRY_OVERHEAD = 64;
+
+    /**
+     * 键在第 depth 层分区中所属的分区编号
+     *
+     * 每一层使用不同的种子，避免递归分区时所有行又落进同一个分区
+     *
+     * @param key 编码后的键
+     * @param depth 分区层数，从 0 开始
+     * @param partitions 分区数
+     * @return 分区编号，取值 [0, partitions)
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static size_t partitionOf(const std::string& key, int depth, size_t partitions);
+};
+
+#endif // HASH_PARTITIONER_H
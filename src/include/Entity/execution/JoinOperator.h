@@ -0,0 +1,94 @@
+#ifndef JOIN_OPERATOR_H
+#define JOIN_OPERATOR_H
+
+#include "Entity/basic_function/RowLayout.h"
+#include "Entity/index/TableIndex.h"
+#include "Entity/storage/HeapFile.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+/**
+ * 等值内连接算子
+ *
+ * 按两边表的大小自动选择执行方式：
+ *   - 哈希连接：在较小的一边上按类型化的连接键建内存哈希表，另一边逐行探测；
+ *   - 两边都超过内存预算时，如果两边的 integer / str 连接列上都有单列索引（输入已按连接键有序），
+ *     用两个游标顺链拉取两棵索引的叶子归并，只占常数内存，结果按连接键的顺序输出；
+ *     否则先按键的哈希值把两边分区写到临时文件（grace hash join），再逐个分区连接。
+ * 连接键按左表连接列的类型比较（与原来的嵌套循环连接一致）。
+ */
+class JoinOperator {
+public:
+    /**
+     * 连接的一侧
+     */
+    struct Input {
+        std::shared_ptr<const RowLayout> layout;
+        const HeapFile* heap;
+        int column;
+        TableIndex* index = nullptr; // 连接列上的单列索引，没有时为 nullptr
+    };
+
+    enum class Strategy {
+        Hash,
+        GraceHash,
+        SortMerge
+    };
+
+    /**
+     * 匹配的一对行，left 来自左表，right 来自右表
+     */
+    using Emit = std::function<void(const char* left, const char* right)>;
+
+    JoinOperator(Input left, Input right);
+    /**
+     * 根据表大小和索引选择执行方式
+     *
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    Strategy chooseStrategy() const;
+    /**
+     * 执行连接，对每一对匹配的行调用 emit
+     *
+     * @param emit 结果回调
+     * @return 读写数据文件失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool run(const Emit& emit);
+    /**
+     * 设置哈希表的内存预算（字节），超过时改用分区连接
+     *
+     * @param bytes 字节数
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void setMemoryBudget(size_t bytes);
+    static size_t memoryBudget();
+
+private:
+    struct Side {
+        const RowLayout* layout;
+        const HeapFile* heap;
+        int column;
+        bool isLeft;
+    };
+
+    bool extractKey(const Side& side, const char* row, std::string& key) const;
+    int compareKeys(const char* a, int widthA, const char* b, int widthB) const;
+    bool hashJoin(const Side& build, const Side& probe, int depth, const Emit& emit);
+    bool partitionedJoin(const Side& build, const Side& probe, int depth, const Emit& emit);
+    bool mergeJoin(const Emit& emit);
+    static size_t estimateBytes(const HeapFile& heap);
+
+    Input left;
+    Input right;
+    RowLayout::ColumnType joinType;
+};
+
+#endif // JOIN_OPERATOR_H
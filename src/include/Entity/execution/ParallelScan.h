@@ -0,0 +1,53 @@
+#ifndef PARALLEL_SCAN_H
+#define PARALLEL_SCAN_H
+
+#include "Entity/storage/HeapFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * 按 morsel 并行扫描一个数据文件
+ *
+ * 数据文件按 MORSEL_PAGES 页切成若干 morsel（页内都是完整的行，切分天然按行对齐），
+ * 先按顺序连续地分给各个工作者，保证每个线程大体上顺序读；自己的 morsel 做完后从别的工作者
+ * 队列的末尾偷取，负载不均时也能一起结束。每个工作者有自己的编号，调用方按编号保存部分结果，
+ * 扫描结束后再合并；需要保持串行扫描的输出顺序时按 morsel 编号合并。
+ */
+class ParallelScan {
+public:
+    static constexpr uint32_t MORSEL_PAGES = 32;
+
+    /**
+     * 扫描一个 morsel，返回 false 时所有工作者在做完手上的 morsel 后停止
+     */
+    using MorselTask = std::function<bool(size_t worker, size_t morsel)>;
+
+    /**
+     * @param heap 数据文件
+     * @param parallelism 并行度上限，实际的工作者数不超过 morsel 数
+     */
+    ParallelScan(const HeapFile& heap, size_t parallelism);
+    /**
+     * 执行扫描
+     *
+     * @param task morsel 任务，由多个线程并发调用
+     * @return 有 morsel 任务返回 false 时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool run(const MorselTask& task);
+
+    size_t workers() const { return workerCount; }
+    size_t morsels() const { return morselCount; }
+    uint32_t firstPage(size_t morsel) const { return static_cast<uint32_t>(morsel * MORSEL_PAGES); }
+    uint32_t endPage(size_t morsel) const { return static_cast<uint32_t>((morsel + 1) * MORSEL_PAGES); }
+
+private:
+    size_t morselCount;
+    size_t workerCount;
+};
+
+#endif // PARALLEL_SCAN_H
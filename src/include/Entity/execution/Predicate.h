@@ -0,0 +1,164 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include "Entity/basic_function/RowLayout.h"
+#include "Entity/storage/HeapFile.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * 编译后的 WHERE 条件（各个比较之间是 AND）
+ *
+ * 语句开始时按列类型把常量解析成 int / float / bool / 字符串，把比较符解析成对应类型和比较的
+ * 函数指针（模板实例），逐行求值时直接读行缓冲区中的字段，不构造 std::string、不做文本解析。
+ * 数值列按数值比较，字符串列按字节序比较；空串常量表示 NULL（字段全 0），只能用 = 和 !=。
+ * 批量扫描时 integer / number 列上的比较先把整列抽到连续数组里，用向量化内核成批比较（见
+ * SelectionKernels），其余的比较只对剩下的行逐行判断。
+ * 数据文件有 zone map 时，扫描前先用这些比较排除取值范围与条件不相交的页，这些页不会被读。
+ */
+class Predicate {
+public:
+    enum class Op : uint8_t {
+        Eq,
+        Ne,
+        Lt,
+        Gt,
+        Le,
+        Ge
+    };
+
+    /**
+     * 批量求值时的方式：Int32 / Float 按列向量化比较，Row 逐行调用 eval
+     */
+    enum class Kind : uint8_t {
+        Row,
+        Int32,
+        Float
+    };
+
+    /**
+     * 编译后的单个比较，eval 按列类型和比较符选定
+     */
+    struct Term {
+        bool (*eval)(const Term& term, const char* row) = nullptr;
+        Kind kind = Kind::Row;
+        Op op = Op::Eq;
+        size_t source = 0; // 在 compile 参数中的位置
+        int offset = 0;
+        int width = 0;
+        int64_t intValue = 0;
+        float floatValue = 0;
+        double doubleValue = 0;
+        std::string strValue;
+    };
+
+    /**
+     * 解析比较符
+     *
+     * @param text 比较符文本，如 "<="
+     * @param op 解析结果
+     * @return 不认识的比较符返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static bool parseOp(const std::string& text, Op& op);
+    /**
+     * 编译 WHERE 条件。不存在的列上的条件被忽略；不认识的比较符使条件恒为假
+     *
+     * @param layout 行格式
+     * @param columns 条件列下标（resolveColumns 的结果，-1 表示不存在）
+     * @param ops 比较符
+     * @param values 比较值
+     * @return 比较值不能转换为列的类型时输出错误并返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool compile(const RowLayout& layout, const std::vector<int>& columns, const std::vector<std::string>& ops, const std::vector<std::string>& values);
+    /**
+     * 去掉已经由索引范围保证的条件
+     *
+     * @param covered 与 compile 的条件一一对应，为 true 的条件不再逐行判断
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void removeCovered(const std::vector<bool>& covered);
+    /**
+     * 判断一行是否满足所有条件
+     */
+    bool matches(const char* row) const {
+        for (const Term& term : terms) {
+            if (!term.eval(term, row)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    /**
+     * 对一批行求值，返回满足所有条件的行在批内的下标
+     *
+     * @param batch 一批行
+     * @param selection 返回被选中的行号（升序），长度至少为 HeapFile::BATCH_ROWS
+     * @return 被选中的行数
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    uint32_t select(const HeapFile::Batch& batch, uint16_t* selection) const;
+    /**
+     * 用数据文件的 zone map 找出 [firstPage, endPage) 中一定没有满足条件的行的页
+     *
+     * @param heap 数据文件
+     * @param firstPage 起始页号
+     * @param endPage 结束页号（不含）
+     * @return 第 i 项为 true 表示第 firstPage + i 页可以跳过；没有 zone map 或没有可用的比较时返回空
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    std::vector<bool> pagesToSkip(const HeapFile& heap, uint32_t firstPage, uint32_t endPage) const;
+    /**
+     * 按批扫描数据文件，对满足条件的行调用 visit(const char* row, RowId rid)，返回 false 时提前结束
+     *
+     * @param heap 数据文件
+     * @param visit 行回调
+     * @return 读页失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    template <typename Visitor>
+    bool forEachMatch(const HeapFile& heap, Visitor&& visit) const {
+        return forEachMatch(heap, 0, heap.pageCount(), std::forward<Visitor>(visit));
+    }
+    /**
+     * 只扫描 [firstPage, endPage) 范围内的页，其余同上
+     */
+    template <typename Visitor>
+    bool forEachMatch(const HeapFile& heap, uint32_t firstPage, uint32_t endPage, Visitor&& visit) const {
+        std::vector<uint16_t> selection(HeapFile::BATCH_ROWS);
+        std::vector<bool> skip = pagesToSkip(heap, firstPage, std::min(endPage, heap.pageCount()));
+        auto keep = [&](uint32_t pageNo) {
+            return pageNo - firstPage >= skip.size() || !skip[pageNo - firstPage];
+        };
+        return heap.forEachBatch(firstPage, endPage, keep, [&](const HeapFile::Batch& batch) {
+            uint32_t selected = select(batch, selection.data());
+            for (uint32_t i = 0; i < selected; ++i) {
+                if (!visit(batch.rows[selection[i]], batch.rids[selection[i]])) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+    bool empty() const { return terms.empty(); }
+
+private:
+    std::vector<Term> terms;
+};
+
+#endif // PREDICATE_H
@@ -0,0 +1,128 @@
+#ifndef RESULT_SET_H
+#define RESULT_SET_H
+
+#include "Entity/basic_function/RowLayout.h"
+#include "Entity/storage/HeapFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * 查询结果（游标）
+ *
+ * 调用方反复调用 next 拉取下一批结果行。一行结果由一张或两张（内连接）输入表的行组成，
+ * 这些行直接指向 pin 住的页缓冲区（全表扫描、索引扫描）或算子自己的缓冲区（排序、连接），
+ * 不做拷贝，在下一次调用 next 或结果集析构之前有效。每一列按所在输入表的行格式读出原生类型的值。
+ * 结果集析构时会释放 pin 住的页和算子的临时文件；不需要后面的行时可以直接丢弃。
+ */
+class ResultSet {
+public:
+    static constexpr uint32_t BATCH_ROWS = HeapFile::BATCH_ROWS;
+    static constexpr int MAX_INPUTS = 2;
+    static constexpr size_t NO_LIMIT = std::numeric_limits<size_t>::max();
+
+    /**
+     * 输出列：来自第 input 个输入表的第 index 列
+     */
+    struct Column {
+        std::string name;
+        int input;
+        int index;
+    };
+
+    /**
+     * 一批结果行，第 i 行在第 k 个输入表中的行是 rows[i][k]
+     */
+    struct Batch {
+        uint32_t count = 0;
+        const char* rows[BATCH_ROWS][MAX_INPUTS];
+    };
+
+    /**
+     * 产生结果行的算子
+     */
+    class Source {
+    public:
+        virtual ~Source() = default;
+        /**
+         * 产生下一批行，没有更多的行时 batch.count 为 0；上一批的行在这之后失效
+         *
+         * @param batch 结果批
+         * @return 读数据文件或临时文件失败时返回 false
+         * @throws None
+         *
+         * @author 韩玉龙
+         */
+        virtual bool next(Batch& batch) = 0;
+    };
+
+    /**
+     * @param inputs 各输入表的行格式
+     * @param columns 输出列
+     * @param source 算子
+     * @param limit 最多返回的行数（LIMIT）
+     * @param offset 跳过的行数（OFFSET）
+     */
+    ResultSet(std::vector<std::shared_ptr<const RowLayout>> inputs, std::vector<Column> columns,
+              std::unique_ptr<Source> source, size_t limit = NO_LIMIT, size_t offset = 0);
+    /**
+     * 拉取下一批结果行
+     *
+     * @param batch 结果批，之前取出的行随之失效
+     * @return 取到了行时返回 true；结果已取完或出错（见 failed）时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool next(Batch& batch);
+    /**
+     * 把剩余的结果按控制台格式（先空行和表头，每个值后跟一个制表符）写到 out。
+     * 每一批先格式化到内存中再整块写出，结束时只 flush 一次
+     *
+     * @param out 输出流
+     * @return 读取结果失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool print(std::ostream& out);
+
+    bool failed() const { return error; }
+    const std::vector<Column>& columns() const { return outputs; }
+    int columnCount() const { return static_cast<int>(outputs.size()); }
+    RowLayout::ColumnType type(int col) const { return layoutOf(col).type(outputs[col].index); }
+
+    int32_t getInt(const Batch& batch, uint32_t row, int col) const {
+        return layoutOf(col).getInt(rowOf(batch, row, col), outputs[col].index);
+    }
+    float getNumber(const Batch& batch, uint32_t row, int col) const {
+        return layoutOf(col).getNumber(rowOf(batch, row, col), outputs[col].index);
+    }
+    bool getBool(const Batch& batch, uint32_t row, int col) const {
+        return layoutOf(col).getBool(rowOf(batch, row, col), outputs[col].index);
+    }
+    std::string_view getStr(const Batch& batch, uint32_t row, int col) const {
+        return layoutOf(col).getStr(rowOf(batch, row, col), outputs[col].index);
+    }
+    void print(std::ostream& os, const Batch& batch, uint32_t row, int col) const {
+        layoutOf(col).print(os, rowOf(batch, row, col), outputs[col].index);
+    }
+
+private:
+    const RowLayout& layoutOf(int col) const { return *inputs[outputs[col].input]; }
+    const char* rowOf(const Batch& batch, uint32_t row, int col) const { return batch.rows[row][outputs[col].input]; }
+
+    std::vector<std::shared_ptr<const RowLayout>> inputs;
+    std::vector<Column> outputs;
+    std::unique_ptr<Source> source;
+    size_t remaining;
+    size_t skip;
+    bool error = false;
+};
+
+#endif // RESULT_SET_H
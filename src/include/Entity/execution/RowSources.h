@@ -0,0 +1,104 @@
+#ifndef ROW_SOURCES_H
+#define ROW_SOURCES_H
+
+#include "Entity/execution/ExternalSorter.h"
+#include "Entity/execution/Predicate.h"
+#include "Entity/execution/ResultSet.h"
+#include "Entity/storage/HeapFile.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * 按给定的 RowId 顺序回表读行（索引扫描），只返回仍然存活且满足条件的行。
+ * 返回的行直接指向 pin 住的页（或数据文件的映射），每批最多同时 pin 住 HeapFile::BATCH_PAGES 页
+ */
+class RowIdSource : public ResultSet::Source {
+public:
+    RowIdSource(HeapFile heap, std::vector<RowId> rids, Predicate where);
+    bool next(ResultSet::Batch& batch) override;
+
+protected:
+    /**
+     * rids 用完时补充下一组 RowId，没有更多时保持为空
+     *
+     * @return 读数据文件失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    virtual bool refill() { return true; }
+
+    HeapFile heap;
+    Predicate where;
+    std::vector<RowId> rids;
+    size_t position = 0;
+
+private:
+    std::vector<HeapFile::PageView> pinned;
+};
+
+/**
+ * 按页顺序扫描整个数据文件，返回满足条件的行
+ *
+ * 每次取一组 morsel（每个工作者一个，并行度为 1 时只取一个），在各个 morsel 上并行地按批筛选出
+ * 满足条件的 RowId，再按页 pin 住交给调用方。调用方不再取行时，后面的 morsel 不会被读。
+ */
+class ScanSource : public RowIdSource {
+public:
+    ScanSource(HeapFile heap, Predicate where, size_t parallelism);
+
+protected:
+    bool refill() override;
+
+private:
+    size_t parallelism;
+    uint32_t nextPage = 0;
+};
+
+/**
+ * 按 ExternalSorter 的排序结果返回行，行拷贝在本算子的缓冲区中
+ */
+class SortSource : public ResultSet::Source {
+public:
+    /**
+     * @param sorter 已经调用过 sort 的排序器
+     * @param rowWidth 行宽
+     */
+    SortSource(std::unique_ptr<ExternalSorter> sorter, int rowWidth);
+    bool next(ResultSet::Batch& batch) override;
+
+private:
+    std::unique_ptr<ExternalSorter> sorter;
+    int rowWidth;
+    std::vector<char> buffer;
+};
+
+/**
+ * 暂存推送式算子（连接）产生的结果行：每行把各输入表的行依次拷贝在一起，之后按加入的顺序返回
+ */
+class SpoolSource : public ResultSet::Source {
+public:
+    /**
+     * @param widths 各输入表的行宽
+     */
+    explicit SpoolSource(std::vector<int> widths);
+    /**
+     * 加入一行结果
+     *
+     * @param rows 各输入表的行，个数与 widths 相同
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void append(const char* const* rows);
+    bool next(ResultSet::Batch& batch) override;
+
+private:
+    std::vector<int> widths;
+    size_t tupleWidth = 0;
+    std::vector<char> tuples;
+    size_t position = 0;
+};
+
+#endif // ROW_SOURCES_H
@@ -0,0 +1,58 @@
+#ifndef SELECTION_KERNELS_H
+#define SELECTION_KERNELS_H
+
+#include "Entity/execution/Predicate.h"
+#include <cstdint>
+
+/**
+ * 批量比较的向量化内核
+ *
+ * 一批行中哪些被选中用位掩码表示：第 i 行对应 mask[i / 64] 的第 i % 64 位。比较内核把一列值
+ * 与常量成批比较，结果与掩码按位与。运行时检测 CPU，支持 AVX2 时每次比较 8 个值，否则在
+ * x86 上用 SSE2 每次比较 4 个值，其他平台用标量循环，三种实现的结果完全一致。
+ */
+class SelectionKernels {
+public:
+    static constexpr uint32_t WORD_BITS = 64;
+
+    /**
+     * 把一列 integer 值与常量比较，结果并入掩码
+     *
+     * @param values 连续存放的列值，长度至少为 count 向上取整到 64 的倍数（多出的部分不影响结果）
+     * @param count 行数
+     * @param op 比较符
+     * @param constant 常量
+     * @param mask 选中掩码，不满足比较的行对应的位被清零
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void compareInt32(const int32_t* values, uint32_t count, Predicate::Op op, int32_t constant, uint64_t* mask);
+    /**
+     * 把一列 number 值与常量比较，结果并入掩码；NaN 只满足 !=
+     *
+     * @param values 连续存放的列值，长度要求同 compareInt32
+     * @param count 行数
+     * @param op 比较符
+     * @param constant 常量
+     * @param mask 选中掩码
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void compareFloat(const float* values, uint32_t count, Predicate::Op op, float constant, uint64_t* mask);
+    /**
+     * 把掩码转换为按行号升序排列的选择向量
+     *
+     * @param mask 选中掩码
+     * @param count 行数
+     * @param selection 返回被选中的行号
+     * @return 被选中的行数
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static uint32_t toSelection(const uint64_t* mask, uint32_t count, uint16_t* selection);
+};
+
+#endif // SELECTION_KERNELS_H
@@ -0,0 +1,65 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * 进程内共享的工作线程池
+ *
+ * 线程按需创建、常驻复用，避免每次并行扫描都创建线程。run 把同一个任务交给多个工作者执行，
+ * 调用线程自己是 0 号工作者，并且在等待期间会把本任务还没被领走的份额拿来自己执行，
+ * 所以池中线程都忙（包括在任务中再调用 run）时也不会死锁，只是退化为串行。
+ */
+class WorkerPool {
+public:
+    /**
+     * 获取全局唯一的线程池
+     *
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static WorkerPool& instance();
+    ~WorkerPool();
+    /**
+     * 用 workers 个工作者执行 task(size_t worker)，worker 取 0 .. workers-1，全部结束后返回
+     *
+     * @param workers 工作者个数，不大于 1 时直接在调用线程上执行
+     * @param task 任务，各工作者并发调用，需自行同步共享状态
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void run(size_t workers, const std::function<void(size_t worker)>& task);
+
+private:
+    struct Job {
+        const std::function<void(size_t)>* task;
+        size_t unfinished;
+    };
+
+    struct Slot {
+        Job* job;
+        size_t worker;
+    };
+
+    WorkerPool() = default;
+    void workerLoop();
+
+    static constexpr size_t MAX_THREADS = 256;
+
+    std::mutex mutex;
+    std::condition_variable wake;     // 有新份额或需要退出
+    std::condition_variable finished; // 有份额执行完
+    std::deque<Slot> pending;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,284 @@
+#ifndef B_PLUS_TREE_H
+#define B_PLUS_TREE_H
+
+#include "Entity/basic_function/RowLayout.h"
+#include "Entity/storage/BufferPool.h"
+#include "Entity/storage/Page.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+/**
+ * 存放在索引文件（如 .tid）中的 B+ 树
+ *
+ * 第 0 页是元数据页，其余每页是一个节点，所有页都经过 BufferPool 读写。
+ * 树中的条目是 (键, RowId)，按键比较、键相同时按 RowId 比较，因此同一棵树既能做唯一索引，
+ * 也能存放重复键。叶子节点通过 next 串成链表，范围查询定位到起点后顺链扫描。
+ * 删除只从叶子中移除条目，不做合并（空叶子仍留在链表中，扫描时跳过）。
+ *
+ *   叶子节点： | NodeHeader | (key, rid) * count |
+ *   内部节点： | NodeHeader | (key, rid, child) * count |，link 指向最左孩子，
+ *             第 i 个条目的 child 中所有条目都 >= 该条目的 (key, rid)
+ */
+class BPlusTree {
+public:
+    /**
+     * 键的一个组成部分（对应索引的一列），按类型比较
+     */
+    struct KeyPart {
+        RowLayout::ColumnType type;
+        int width;
+    };
+
+    BPlusTree(std::filesystem::path path, std::vector<KeyPart> parts, bool unique);
+    /**
+     * 打开索引文件并校验元数据
+     *
+     * @return 文件不存在、为空或键格式与当前不一致时返回 false（调用方应重建）
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool open();
+    /**
+     * 创建（或清空）索引文件，写入空树的元数据页
+     *
+     * @return 创建失败或键太宽放不进一页时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool create();
+    /**
+     * 用一批未排序的条目重建整棵树（自底向上装填，比逐条插入快得多）
+     *
+     * @param entries 连续存放的 (key, rid) 条目，长度为 entryWidth 的整数倍，会被原地排序
+     * @param duplicate 唯一索引遇到重复键时返回该键在 entries 中的位置
+     * @return 写页失败或唯一索引出现重复键时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool bulkLoad(std::vector<char>& entries, const char** duplicate = nullptr);
+    /**
+     * 插入一个条目
+     *
+     * @param key 键，长度为 keyWidth
+     * @param rid 行位置
+     * @return 唯一索引中键已存在或写页失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool insert(const char* key, RowId rid);
+    /**
+     * 删除一个条目
+     *
+     * @param key 键
+     * @param rid 行位置
+     * @return 条目不存在时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool erase(const char* key, RowId rid);
+    /**
+     * 键是否存在（不关心 RowId）
+     *
+     * @param key 键
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool contains(const char* key);
+    /**
+     * 按键范围顺序扫描，visit(const char* key, RowId rid) 返回 false 时提前结束
+     *
+     * @param low 下界，nullptr 表示不限
+     * @param lowInclusive 是否包含下界
+     * @param high 上界，nullptr 表示不限
+     * @param highInclusive 是否包含上界
+     * @param visit 条目回调
+     * @return 读页失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    template <typename Visitor>
+    bool scan(const char* low, bool lowInclusive, const char* high, bool highInclusive, Visitor&& visit) {
+        Cursor cursor;
+        if (!seek(low, lowInclusive, cursor)) {
+            return false;
+        }
+        while (cursor.page != 0) {
+            BufferPool::PageGuard page = BufferPool::instance().fetchPage(filePath, cursor.page);
+            if (!page) {
+                return false;
+            }
+            const NodeHeader* node = nodeHeader(page);
+            const char* entry = entryAt(page, cursor.pos);
+            for (uint32_t i = cursor.pos; i < node->count; ++i, entry += leafEntryWidth()) {
+                if (high != nullptr) {
+                    int cmp = compareKeys(entry, high);
+                    if (cmp > 0 || (cmp == 0 && !highInclusive)) {
+                        return true;
+                    }
+                }
+                if (!visit(entry, entryRid(entry))) {
+                    return true;
+                }
+            }
+            cursor.page = node->link;
+            cursor.pos = 0;
+        }
+        return true;
+    }
+    /**
+     * 按键序逐条拉取叶子条目的游标，可以记下位置再回到那里（归并连接用），同时只固定一个叶子页。
+     * 游标使用期间不能修改这棵树
+     */
+    class Scanner {
+    public:
+        struct Position {
+            uint32_t page = 0;
+            uint32_t pos = 0;
+        };
+
+        /**
+         * 取下一个条目 (key, rid)，返回的指针在下一次调用 next 之前有效
+         *
+         * @return 没有更多条目或读页失败（见 failed）时返回 nullptr
+         * @throws None
+         *
+         * @author 韩玉龙
+         */
+        const char* next();
+        /**
+         * 最近一次 next 返回的条目的位置
+         */
+        Position position() const { return last; }
+        /**
+         * 回到 position 记下的位置，下一次 next 重新返回那个条目
+         */
+        void rewind(Position position) { cursor = position; }
+        bool failed() const { return error; }
+
+    private:
+        friend class BPlusTree;
+        BPlusTree* tree = nullptr;
+        Position cursor;
+        Position last;
+        BufferPool::PageGuard page;
+        uint32_t loaded = 0;
+        bool error = false;
+    };
+    /**
+     * 打开一个从第一个 >= low 的条目开始的游标
+     *
+     * @param low 下界，nullptr 表示从最小的条目开始
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    Scanner scanner(const char* low = nullptr);
+    /**
+     * 按键点查，等价于上下界相同的范围扫描
+     */
+    template <typename Visitor>
+    bool lookup(const char* key, Visitor&& visit) {
+        return scan(key, true, key, true, std::forward<Visitor>(visit));
+    }
+    /**
+     * 把脏页写回磁盘
+     *
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool flush();
+    /**
+     * 按各列类型比较两个键
+     *
+     * @return 小于返回负数，等于返回 0，大于返回正数
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    int compareKeys(const char* a, const char* b) const;
+
+    const std::filesystem::path& path() const { return filePath; }
+    int keyWidth() const { return keySize; }
+    bool isUnique() const { return unique; }
+    uint64_t size();
+    /**
+     * 叶子条目的宽度：键 + RowId
+     */
+    int leafEntryWidth() const { return keySize + static_cast<int>(sizeof(RowId)); }
+
+private:
+    struct Meta {
+        uint32_t magic;
+        uint32_t keyWidth;
+        uint32_t signature;
+        uint32_t unique;
+        uint32_t rootPage; // 0 表示空树
+        uint32_t height;
+        uint64_t entryCount;
+    };
+
+    struct NodeHeader {
+        uint32_t magic;
+        uint16_t leaf;
+        uint16_t reserved;
+        uint32_t count;
+        uint32_t link; // 叶子：右兄弟页号；内部节点：最左孩子页号；0 表示没有
+    };
+
+    struct Cursor {
+        uint32_t page = 0;
+        uint32_t pos = 0;
+    };
+
+    static constexpr uint32_t META_MAGIC = 0x58444954; // "TIDX"
+    static constexpr uint32_t NODE_MAGIC = 0x45444f4e; // "NODE"
+
+    static NodeHeader* nodeHeader(const BufferPool::PageGuard& page) {
+        return reinterpret_cast<NodeHeader*>(page.data());
+    }
+    char* entryAt(const BufferPool::PageGuard& page, uint32_t pos) const {
+        int width = nodeHeader(page)->leaf ? leafEntryWidth() : innerEntryWidth();
+        return page.data() + sizeof(NodeHeader) + static_cast<size_t>(pos) * width;
+    }
+    RowId entryRid(const char* entry) const {
+        RowId rid;
+        std::memcpy(&rid, entry + keySize, sizeof(rid));
+        return rid;
+    }
+    uint32_t entryChild(const char* entry) const {
+        uint32_t child;
+        std::memcpy(&child, entry + leafEntryWidth(), sizeof(child));
+        return child;
+    }
+    int innerEntryWidth() const { return leafEntryWidth() + static_cast<int>(sizeof(uint32_t)); }
+
+    uint32_t signature() const;
+    int compareEntries(const char* key, RowId rid, const char* entry) const;
+    bool readMeta(Meta& meta);
+    bool writeMeta(const Meta& meta);
+    BufferPool::PageGuard newNode(bool leaf);
+    uint32_t lowerBound(const BufferPool::PageGuard& page, const char* key, RowId rid) const;
+    bool findLeaf(uint32_t root, const char* key, RowId rid, std::vector<uint32_t>* path, uint32_t& leafPage);
+    bool seek(const char* key, bool inclusive, Cursor& cursor);
+    bool insertIntoParent(std::vector<uint32_t>& path, Meta& meta, const char* sepKey, RowId sepRid,
+                          uint32_t rightPage);
+
+    std::filesystem::path filePath;
+    std::vector<KeyPart> keyParts;
+    int keySize = 0;
+    bool unique;
+    uint32_t leafCapacity = 0;
+    uint32_t innerCapacity = 0;
+};
+
+#endif // B_PLUS_TREE_H
@@ -0,0 +1,235 @@
+#ifndef TABLE_INDEX_H
+#define TABLE_INDEX_H
+
+#include "BPlusTree.h"
+#include "Entity/basic_function/RowLayout.h"
+#include "Entity/storage/HeapFile.h"
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * 建在表的若干列上的索引
+ *
+ * 把行中索引列的字段字节按顺序拼成键，存进 BPlusTree，值是行在 .trd 中的 RowId。
+ * 主键索引保存在 <table>.tid 中；外键自动建立的单列索引保存在 <table>.<column>.tid 中；
+ * CREATE INDEX 建立的索引保存在 <table>.<index>.tid 中，定义（索引名和列名）记在 <table>.tix 里。
+ * INCLUDE 的列接在索引列后面作为键的最后几部分，索引项因此仍然定长，查询要的列都在键里时不必回表。
+ * 表文件夹中的 .tid 文件都是这张表的索引。索引文件缺失、为空或与表结构不一致时，打开时从数据文件重建。
+ */
+class TableIndex {
+public:
+    /**
+     * CREATE INDEX 建立的索引的定义
+     */
+    struct Definition {
+        std::string name;
+        std::vector<std::string> columns;
+        std::vector<std::string> include; // 只为覆盖查询而存进索引的列
+    };
+
+    TableIndex(std::filesystem::path path, std::shared_ptr<const RowLayout> layout, std::vector<int> columns, bool unique);
+    /**
+     * 表的主键索引（<table>.tid），表没有主键时返回 nullptr
+     *
+     * @param tableDirPath 表文件夹路径
+     * @param tableName 表名称
+     * @param layout 行格式
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static std::unique_ptr<TableIndex> forPrimaryKey(const std::filesystem::path& tableDirPath, const std::string& tableName, std::shared_ptr<const RowLayout> layout);
+    /**
+     * 单列上的索引：该列就是表的（单列）主键时返回主键索引，否则返回 <table>.<column>.tid 中的非唯一索引。
+     * 外键检查用它在被引用列上查值，文件不存在时第一次 open 会从数据文件建立
+     *
+     * @param tableDirPath 表文件夹路径
+     * @param tableName 表名称
+     * @param layout 行格式
+     * @param column 列下标
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static std::unique_ptr<TableIndex> forColumn(const std::filesystem::path& tableDirPath, const std::string& tableName, std::shared_ptr<const RowLayout> layout, int column);
+    /**
+     * 表上已经建立的所有索引，主键索引（唯一索引）在最前面，之后是 CREATE INDEX 建立的索引，最后是外键建立的列索引。
+     * 插入、删除、更新行时用它同步维护全部索引
+     *
+     * @param tableDirPath 表文件夹路径
+     * @param tableName 表名称
+     * @param layout 行格式
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static std::vector<std::unique_ptr<TableIndex>> forTable(const std::filesystem::path& tableDirPath, const std::string& tableName, std::shared_ptr<const RowLayout> layout);
+    /**
+     * CREATE INDEX 建立的索引（<table>.<index>.tid），定义中的列不存在时返回 nullptr
+     *
+     * @param tableDirPath 表文件夹路径
+     * @param tableName 表名称
+     * @param layout 行格式
+     * @param definition 索引定义
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static std::unique_ptr<TableIndex> forDefinition(const std::filesystem::path& tableDirPath, const std::string& tableName, std::shared_ptr<const RowLayout> layout, const Definition& definition);
+    /**
+     * 读取表的索引定义（<table>.tix），文件不存在时返回空
+     *
+     * @param tableDirPath 表文件夹路径
+     * @param tableName 表名称
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static std::vector<Definition> readDefinitions(const std::filesystem::path& tableDirPath, const std::string& tableName);
+    /**
+     * 写入表的索引定义，先写临时文件再替换
+     *
+     * @param tableDirPath 表文件夹路径
+     * @param tableName 表名称
+     * @param definitions 全部索引定义
+     * @return 写入失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static bool writeDefinitions(const std::filesystem::path& tableDirPath, const std::string& tableName, const std::vector<Definition>& definitions);
+    /**
+     * 让索引文件失效（清空），下一次 open 时从数据文件重建。
+     * 改写行位置或表结构（ALTER、级联删除等）之后调用
+     *
+     * @param path 索引文件路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void invalidate(const std::filesystem::path& path);
+    /**
+     * 让表文件夹中的所有索引文件失效，行的位置全部改变（整表改写、恢复）时调用
+     *
+     * @param tableDirPath 表文件夹路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void invalidateAll(const std::filesystem::path& tableDirPath);
+    /**
+     * 打开索引，文件无效时扫描数据文件重建
+     *
+     * @param heap 表的数据文件
+     * @return 重建失败（如已有数据违反唯一约束）时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool open(const HeapFile& heap);
+    /**
+     * 扫描数据文件重建索引
+     *
+     * @param heap 表的数据文件
+     * @return 写入失败或唯一索引出现重复键时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool rebuild(const HeapFile& heap);
+    /**
+     * 从行中取出索引键
+     *
+     * @param row 行数据
+     * @param key 输出缓冲区，长度为 keyWidth
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void makeKey(const char* row, char* key) const;
+    /**
+     * makeKey 的逆过程：把键中各部分拷回行缓冲区中对应列的位置，其他列不动。
+     * 用于只读索引的扫描（索引覆盖了查询用到的全部列）
+     *
+     * @param key 键
+     * @param row 行缓冲区
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void rowFromKey(const char* key, char* row) const;
+    /**
+     * 把每个索引列的文本值按字段类型编码成键
+     *
+     * @param values 文本值，与索引列一一对应
+     * @param key 输出的键
+     * @return 某个值无法转换为字段类型时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool encodeKey(const std::vector<std::string>& values, std::vector<char>& key) const;
+    /**
+     * 用前几个索引列的文本值拼成键，其余列填该列类型的最小值或最大值，
+     * 作为按索引前缀扫描的下界或上界
+     *
+     * @param values 前 values.size() 个索引列的文本值
+     * @param high 为 true 时其余列填最大值，否则填最小值
+     * @param key 输出的键
+     * @return 某个值无法转换为字段类型时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool encodePrefix(const std::vector<std::string>& values, bool high, std::vector<char>& key) const;
+    /**
+     * 把键转换为文本，用于错误信息，如 "1, abc"
+     *
+     * @param key 键
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    std::string describeKey(const char* key) const;
+    /**
+     * 行的索引键是否已经存在
+     */
+    bool containsRow(const char* row);
+    bool insert(const char* row, RowId rid);
+    bool erase(const char* row, RowId rid);
+    /**
+     * 把行的 (键, RowId) 追加到条目缓冲区，之后用 load 一次性装入
+     */
+    void collect(const char* row, RowId rid, std::vector<char>& entries) const;
+    /**
+     * 用 collect 收集到的条目重建整个索引
+     *
+     * @param entries 条目缓冲区
+     * @param duplicate 唯一索引出现重复键时返回该键
+     * @return 写入失败或唯一索引出现重复键时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool load(std::vector<char>& entries, std::string* duplicate = nullptr);
+    /**
+     * 某一列是否是索引列
+     */
+    bool covers(int column) const;
+    bool flush() { return index.flush(); }
+
+    BPlusTree& tree() { return index; }
+    const std::vector<int>& columns() const { return keyColumns; }
+    const RowLayout& layout() const { return *rowLayout; }
+
+private:
+    static std::vector<BPlusTree::KeyPart> keyParts(const RowLayout& layout, const std::vector<int>& columns);
+
+    std::shared_ptr<const RowLayout> rowLayout;
+    std::vector<int> keyColumns;
+    BPlusTree index;
+};
+
+#endif // TABLE_INDEX_H
@@ -0,0 +1,206 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "Page.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * 进程内共享的页缓冲池
+ *
+ * 以 (文件, 页号) 为键缓存 PAGE_SIZE 大小的页，使用 CLOCK 算法淘汰未被 pin 的页，
+ * 脏页在被淘汰或显式 flush 时写回磁盘。所有对 .trd 的读写都经过这里，
+ * 对文件做 rename / remove / truncate 之前必须先 dropFile，避免缓存中留下旧内容。
+ */
+class BufferPool {
+private:
+    struct Frame {
+        std::string file;
+        uint32_t pageNo = 0;
+        int pinCount = 0;
+        bool dirty = false;
+        bool referenced = false;
+        bool valid = false;
+        std::unique_ptr<char[]> data;
+    };
+
+public:
+    /**
+     * 被 pin 住的页，析构时自动 unpin
+     */
+    class PageGuard {
+    public:
+        PageGuard() = default;
+        PageGuard(BufferPool* pool, Frame* frame) : pool(pool), frame(frame) {}
+        PageGuard(PageGuard&& other) noexcept : pool(other.pool), frame(other.frame) { other.frame = nullptr; }
+        PageGuard& operator=(PageGuard&& other) noexcept;
+        PageGuard(const PageGuard&) = delete;
+        PageGuard& operator=(const PageGuard&) = delete;
+        ~PageGuard() { release(); }
+
+        bool valid() const { return frame != nullptr; }
+        explicit operator bool() const { return valid(); }
+        uint32_t pageNo() const { return frame->pageNo; }
+        char* data() const { return frame->data.get(); }
+        PageHeader* header() const { return reinterpret_cast<PageHeader*>(frame->data.get()); }
+        char* rows() const { return frame->data.get() + sizeof(PageHeader); }
+        /**
+         * 标记页已修改，淘汰或 flush 时写回
+         */
+        void markDirty();
+        /**
+         * 提前 unpin
+         */
+        void release();
+
+    private:
+        BufferPool* pool = nullptr;
+        Frame* frame = nullptr;
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t writes = 0;
+    };
+
+    /**
+     * 获取全局唯一的缓冲池
+     *
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static BufferPool& instance();
+    ~BufferPool();
+    /**
+     * pin 住某个文件的某一页，未命中时从磁盘读取
+     *
+     * @param file 数据文件路径
+     * @param pageNo 页号
+     * @return 页句柄；文件打不开或页号越界时返回无效句柄
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    PageGuard fetchPage(const std::filesystem::path& file, uint32_t pageNo);
+    /**
+     * 在文件末尾分配一个新页（内容全 0，已标记为脏页）
+     *
+     * @param file 数据文件路径
+     * @return 页句柄；文件打不开时返回无效句柄
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    PageGuard appendPage(const std::filesystem::path& file);
+    /**
+     * 文件当前的页数（包含尚未写回磁盘的新页）
+     *
+     * @param file 数据文件路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    uint32_t pageCount(const std::filesystem::path& file);
+    /**
+     * 文件是否已经被缓冲池打开
+     *
+     * @param file 数据文件路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool isOpen(const std::filesystem::path& file);
+    /**
+     * 把某个文件的所有脏页按页号顺序写回磁盘
+     *
+     * @param file 数据文件路径
+     * @return 写盘失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool flushFile(const std::filesystem::path& file);
+    /**
+     * 丢弃某个文件的所有缓存页（不写回）并关闭文件句柄
+     *
+     * @param file 数据文件路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void dropFile(const std::filesystem::path& file);
+    /**
+     * 丢弃某个目录下所有文件的缓存页（删除表或数据库时使用）
+     *
+     * @param dir 目录路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void dropDirectory(const std::filesystem::path& dir);
+    /**
+     * 把某个目录下所有文件的脏页写回磁盘（日志检查点使用）
+     *
+     * @param dir 目录路径
+     * @return 写盘失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool flushDirectory(const std::filesystem::path& dir);
+    /**
+     * 写回所有脏页
+     *
+     * @return 写盘失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool flushAll();
+    /**
+     * 设置缓冲池容量（页数），只影响之后的淘汰
+     *
+     * @param frames 页数
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void setCapacity(size_t frames);
+    Stats stats();
+
+private:
+    struct FileState {
+        std::fstream stream;
+        uint32_t pageCount = 0;
+        std::unordered_map<uint32_t, Frame*> pages;
+    };
+
+    BufferPool() = default;
+    static std::string makeKey(const std::filesystem::path& file);
+    FileState* openFileLocked(const std::string& key);
+    Frame* allocateFrameLocked();
+    bool writeFrameLocked(FileState& state, Frame& frame);
+    bool flushFileLocked(const std::string& key, FileState& state);
+    void dropFileLocked(const std::string& key);
+    void unpin(Frame* frame, bool dirty);
+
+    static constexpr size_t MAX_WRITE_PAGES = 64; // flush 时一次顺序写最多合并的页数
+
+    std::mutex mutex;
+    size_t capacity = 4096; // 默认 32 MiB
+    size_t clockHand = 0;
+    std::vector<std::unique_ptr<Frame>> frames;
+    std::unordered_map<std::string, FileState> files;
+    Stats counters;
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,392 @@
+#ifndef HEAP_FILE_H
+#define HEAP_FILE_H
+
+#include "BufferPool.h"
+#include "MappedFile.h"
+#include "Page.h"
+#include "ZoneMap.h"
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * 按页组织的 .trd 数据文件
+ *
+ * 所有页都通过 BufferPool 访问：扫描热表时直接命中内存，追加一行只修改最后一页。
+ * 打开旧版（无页头、行紧密排列）的数据文件时会自动转换为分页格式。
+ * 删除的行只在页尾的位图中标记，扫描时跳过；整理表时把存活的行重新紧密排列，回收空间。
+ * 只读查询可以先调用 mapForRead，之后的扫描和按 RowId 读行直接读内存映射（见 MappedFile）。
+ * 有 zone map（见 ZoneMap）时，open 之后经过本对象写入的每一行都会放宽所在页的范围。
+ */
+class HeapFile {
+public:
+    static constexpr uint32_t BATCH_ROWS = 1024; // 批量扫描每批最多的行数
+    static constexpr size_t BATCH_PAGES = 16;    // 每批最多同时 pin 住的页数（行很宽时先到这个上限）
+
+    /**
+     * 批量扫描的一批存活的行，rows 指向 pin 住的页内的行，回调返回前一直有效
+     */
+    struct Batch {
+        uint32_t count = 0;
+        const char* rows[BATCH_ROWS];
+        RowId rids[BATCH_ROWS];
+    };
+
+    /**
+     * 读到的一页：来自缓冲池时 pin 住该页，来自映射时直接指向映射，析构前一直有效
+     */
+    class PageView {
+    public:
+        explicit operator bool() const { return page != nullptr; }
+        const char* data() const { return page; }
+        const PageHeader* header() const { return reinterpret_cast<const PageHeader*>(page); }
+        const char* rows() const { return page + sizeof(PageHeader); }
+
+    private:
+        friend class HeapFile;
+        BufferPool::PageGuard guard;
+        const char* page = nullptr;
+    };
+
+    HeapFile(std::filesystem::path path, int rowWidth);
+    /**
+     * 打开已存在的数据文件，必要时把旧格式转换为当前的分页格式。
+     * 转换会改变行位置，同目录下同名的 .tid 索引会被清空，下一次打开索引时重建
+     *
+     * @return 文件不存在或格式不匹配时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool open();
+    /**
+     * 创建（或清空）数据文件
+     *
+     * @return 创建失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool create();
+    /**
+     * 在最后一页追加一行，最后一页已满时分配新页
+     *
+     * @param row 行数据，长度为 rowWidth
+     * @param rid 可选，返回新行的位置
+     * @return 写入失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool appendRow(const char* row, RowId* rid = nullptr);
+    /**
+     * 连续追加多行：先填满最后一页，再整页分配新页，每页只 pin 一次
+     *
+     * @param rows 连续存放的行数据，长度为 count * rowWidth
+     * @param count 行数
+     * @param rids 可选，按顺序返回每一行的位置
+     * @return 写入失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool appendRows(const char* rows, size_t count, std::vector<RowId>* rids = nullptr);
+    /**
+     * 预先计算接下来追加 count 行时每一行的位置（先写日志再改页时使用），不修改文件
+     *
+     * @param count 行数
+     * @param rids 按顺序返回每一行的位置
+     * @return 读页失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool nextRowIds(size_t count, std::vector<RowId>& rids) const;
+    /**
+     * 把一行写到指定位置，页不存在时先补齐空页；用于按日志重做插入，重复写同一位置结果不变
+     *
+     * @param rid 行位置
+     * @param row 行数据
+     * @param lsn 本次修改的日志记录号，写入页头
+     * @return 写入失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool placeRow(RowId rid, const char* row, uint32_t lsn);
+    /**
+     * 就地改写已有的一行，只弄脏行所在的页；重复改写同一行结果不变
+     *
+     * @param rid 行位置
+     * @param row 新的行数据
+     * @param lsn 本次修改的日志记录号，写入页头
+     * @return 页不存在或槽号越界时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool updateRow(RowId rid, const char* row, uint32_t lsn);
+    /**
+     * 把一行标记为已删除（墓碑），行的位置和内容都不变；重复删除同一行结果不变
+     *
+     * @param rid 行位置
+     * @param lsn 本次修改的日志记录号，写入页头
+     * @return 页不存在或槽号越界时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool eraseRow(RowId rid, uint32_t lsn);
+    /**
+     * 统计存活的行数和已删除（尚未回收）的行数
+     *
+     * @param live 返回存活的行数
+     * @param dead 返回已删除的行数
+     * @return 读页失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool countRows(size_t& live, size_t& dead) const;
+    /**
+     * 把本文件的脏页写回磁盘
+     *
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool flush();
+    /**
+     * 为数据文件建立 zone map，之后本对象的写入会维护它
+     *
+     * @param columns 要跟踪的列
+     * @return 读数据文件或写 zone map 失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool buildZoneMap(std::vector<ZoneMap::Column> columns);
+    /**
+     * open 时找到的（或 buildZoneMap 建立的）zone map，没有时返回 nullptr
+     */
+    const ZoneMap* zoneMap() const { return zones.get(); }
+    /**
+     * 为只读查询映射数据文件：先把缓冲池中的脏页写回，再映射整个文件，之后的 forEachRow、
+     * forEachBatch、withRow、readPage 都直接读映射。映射之后不能再通过这个对象修改文件，
+     * 其他对象对文件的修改只有写回磁盘之后才能读到；映射存在期间不能清空（truncate）文件
+     *
+     * @return 写回脏页失败或无法映射时返回 false，此时仍然通过缓冲池读取
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool mapForRead();
+    /**
+     * 读取一页，映射中有这一页时直接返回映射中的页，否则从缓冲池 pin 住
+     *
+     * @param pageNo 页号
+     * @return 页不存在或读取失败时返回的视图为空
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    PageView readPage(uint32_t pageNo) const {
+        PageView view;
+        if (mapping && pageNo < mapping->pageCount()) {
+            view.page = mapping->page(pageNo);
+        } else if ((view.guard = BufferPool::instance().fetchPage(filePath, pageNo))) {
+            view.page = view.guard.data();
+        }
+        return view;
+    }
+    /**
+     * 顺序扫描所有存活的行，visit(const char* row, RowId rid) 返回 false 时提前结束
+     *
+     * @param visit 行回调
+     * @return 读页失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    template <typename Visitor>
+    bool forEachRow(Visitor&& visit) const {
+        uint32_t pages = pageCount();
+        for (uint32_t pageNo = 0; pageNo < pages; ++pageNo) {
+            if (mapping && pageNo % MappedFile::PREFETCH_PAGES == 0) {
+                mapping->willNeed(pageNo, pageNo + MappedFile::PREFETCH_PAGES);
+            }
+            PageView page = readPage(pageNo);
+            if (!page) {
+                return false;
+            }
+            const char* row = page.rows();
+            uint32_t rowCount = page.header()->magic == PAGE_MAGIC ? page.header()->rowCount : 0;
+            for (uint32_t slot = 0; slot < rowCount; ++slot, row += width) {
+                if (isDeleted(page.data(), capacity, slot)) {
+                    continue;
+                }
+                if (!visit(row, RowId{pageNo, slot})) {
+                    return true;
+                }
+            }
+        }
+        return true;
+    }
+    /**
+     * 按批顺序扫描所有存活的行，visit(const Batch& batch) 返回 false 时提前结束。
+     * 一批凑满 BATCH_ROWS 行或 BATCH_PAGES 页后交给回调，回调可以按列批量求值
+     *
+     * @param visit 批回调
+     * @return 读页失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    template <typename Visitor>
+    bool forEachBatch(Visitor&& visit) const {
+        return forEachBatch(0, pageCount(), std::forward<Visitor>(visit));
+    }
+    /**
+     * 只按批扫描 [firstPage, endPage) 范围内的页（并行扫描时每个线程各扫一段）
+     *
+     * @param firstPage 起始页号
+     * @param endPage 结束页号（不含），超过文件页数时截断
+     * @param visit 批回调
+     * @return 读页失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    template <typename Visitor>
+    bool forEachBatch(uint32_t firstPage, uint32_t endPage, Visitor&& visit) const {
+        return forEachBatch(firstPage, endPage, [](uint32_t) { return true; }, std::forward<Visitor>(visit));
+    }
+    /**
+     * 同上，keep(uint32_t pageNo) 返回 false 的页不读（按 zone map 跳过的页）
+     */
+    template <typename PageFilter, typename Visitor>
+    bool forEachBatch(uint32_t firstPage, uint32_t endPage, PageFilter&& keep, Visitor&& visit) const {
+        auto batch = std::make_unique<Batch>();
+        std::vector<PageView> pinned;
+        pinned.reserve(BATCH_PAGES);
+        uint32_t pages = std::min(endPage, pageCount());
+        uint32_t prefetched = firstPage;
+        for (uint32_t pageNo = firstPage; pageNo < pages; ++pageNo) {
+            if (!keep(pageNo)) {
+                continue;
+            }
+            if (mapping && pageNo >= prefetched) {
+                mapping->willNeed(pageNo, pageNo + MappedFile::PREFETCH_PAGES);
+                prefetched = pageNo + MappedFile::PREFETCH_PAGES;
+            }
+            PageView page = readPage(pageNo);
+            if (!page) {
+                return false;
+            }
+            const char* row = page.rows();
+            uint32_t rowCount = page.header()->magic == PAGE_MAGIC ? page.header()->rowCount : 0;
+            for (uint32_t slot = 0; slot < rowCount; ++slot, row += width) {
+                if (isDeleted(page.data(), capacity, slot)) {
+                    continue;
+                }
+                if (batch->count == BATCH_ROWS) {
+                    // 当前页还要留着，先交出已经凑满的一批
+                    if (!visit(static_cast<const Batch&>(*batch))) {
+                        return true;
+                    }
+                    batch->count = 0;
+                    pinned.clear();
+                }
+                batch->rows[batch->count] = row;
+                batch->rids[batch->count] = RowId{pageNo, slot};
+                ++batch->count;
+            }
+            pinned.push_back(std::move(page));
+            if (pinned.size() == BATCH_PAGES && batch->count > 0) {
+                if (!visit(static_cast<const Batch&>(*batch))) {
+                    return true;
+                }
+                batch->count = 0;
+                pinned.clear();
+            } else if (batch->count == 0) {
+                pinned.clear();
+            }
+        }
+        if (batch->count > 0) {
+            visit(static_cast<const Batch&>(*batch));
+        }
+        return true;
+    }
+    /**
+     * 按 RowId 读取一行（索引查找后回表），visit(const char* row) 在页被 pin 住期间调用
+     *
+     * @param rid 行位置
+     * @param visit 行回调
+     * @return 页不存在、槽号越界或行已删除时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    template <typename Visitor>
+    bool withRow(RowId rid, Visitor&& visit) const {
+        PageView page = readPage(rid.pageNo);
+        if (!page || page.header()->magic != PAGE_MAGIC || rid.slot >= page.header()->rowCount ||
+            isDeleted(page.data(), capacity, rid.slot)) {
+            return false;
+        }
+        visit(static_cast<const char*>(page.rows() + static_cast<size_t>(rid.slot) * width));
+        return true;
+    }
+    /**
+     * 用一个已经写好的临时数据文件原子地替换目标数据文件（先写回临时文件的脏页，再 rename 覆盖）
+     *
+     * @param tempPath 临时文件路径
+     * @param targetPath 目标数据文件路径
+     * @return 替换失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static bool replace(const std::filesystem::path& tempPath, const std::filesystem::path& targetPath);
+    /**
+     * 丢弃临时数据文件及其缓存页
+     *
+     * @param tempPath 临时文件路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void discard(const std::filesystem::path& tempPath);
+    /**
+     * 为算子溢出生成一个进程内唯一的临时文件路径 <base>.<tag><n>.tmp，
+     * 同一张表上并发的多个算子实例不会互相覆盖或删除对方的文件
+     *
+     * @param base 基础路径（通常是表的数据文件）
+     * @param tag 区分用途的标记，如 S、L、R、G
+     * @return 临时文件路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static std::filesystem::path temporaryPath(const std::filesystem::path& base, const std::string& tag);
+
+    const std::filesystem::path& path() const { return filePath; }
+    int rowWidth() const { return width; }
+    uint32_t rowsPerPage() const { return capacity; }
+    uint32_t pageCount() const { return BufferPool::instance().pageCount(filePath); }
+
+private:
+    bool upgradeLegacyFile();
+    bool upgradeUnmarkedFile();
+
+    std::filesystem::path filePath;
+    int width;
+    uint32_t capacity;
+    std::shared_ptr<const MappedFile> mapping;
+    std::shared_ptr<ZoneMap> zones;
+};
+
+#endif // HEAP_FILE_H
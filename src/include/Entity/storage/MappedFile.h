@@ -0,0 +1,57 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include "Page.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+/**
+ * 只读映射到内存的 .trd 数据文件
+ *
+ * 只读查询扫描大表时用映射代替缓冲池：行指针直接指向映射，不用把页拷贝进缓冲池的帧，
+ * 也不用每取一页就抢一次缓冲池的锁。映射时告诉内核会顺序读（MADV_SEQUENTIAL），
+ * 扫描时每读到 PREFETCH_PAGES 页的开头再提示预读接下来这一段（MADV_WILLNEED）。
+ * 映射只包含打开时文件中的整页；之后追加的页仍然要经过缓冲池读取。
+ * 不支持映射的平台上 open 总是返回 nullptr。
+ */
+class MappedFile {
+public:
+    static constexpr uint32_t PREFETCH_PAGES = 64; // 扫描时每次提示预读的页数
+
+    /**
+     * 映射整个文件
+     *
+     * @param path 文件路径
+     * @return 文件为空、长度不是整页或映射失败时返回 nullptr
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static std::shared_ptr<const MappedFile> open(const std::filesystem::path& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    /**
+     * 提示内核预读 [firstPage, endPage) 范围内的页
+     *
+     * @param firstPage 起始页号
+     * @param endPage 结束页号（不含），超过映射的页数时截断
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void willNeed(uint32_t firstPage, uint32_t endPage) const;
+
+    uint32_t pageCount() const { return pages; }
+    const char* page(uint32_t pageNo) const { return base + static_cast<size_t>(pageNo) * PAGE_SIZE; }
+
+private:
+    MappedFile(const char* base, uint32_t pages) : base(base), pages(pages) {}
+
+    const char* base;
+    uint32_t pages;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,57 @@
+#ifndef PAGE_H
+#define PAGE_H
+
+#include <cstdint>
+
+/**
+ * .trd 数据文件的页格式
+ *
+ * 数据文件由定长页组成，每页开头是 PageHeader，后面是连续的定长行槽，页尾是删除位图：
+ *   | PageHeader | row 0 | row 1 | ... | row n-1 | 空闲 | 删除位图 |
+ * 行宽由表结构决定（RowLayout::rowWidth），同一文件内所有页行宽相同。
+ * DELETE 只把行在位图中标记为已删除（墓碑），行位置不变；空间由整理（compact）时整表改写回收。
+ * 页头的 lsn 是最后一次修改这一页的日志记录号（见 WriteAheadLog），用于核对页和日志的先后关系。
+ */
+constexpr uint32_t PAGE_SIZE = 8192;
+constexpr uint32_t PAGE_MAGIC = 0x32445254;    // "TRD2"
+constexpr uint32_t PAGE_MAGIC_V1 = 0x50445254; // "TRDP"：没有删除位图的旧格式，打开时转换
+
+struct PageHeader {
+    uint32_t magic;
+    uint32_t rowWidth;
+    uint32_t rowCount; // 已使用的行槽数
+    uint32_t lsn;      // 最后一次修改本页的日志记录号，旧文件为 0
+};
+
+/**
+ * 行在数据文件中的位置：页号 + 页内槽号
+ */
+struct RowId {
+    uint32_t pageNo;
+    uint32_t slot;
+};
+
+/**
+ * 计算一页能放下的行数（每行还要占删除位图中的 1 位），行宽超过一页时返回 0
+ */
+inline uint32_t pageCapacity(uint32_t rowWidth) {
+    return rowWidth == 0 ? 0 : (PAGE_SIZE - sizeof(PageHeader)) * 8 / (rowWidth * 8 + 1);
+}
+
+/**
+ * 删除位图在页内的偏移，capacity 为 pageCapacity 的结果
+ */
+inline uint32_t deletionBitmapOffset(uint32_t capacity) {
+    return PAGE_SIZE - (capacity + 7) / 8;
+}
+
+inline bool isDeleted(const char* page, uint32_t capacity, uint32_t slot) {
+    return (page[deletionBitmapOffset(capacity) + slot / 8] >> (slot % 8)) & 1;
+}
+
+inline void setDeleted(char* page, uint32_t capacity, uint32_t slot, bool deleted) {
+    char& bits = page[deletionBitmapOffset(capacity) + slot / 8];
+    bits = deleted ? static_cast<char>(bits | (1 << (slot % 8))) : static_cast<char>(bits & ~(1 << (slot % 8)));
+}
+
+#endif // PAGE_H
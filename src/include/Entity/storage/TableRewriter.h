@@ -0,0 +1,81 @@
+#ifndef TABLE_REWRITER_H
+#define TABLE_REWRITER_H
+
+#include "HeapFile.h"
+#include "Page.h"
+#include "WriteAheadLog.h"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * 在线改写一张表的数据文件（OPTIMIZE TABLE、整理表使用）
+ *
+ * 按给定的顺序把存活的行分批复制到 <table>.trd.tmp，只在复制每一批时暂停提交，读一直走旧文件；
+ * 复制期间提交的修改由日志捕获，复制完后追到新文件上。最后在暂停提交的状态下追完剩余的修改，
+ * 让新文件落盘、做检查点，再用 rename 原子地换上新文件。行位置全部变化，表的索引需要重建。
+ * 改写期间不能对同一张表做不经过日志的操作（批量导入、ALTER 等），捕获到批量导入时放弃改写。
+ */
+class TableRewriter {
+public:
+    struct Options {
+        size_t bytesPerSecond = 16u << 20; // 复制速度上限，0 表示不限速
+        size_t batchRows = 4096;           // 每批复制的行数，批内暂停提交
+    };
+
+    struct Stats {
+        size_t rows = 0;          // 新文件中的行数
+        uint32_t pagesBefore = 0;
+        uint32_t pagesAfter = 0;
+        size_t caughtUp = 0;      // 复制期间捕获并追上的修改条数
+        double seconds = 0;
+    };
+
+    /**
+     * 给出复制顺序（在暂停提交期间调用），返回 false 时按物理顺序复制
+     */
+    using RowOrder = std::function<bool(std::vector<RowId>& rids)>;
+    /**
+     * 新文件换上之后、恢复提交之前调用，用来重建索引
+     */
+    using SwapHook = std::function<void(const HeapFile& heap)>;
+
+    /**
+     * @param wal 表所在数据库的日志
+     * @param tableName 表名
+     * @param rowWidth 行宽
+     */
+    TableRewriter(WriteAheadLog& wal, std::string tableName, int rowWidth);
+    /**
+     * 执行改写
+     *
+     * @param options 限速和分批参数
+     * @param order 可选，复制顺序（如按主键聚簇）
+     * @param onSwap 可选，换上新文件后的回调
+     * @param stats 可选，返回统计信息
+     * @return 表正在被改写、读写文件失败或改写期间表被批量导入时返回 false（旧文件保持不变）
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool run(const Options& options, const RowOrder& order = nullptr, const SwapHook& onSwap = nullptr, Stats* stats = nullptr);
+
+private:
+    using Transaction = WriteAheadLog::Transaction;
+    using Changes = Transaction::TableChanges;
+
+    bool catchUp(std::vector<Changes>& changes, HeapFile& target, size_t& applied);
+    void abandon();
+
+    WriteAheadLog& log;
+    std::string table;
+    int width;
+    std::filesystem::path dataPath;
+    std::filesystem::path tempPath;
+    std::unordered_map<uint64_t, RowId> moved; // 旧行位置 -> 新行位置
+};
+
+#endif // TABLE_REWRITER_H
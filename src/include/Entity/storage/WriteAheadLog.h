@@ -0,0 +1,225 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include "HeapFile.h"
+#include "Page.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+/**
+ * 数据库级的预写日志（DB/<db>/wal.log）
+ *
+ * 一条语句对各表的行级修改（插入、整行更新、删除）先收集在 Transaction 中，提交时编码成一条日志记录
+ * 追加到日志文件并 fsync，之后才修改数据页；数据页只在缓冲池淘汰、检查点或进程退出时写回。
+ * 同时提交的多条语句共用一次 fsync（组提交）：先到的线程把已经排队的记录一起写盘，其余线程等它完成。
+ * 一条语句涉及的所有表（包括外键级联）在同一条记录里，崩溃后要么全部重做，要么都不生效。
+ * 所有修改都就地写在行所在的页上，重复执行结果不变；打开数据库时按顺序重做日志中的全部记录，
+ * 然后做一次检查点清空日志。
+ */
+class WriteAheadLog {
+public:
+    /**
+     * 一条语句的所有修改，行位置都是语句开始时数据文件中的位置
+     */
+    class Transaction {
+    public:
+        /**
+         * 记录插入一行（rid 由 HeapFile::nextRowIds 预先算出）
+         *
+         * @param table 表名
+         * @param heap 表的数据文件
+         * @param rid 行位置
+         * @param row 行数据
+         * @throws None
+         *
+         * @author 韩玉龙
+         */
+        void insert(const std::string& table, const HeapFile& heap, RowId rid, const char* row);
+        /**
+         * 记录把一行整体改成新内容，同一行多次更新时以最后一次为准
+         *
+         * @param table 表名
+         * @param heap 表的数据文件
+         * @param rid 行位置
+         * @param row 新的行数据
+         * @throws None
+         *
+         * @author 韩玉龙
+         */
+        void update(const std::string& table, const HeapFile& heap, RowId rid, const char* row);
+        /**
+         * 记录删除一行
+         *
+         * @param table 表名
+         * @param heap 表的数据文件
+         * @param rid 行位置
+         * @throws None
+         *
+         * @author 韩玉龙
+         */
+        void erase(const std::string& table, const HeapFile& heap, RowId rid);
+        /**
+         * 只标记表被修改、不记录具体的行（不经过日志的批量导入），崩溃恢复后会重建它的索引
+         *
+         * @param table 表名
+         * @param heap 表的数据文件
+         * @throws None
+         *
+         * @author 韩玉龙
+         */
+        void touch(const std::string& table, const HeapFile& heap);
+        /**
+         * 本语句对某一行已经做出的修改，同一语句中后面的扫描据此读到自己的修改
+         *
+         * @param table 表名
+         * @param rid 行位置
+         * @param deleted 返回这一行是否已被删除
+         * @return 行被更新过时返回新的行数据，否则返回 nullptr
+         * @throws None
+         *
+         * @author 韩玉龙
+         */
+        const char* pendingRow(const std::string& table, RowId rid, bool& deleted) const;
+        bool empty() const { return tables.empty(); }
+
+    private:
+        friend class WriteAheadLog;
+        friend class TableRewriter;
+
+        struct TableChanges {
+            int rowWidth = 0;
+            std::vector<std::pair<RowId, std::vector<char>>> inserts;
+            std::map<uint64_t, std::vector<char>> updates;
+            std::set<uint64_t> deletes;
+        };
+
+        static uint64_t keyOf(RowId rid) { return (static_cast<uint64_t>(rid.pageNo) << 32) | rid.slot; }
+        static RowId rowIdOf(uint64_t key) { return RowId{static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key)}; }
+        TableChanges& changesOf(const std::string& table, const HeapFile& heap);
+
+        std::map<std::string, TableChanges> tables;
+    };
+
+    /**
+     * 获取某个数据库的日志，第一次获取时重做日志中尚未落盘的修改
+     *
+     * @param dbDir 数据库目录（DB/<db>）
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static WriteAheadLog& forDatabase(const std::filesystem::path& dbDir);
+    /**
+     * 关闭并丢弃某个数据库的日志（删除数据库时使用，不做检查点）
+     *
+     * @param dbDir 数据库目录
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void discard(const std::filesystem::path& dbDir);
+    /**
+     * 设置触发检查点的日志大小（字节）
+     *
+     * @param bytes 字节数
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void setCheckpointBytes(size_t bytes);
+    ~WriteAheadLog();
+    /**
+     * 语句修改表期间持有的写锁，析构或 release 时释放
+     */
+    class TableLocks {
+    public:
+        void release() { held.clear(); }
+
+    private:
+        friend class WriteAheadLog;
+        std::vector<std::unique_lock<std::mutex>> held;
+    };
+    /**
+     * 锁住一条语句要修改的表：从查重、算出新行的位置，到提交和维护索引都要持有，
+     * 同一张表上的写语句因此串行执行，不同表上的语句仍然组提交。按表名顺序加锁，不会死锁
+     *
+     * @param tables 表名，可以重复
+     * @return 持有这些表写锁的对象
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    TableLocks lockTables(std::vector<std::string> tables);
+    /**
+     * 提交一条语句：写日志（组提交）后把修改应用到数据文件；日志超过阈值时顺带做检查点。
+     * 日志落盘之后语句就已提交，这时应用失败无法回滚，直接终止进程，下次打开时按日志重做
+     *
+     * @param txn 语句的修改
+     * @return 写日志失败时返回 false，语句不生效
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool commit(const Transaction& txn);
+    /**
+     * 检查点：把本数据库的脏页写回并 fsync，然后清空日志。
+     * 不经过日志的整表改写（ALTER、TRUNCATE、RENAME 等）之前必须先做检查点
+     *
+     * @return 写盘失败时返回 false（日志保持不变）
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool checkpoint();
+    /**
+     * 取出上次恢复时重做过的表名（调用方据此重建这些表的索引），取出后清空
+     *
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    std::vector<std::string> takeRecoveredTables();
+
+private:
+    struct Registry;
+    friend class TableRewriter;
+
+    explicit WriteAheadLog(std::filesystem::path dbDir);
+    bool recover();
+    uint32_t append(const std::vector<char>& payload);
+    bool apply(const Transaction& txn, uint32_t lsn);
+    bool applyTable(const std::string& table, const Transaction::TableChanges& changes, uint32_t lsn);
+    bool checkpointLocked(bool flushPages);
+    bool resetLocked();
+    bool replaceTableLocked(const std::filesystem::path& tempPath, const std::filesystem::path& dataPath);
+    static void encode(const Transaction& txn, std::vector<char>& payload);
+    static bool decode(const char* data, size_t size, Transaction& txn);
+
+    std::filesystem::path dir;
+    std::filesystem::path logPath;
+    std::FILE* file = nullptr;
+    std::shared_mutex commitLock; // 提交持共享锁，检查点持独占锁
+    std::mutex mutex;
+    std::condition_variable flushed;
+    bool flushing = false;
+    std::vector<char> pending;    // 排队等待写盘的记录
+    uint32_t nextLsn = 1;
+    uint32_t durableLsn = 0;
+    uint32_t failedLsn = 0;       // 写盘失败的最后一个记录号，这些提交都失败
+    size_t logBytes = 0;          // 日志文件中已经落盘的字节数
+    std::vector<std::string> recoveredTables;
+    std::mutex captureMutex;
+    std::map<std::string, std::vector<Transaction::TableChanges>> captures; // 正在在线改写的表提交的修改，按应用顺序
+    std::mutex writeLocksMutex;
+    std::map<std::string, std::mutex> writeLocks; // 各表的写锁，见 lockTables
+};
+
+#endif // WRITE_AHEAD_LOG_H
@@ -0,0 +1,154 @@
+#ifndef ZONE_MAP_H
+#define ZONE_MAP_H
+
+#include "BufferPool.h"
+#include "Page.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+class HeapFile;
+
+/**
+ * 数据文件每一页上数值列的取值范围（zone map），保存在 .trd 旁边的 .tzm 文件中
+ *
+ * 第 0 页是文件头，记录跟踪的列（在行中的偏移、宽度、是否为 float）；之后按数据页的页号
+ * 每页一项：这一页的范围是否已知，以及每个跟踪列的最小值和最大值。写入行时只放宽范围，
+ * 删除不收窄，所以已知的范围总是覆盖页中所有存活的行，扫描时可以跳过范围与条件不相交的页。
+ * 范围未知的页（建立时的最后一页、建立之前就打开的数据文件对象新分配的页）总是要读。
+ * NULL 与 0 在行中都是全 0 字节，无法区分，因此不单独统计 NULL 的个数，0 照常计入范围。
+ * 文件经过缓冲池读写，和数据页一起写回；数据文件被整个替换或清空时删除，之后重新建立。
+ */
+class ZoneMap {
+public:
+    static constexpr uint32_t MAX_COLUMNS = 255; // 最多跟踪的列数
+
+    /**
+     * 被跟踪的列：按 integer（int32）或 number（float）读取字段的前 4 个字节
+     */
+    struct Column {
+        uint16_t offset;
+        uint16_t width;
+        uint8_t isFloat;
+        uint8_t reserved[3];
+    };
+
+    /**
+     * 一个数据页的范围，指向 .tzm 页中的一项，只在取出它的回调中有效
+     */
+    struct Entry {
+        const char* data;
+
+        bool known() const { return data[0] != 0; }
+        template <typename T>
+        T low(int column) const { return read<T>(column, 0); }
+        template <typename T>
+        T high(int column) const { return read<T>(column, 1); }
+
+    private:
+        template <typename T>
+        T read(int column, int which) const {
+            T value;
+            std::memcpy(&value, data + sizeof(uint32_t) + (column * 2 + which) * sizeof(T), sizeof(T));
+            return value;
+        }
+    };
+
+    explicit ZoneMap(std::filesystem::path path);
+    /**
+     * 数据文件对应的 zone map 文件路径（<table>.tzm）
+     *
+     * @param dataPath 数据文件路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static std::filesystem::path pathFor(const std::filesystem::path& dataPath);
+    /**
+     * 删除数据文件的 zone map（数据文件被替换或清空时调用）
+     *
+     * @param dataPath 数据文件路径
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    static void remove(const std::filesystem::path& dataPath);
+    /**
+     * 打开已有的 zone map，读取文件头中的列
+     *
+     * @return 文件不存在或文件头无效时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool open();
+    /**
+     * 扫描整个数据文件建立 zone map：先写临时文件再改名，改名之后打开的数据文件对象才会维护它
+     *
+     * @param heap 数据文件
+     * @param columns 要跟踪的列，超过 MAX_COLUMNS 的部分不跟踪
+     * @return 读数据文件或写文件失败时返回 false
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    bool build(const HeapFile& heap, std::vector<Column> columns);
+    /**
+     * 写入一行之后放宽所在页的范围
+     *
+     * @param pageNo 行所在的页号
+     * @param row 行数据
+     * @param freshPage 这一页原来没有任何行：范围从这一行重新开始，并标记为已知
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    void note(uint32_t pageNo, const char* row, bool freshPage);
+    /**
+     * 查找按给定方式跟踪的列
+     *
+     * @return 列在 zone map 中的下标，没有跟踪时返回 -1
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    int find(int offset, int width, bool isFloat) const;
+    /**
+     * 依次取出 [firstPage, endPage) 中各页的范围，visit(uint32_t pageNo, const Entry& entry)；
+     * zone map 中还没有项的页视为范围未知
+     *
+     * @throws None
+     *
+     * @author 韩玉龙
+     */
+    template <typename Visitor>
+    void forEachEntry(uint32_t firstPage, uint32_t endPage, Visitor&& visit) const {
+        static const char unknown[sizeof(uint32_t)] = {};
+        BufferPool::PageGuard page;
+        uint32_t loaded = 0;
+        for (uint32_t pageNo = firstPage; pageNo < endPage; ++pageNo) {
+            uint32_t zonePage = 1 + pageNo / entriesPerPage;
+            if (!page || loaded != zonePage) {
+                page = BufferPool::instance().fetchPage(filePath, zonePage);
+                loaded = zonePage;
+            }
+            Entry entry{page ? page.data() + static_cast<size_t>(pageNo % entriesPerPage) * entryWidth : unknown};
+            visit(pageNo, static_cast<const Entry&>(entry));
+        }
+    }
+
+    const std::vector<Column>& columns() const { return tracked; }
+
+private:
+    void setLayout(std::vector<Column> columns);
+    void reset(char* entry, const char* row) const;
+    void widen(char* entry, const char* row) const;
+
+    std::filesystem::path filePath;
+    std::vector<Column> tracked;
+    uint32_t entryWidth = 0;
+    uint32_t entriesPerPage = 0;
+};
+
+#endif // ZONE_MAP_H
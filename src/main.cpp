@@ -1,7 +1,6 @@
 #include "Entity/basic_function/DatabaseManager.h"
 #include "Entity/basic_function/TableManager.h"
 #include "Entity/basic_function/Table.h"
-#include "Entity/basic_function/AggregationFunctions.h"
 #include "Entity/basic_function/UserManager.h"
 
 int main() {
@@ -67,9 +66,7 @@ int main() {
     std::vector<std::string> record1 = { "1", "Alice", "30", "Woman", "1" };
     std::vector<std::string> record2 = { "2", "Bob", "25", "Man", "2" };
     std::vector<std::string> record3 = { "3", "Green", "", "", "3" };
-    tableManager.insertRecord(dbName, table1, record1);
-    tableManager.insertRecord(dbName, table1, record2);
-    tableManager.insertRecord(dbName, table1, record3);
+    tableManager.insertRecords(dbName, table1, { record1, record2, record3 });
 
     // 读取全表
     std::cout << std::endl;
@@ -82,7 +79,7 @@ int main() {
     std::cout << "条件读取：";
     std::vector<std::string> record4 = { "Age" };
     std::vector<std::string> record5 = { "=" };
-    std::vector<std::string> record6 = { "\x19" };
+    std::vector<std::string> record6 = { "25" };
     std::vector<std::string> fieldNames = { "ID", "Name" };
     tableManager.readRecords(dbName, table1, fieldNames, record4, record5, record6);
 
@@ -113,7 +110,7 @@ int main() {
     std::cout << std::endl;
     std::cout << "更新后读取全表：";
     std::vector<std::string> updateColumn = { "DeptID" };
-    std::vector<std::string> updateValue = { "\x19" };
+    std::vector<std::string> updateValue = { "25" };
     tableManager.updateTable(dbName, table1, record4, record5, record6, updateColumn, updateValue);
     tableManager.readTableData(dbName, table1);
     //tableManager.describeTable(table1);
@@ -167,12 +164,5 @@ int main() {
 //    std::cout << "User1 has "<<permission_1<< "permission after revoke: " << userManager.checkPermission(user_name , dbName, tableName, permission_1) << std::endl;
 
 //    //聚组函数
-//    std::vector<std::string> columnData = tableManager.readColumnData(dbName, tableName, "Name");
-//    //判断是否存在*
-//    bool have_all = false;
-//    std::cout << "Average of age: " << AggregationFunctions::average(columnData) << std::endl;
-//    std::cout << "Sum of age: " << AggregationFunctions::sum(columnData) << std::endl;
-//    std::cout << "Max of age: " << AggregationFunctions::max(columnData) << std::endl;
-//    std::cout << "Min of age: " << AggregationFunctions::min(columnData) << std::endl;
-//    std::cout << "Min of age: " << AggregationFunctions::count(columnData,have_all) << std::endl;
+//    tableManager.aggregateRecords(dbName, tableName, { "AVG", "SUM", "MAX", "MIN", "COUNT" }, { "Age", "Age", "Age", "Age", "*" }, {}, {}, {});
 }